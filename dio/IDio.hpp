@@ -21,6 +21,9 @@ namespace Dio
         OUTPUT
     };
 
+    // Returned by getPinChangeNumber for pins without a pin change interrupt
+    const static uint8_t NO_PIN_CHANGE = 0xFF;
+
     class IDio
     {
         public:
@@ -33,6 +36,9 @@ namespace Dio
 
             virtual void enableInterrupt(void (*pIntHandler)(void) = nullptr) {}
             virtual void disableInterrupt() {}
+
+            // Pin change interrupt number of the pin, or NO_PIN_CHANGE
+            virtual uint8_t getPinChangeNumber() { return NO_PIN_CHANGE; }
     };
 }
 
@@ -209,6 +209,11 @@ namespace Dio
         return PCINT_PORT_INFO[(uint8_t)port].offset + pin;
     }
 
+    uint8_t Atmega328Dio::getPinChangeNumber()
+    {
+        return getPcintNumber(port_, pin_);
+    }
+
     void Atmega328Dio::enableInterrupt(void (*pIntHandler)(void))
     {
         // If a callback was given, set it as the callback for this port
@@ -95,6 +95,12 @@ namespace Dio
              */
             void disableInterrupt() override;
 
+            /**
+             * Get the PCINT number of this pin, 8 per port starting with PCINT0 on port B
+             * @return  PCINT number, the port is the number divided by 8 and the bit the remainder
+             */
+            uint8_t getPinChangeNumber() override;
+
         private:
             volatile Port port_;
             volatile uint8_t pin_;
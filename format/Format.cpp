@@ -0,0 +1,180 @@
+#include "Format.hpp"
+#include <string.h>
+
+using namespace SerialComm;
+
+namespace Format
+{
+    const static uint8_t MAX_INTEGER_DIGITS = 10;   // Digits in the largest uint32_t
+    const static uint8_t LITERAL_CHUNK = 16;        // Literal text read from flash per write
+
+    SerialComm::ISerial* pDefaultSerial = nullptr;
+
+    void setDefaultSerial(ISerial* pSerial)
+    {
+        pDefaultSerial = pSerial;
+    }
+
+    static bool printText(ISerial* pSerial, const char* text, uint16_t length)
+    {
+        return pSerial->write((const uint8_t*)text, length) == length;
+    }
+
+    static bool printPadding(ISerial* pSerial, char pad, uint8_t count)
+    {
+        char chunk[LITERAL_CHUNK];
+        memset(chunk, pad, (count < LITERAL_CHUNK) ? count : LITERAL_CHUNK);
+
+        while (count > 0)
+        {
+            uint8_t chunkLength = (count < LITERAL_CHUNK) ? count : LITERAL_CHUNK;
+            if (!printText(pSerial, chunk, chunkLength)) return false;
+            count -= chunkLength;
+        }
+        return true;
+    }
+
+    bool printLiteral(ISerial* pSerial, const char** pFormat, Spec* pSpec)
+    {
+        const char* format = *pFormat;
+        char chunk[LITERAL_CHUNK];
+        uint8_t chunkLength = 0;
+        bool foundConversion = false;
+
+        while (true)
+        {
+            char c = pgm_read_byte(format);
+            if (c == '\0') break;
+            format++;
+
+            if (c == '%')
+            {
+                if (pgm_read_byte(format) == '%')
+                {
+                    // Escaped %, printed as literal text
+                    format++;
+                }
+                else
+                {
+                    foundConversion = true;
+                    break;
+                }
+            }
+
+            chunk[chunkLength++] = c;
+            if (chunkLength == LITERAL_CHUNK)
+            {
+                if (!printText(pSerial, chunk, chunkLength)) return false;
+                chunkLength = 0;
+            }
+        }
+
+        if ((chunkLength > 0) && !printText(pSerial, chunk, chunkLength)) return false;
+
+        if (foundConversion)
+        {
+            // Already checked at compile time, so only the supported syntax can be here
+            pSpec->zeroPad = false;
+            pSpec->leftAlign = false;
+            pSpec->width = 0;
+
+            char c = pgm_read_byte(format++);
+            while ((c == '-') || (c == '0'))
+            {
+                if (c == '-') pSpec->leftAlign = true;
+                if (c == '0') pSpec->zeroPad = true;
+                c = pgm_read_byte(format++);
+            }
+
+            while ((c >= '0') && (c <= '9'))
+            {
+                pSpec->width = (pSpec->width * 10) + (c - '0');
+                c = pgm_read_byte(format++);
+            }
+
+            pSpec->conversion = c;
+        }
+
+        *pFormat = format;
+        return foundConversion;
+    }
+
+    bool printInteger(ISerial* pSerial, const Spec& spec, uint32_t magnitude, bool negative)
+    {
+        // Digits are generated backwards from the end of the array, with room for a sign
+        char digits[MAX_INTEGER_DIGITS + 1];
+        uint8_t start = sizeof(digits);
+
+        bool hex = (spec.conversion == 'x') || (spec.conversion == 'X');
+        char hexBase = (spec.conversion == 'X') ? 'A' : 'a';
+        uint8_t base = hex ? 16 : 10;
+
+        do
+        {
+            uint8_t digit = magnitude % base;
+            magnitude /= base;
+            digits[--start] = (digit < 10) ? ('0' + digit) : (hexBase + digit - 10);
+        } while (magnitude != 0);
+
+        uint8_t length = sizeof(digits) - start + (negative ? 1 : 0);
+        uint8_t padding = (spec.width > length) ? (spec.width - length) : 0;
+
+        if (spec.leftAlign)
+        {
+            if (negative) digits[--start] = '-';
+            return printText(pSerial, &digits[start], sizeof(digits) - start) &&
+                   printPadding(pSerial, ' ', padding);
+        }
+        else if (spec.zeroPad)
+        {
+            // Zeros go between the sign and the digits
+            return (!negative || printText(pSerial, "-", 1)) &&
+                   printPadding(pSerial, '0', padding) &&
+                   printText(pSerial, &digits[start], sizeof(digits) - start);
+        }
+        else
+        {
+            if (negative) digits[--start] = '-';
+            return printPadding(pSerial, ' ', padding) &&
+                   printText(pSerial, &digits[start], sizeof(digits) - start);
+        }
+    }
+
+    bool printString(ISerial* pSerial, const Spec& spec, const char* str, bool inProgmem)
+    {
+        uint16_t length = 0;
+        if (inProgmem)
+        {
+            while (pgm_read_byte(&str[length]) != '\0') length++;
+        }
+        else
+        {
+            while (str[length] != '\0') length++;
+        }
+
+        uint8_t padding = (spec.width > length) ? (spec.width - length) : 0;
+        if (!spec.leftAlign && !printPadding(pSerial, ' ', padding)) return false;
+
+        if (inProgmem)
+        {
+            // Flash cannot be handed to write(), copy it over in chunks
+            char chunk[LITERAL_CHUNK];
+            uint16_t i = 0;
+            while (i < length)
+            {
+                uint8_t chunkLength = 0;
+                while ((chunkLength < LITERAL_CHUNK) && (i < length))
+                {
+                    chunk[chunkLength++] = pgm_read_byte(&str[i++]);
+                }
+                if (!printText(pSerial, chunk, chunkLength)) return false;
+            }
+        }
+        else if (!printText(pSerial, str, length))
+        {
+            return false;
+        }
+
+        return !spec.leftAlign || printPadding(pSerial, ' ', padding);
+    }
+}
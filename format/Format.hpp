@@ -0,0 +1,223 @@
+/**
+ * printf style formatting, checked at compile time and written straight to an ISerial.
+ *
+ *     FMT("temp=%d.%02d\n", whole, hundredths);
+ *     FMT_TO(&uart, "status 0x%02x %s\n", status, name);
+ *
+ * The format string is checked against the argument types when compiling, so a missing argument
+ * or a %s given a number fails to build. The string is then stored in PROGMEM, and read from
+ * flash while printing, so it takes no SRAM. Literal text goes to the serial in runs and each
+ * number is converted on the stack and written, there is no line buffer.
+ *
+ * Conversions: %d %i (signed or unsigned integers), %u %x %X (unsigned or signed integers, printed
+ * as unsigned), %c (char), %s (RAM string), %S (PROGMEM array, wrapped with FLASH_STR) and %%.
+ * Flags '-' and '0', and a width are supported. Integers are at most 32 bits.
+ *
+ * Output is lossy, nothing waits for room. The first write the serial does not take all of ends
+ * the print, so a line comes out cut short rather than with holes in it. To print a line whole or
+ * not at all, check the serial's getTxSpace() against its longest output first.
+ */
+#ifndef FORMAT_HPP
+#define FORMAT_HPP
+
+#include <stdint.h>
+#include <avr/pgmspace.h>
+
+#include "drivers/serial/ISerial.hpp"
+
+#define FMT_TO(pSerial, fmt, ...)                                                                       \
+    do                                                                                                  \
+    {                                                                                                   \
+        static_assert(Format::Check<decltype(Format::typeList(__VA_ARGS__))>::valid(fmt),               \
+                      "FMT arguments do not match the format string: " fmt);                           \
+        Format::print((pSerial), PSTR(fmt), ##__VA_ARGS__);                                             \
+    } while (0)
+
+// Print to the serial given to Format::setDefaultSerial
+#define FMT(fmt, ...) FMT_TO(Format::pDefaultSerial, fmt, ##__VA_ARGS__)
+
+// Wrap a pointer to a PROGMEM string for %S. FMT arguments are also expanded inside decltype for
+// checking, so this takes a named PROGMEM array rather than a PSTR
+#define FLASH_STR(pStr) (Format::FlashString{ (pStr) })
+
+namespace Format
+{
+    /**
+     * A string in PROGMEM, printed with %S
+     */
+    struct FlashString
+    {
+        const char* pStr;
+    };
+
+    /**
+     * Set the serial FMT() prints to
+     */
+    void setDefaultSerial(SerialComm::ISerial* pSerial);
+
+    extern SerialComm::ISerial* pDefaultSerial;
+
+    // Type traits, avr-gcc does not come with <type_traits>
+    template <typename T> struct IsInteger { static constexpr bool value = false; static constexpr bool isSigned = false; };
+    template <> struct IsInteger<bool> { static constexpr bool value = true; static constexpr bool isSigned = false; };
+    template <> struct IsInteger<char> { static constexpr bool value = true; static constexpr bool isSigned = ((char)-1 < 0); };
+    template <> struct IsInteger<signed char> { static constexpr bool value = true; static constexpr bool isSigned = true; };
+    template <> struct IsInteger<unsigned char> { static constexpr bool value = true; static constexpr bool isSigned = false; };
+    template <> struct IsInteger<short> { static constexpr bool value = true; static constexpr bool isSigned = true; };
+    template <> struct IsInteger<unsigned short> { static constexpr bool value = true; static constexpr bool isSigned = false; };
+    template <> struct IsInteger<int> { static constexpr bool value = true; static constexpr bool isSigned = true; };
+    template <> struct IsInteger<unsigned int> { static constexpr bool value = true; static constexpr bool isSigned = false; };
+    template <> struct IsInteger<long> { static constexpr bool value = (sizeof(long) <= 4); static constexpr bool isSigned = true; };
+    template <> struct IsInteger<unsigned long> { static constexpr bool value = (sizeof(long) <= 4); static constexpr bool isSigned = false; };
+
+    template <typename T> struct IsString { static constexpr bool value = false; };
+    template <> struct IsString<char*> { static constexpr bool value = true; };
+    template <> struct IsString<const char*> { static constexpr bool value = true; };
+
+    template <typename T> struct IsFlashString { static constexpr bool value = false; };
+    template <> struct IsFlashString<FlashString> { static constexpr bool value = true; };
+
+    template <typename... T> struct TypeList {};
+
+    // Only used in decltype, to get the argument types of FMT
+    template <typename... T>
+    TypeList<T...> typeList(T... args);
+
+    // Compile time format string parsing, in C++11 constexpr form
+    constexpr bool isFlag(char c) { return (c == '-') || (c == '0'); }
+    constexpr bool isDigit(char c) { return (c >= '0') && (c <= '9'); }
+
+    // Skip flags and width, pointing at the conversion character
+    constexpr const char* skipFlags(const char* f) { return isFlag(*f) ? skipFlags(f + 1) : f; }
+    constexpr const char* skipWidth(const char* f) { return isDigit(*f) ? skipWidth(f + 1) : f; }
+    constexpr const char* conversion(const char* f) { return skipWidth(skipFlags(f)); }
+
+    template <typename T>
+    constexpr bool matches(char c)
+    {
+        return ((c == 'd') || (c == 'i') || (c == 'u') || (c == 'x') || (c == 'X')) ? IsInteger<T>::value :
+               (c == 'c') ? IsInteger<T>::value :
+               (c == 's') ? IsString<T>::value :
+               (c == 'S') ? IsFlashString<T>::value :
+               false;
+    }
+
+    template <typename List>
+    struct Check;
+
+    template <>
+    struct Check<TypeList<>>
+    {
+        // No arguments left, only %% may follow
+        static constexpr bool valid(const char* f)
+        {
+            return (*f == '\0') ? true :
+                   (*f != '%') ? valid(f + 1) :
+                   (f[1] == '%') ? valid(f + 2) :
+                   false;
+        }
+    };
+
+    template <typename T, typename... Rest>
+    struct Check<TypeList<T, Rest...>>
+    {
+        // The next conversion must take T, then the rest of the string must take Rest
+        static constexpr bool valid(const char* f)
+        {
+            return (*f == '\0') ? false :
+                   (*f != '%') ? valid(f + 1) :
+                   (f[1] == '%') ? valid(f + 2) :
+                   (matches<T>(*conversion(f + 1)) && Check<TypeList<Rest...>>::valid(conversion(f + 1) + 1));
+        }
+    };
+
+    /**
+     * A parsed conversion
+     */
+    struct Spec
+    {
+        char conversion;    // Conversion character, e.g. 'd'
+        uint8_t width;      // Minimum number of characters to print
+        bool zeroPad;       // Pad numbers with '0' instead of ' '
+        bool leftAlign;     // Pad on the right instead of the left
+    };
+
+    /**
+     * Write literal text from a PROGMEM format string, up to the next conversion
+     * @param   pSerial     Where to print
+     * @param   pFormat     Position in the format string, moved past the conversion
+     * @param   pSpec       Set to the conversion found
+     * @return  False if the end of the format string was reached instead, or the serial did not
+     *          take all the text
+     */
+    bool printLiteral(SerialComm::ISerial* pSerial, const char** pFormat, Spec* pSpec);
+
+    // Each returns false if the serial did not take all of the conversion
+    bool printInteger(SerialComm::ISerial* pSerial, const Spec& spec, uint32_t magnitude, bool negative);
+    bool printString(SerialComm::ISerial* pSerial, const Spec& spec, const char* str, bool inProgmem);
+
+    template <typename T>
+    constexpr bool isNegative(T value)
+    {
+        return IsInteger<T>::isSigned && (value < (T)0);
+    }
+
+    template <typename T>
+    bool printValue(SerialComm::ISerial* pSerial, const Spec& spec, T value)
+    {
+        if (spec.conversion == 'c')
+        {
+            uint8_t c = (uint8_t)value;
+            return pSerial->write(&c, 1) == 1;
+        }
+
+        // Unsigned conversions of negative values print the value's own width of bits, like printf
+        const uint32_t mask = (sizeof(T) >= 4) ? 0xFFFFFFFFul : ((1ul << (8 * sizeof(T))) - 1);
+        bool negative = isNegative(value) && ((spec.conversion == 'd') || (spec.conversion == 'i'));
+        uint32_t magnitude = negative ? (0u - (uint32_t)(int32_t)value) : ((uint32_t)value & mask);
+        return printInteger(pSerial, spec, magnitude, negative);
+    }
+
+    inline bool printValue(SerialComm::ISerial* pSerial, const Spec& spec, const char* value)
+    {
+        return printString(pSerial, spec, value, false);
+    }
+
+    inline bool printValue(SerialComm::ISerial* pSerial, const Spec& spec, char* value)
+    {
+        return printString(pSerial, spec, value, false);
+    }
+
+    inline bool printValue(SerialComm::ISerial* pSerial, const Spec& spec, FlashString value)
+    {
+        return printString(pSerial, spec, value.pStr, true);
+    }
+
+    inline void printArgs(SerialComm::ISerial* pSerial, const char* format)
+    {
+        Spec spec;
+        printLiteral(pSerial, &format, &spec);
+    }
+
+    template <typename T, typename... Rest>
+    void printArgs(SerialComm::ISerial* pSerial, const char* format, T arg, Rest... rest)
+    {
+        Spec spec;
+        if (!printLiteral(pSerial, &format, &spec)) return;
+
+        if (!printValue(pSerial, spec, arg)) return;
+        printArgs(pSerial, format, rest...);
+    }
+
+    /**
+     * Print a PROGMEM format string, use FMT or FMT_TO so the arguments are checked
+     */
+    template <typename... Args>
+    void print(SerialComm::ISerial* pSerial, const char* format, Args... args)
+    {
+        if (pSerial == nullptr) return;
+        printArgs(pSerial, format, args...);
+    }
+}
+
+#endif
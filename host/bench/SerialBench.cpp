@@ -0,0 +1,607 @@
+/**
+ * Serial driver benchmark on the simulated ATmega328P
+ *
+ * Runs each driver against the simulated USART, pins and timers, with the far end of the line
+ * played by the simulation, through three traffic patterns:
+ *     logs    bursts of LOG_BURST bytes at half the line rate on average, nothing received
+ *     echo    the far end sends a command line, waits for it to come back, then sends the next
+ *     duplex  both ends stream as fast as they can
+ * Drivers:
+ *     polled      Atmega328Uart
+ *     asynch      Atmega328AsynchUart, i.e. Atmega328AsynchUsart<Usart0> bound by ASYNCH_UART_ISRS
+ *     soft        Atmega328SoftwareSerial, byte read in the pin change interrupt, blocking writes
+ *     soft-timed  Atmega328SoftwareSerial with timed RX and timed TX
+ *
+ * The clock is virtual. The main loop spends LOOP_CYCLES on other work each time round, every
+ * register access takes ACCESS_CYCLES, and each interrupt ENTRY_CYCLES to reach its handler and
+ * EXIT_CYCLES to return. Everything else runs in no time, so cycle counts are a model: compare
+ * drivers and settings with them rather than quoting them as what the part would do.
+ *
+ * Columns:
+ *     tx, rx B/s  bytes delivered to the far end, and read by the main loop, per simulated second
+ *     isr cyc/B   simulated cycles in interrupts per byte moved either way
+ *     isr ns/B    host time in the profiled handler bodies per byte moved, the cost of the same
+ *                 code run natively, to compare the handlers' code
+ *     tx, rx hwm  most bytes waiting in the driver's rings, as the driver reports it. A ~ marks a
+ *                 peak seen from the main loop instead, for drivers that do not track one
+ *     stall %     share of the main loop's time spent inside driver calls
+ *     lost        bytes dropped, overrun, corrupted or skipped, both ways
+ *     resp us     echo only, worst time from the last byte of a command to the last byte of its echo
+ *
+ *     SerialBench [--quick]
+ */
+#include <vector>
+#include <functional>
+#include <chrono>
+#include <string.h>
+#include <math.h>
+#include <stdio.h>
+#include "drivers/serial/atmega328/Atmega328Uart.hpp"
+#include "drivers/serial/atmega328/Atmega328AsynchUart.hpp"
+#include "drivers/serial/atmega328/Atmega328SoftwareSerial.hpp"
+#include "drivers/dio/atmega328/Atmega328Dio.hpp"
+#include "drivers/interrupt/atmega328/Atmega328Interrupt.hpp"
+#include "SimAvr.hpp"
+#include "HostTest.hpp"
+
+using namespace SerialComm;
+using namespace Dio;
+
+namespace SerialBench
+{
+    static ProfileTotals totals[NUM_SERIAL_PROFILE_EVENTS];
+    static uint64_t beginCycles[NUM_SERIAL_PROFILE_EVENTS];
+    static std::chrono::steady_clock::time_point beginTimes[NUM_SERIAL_PROFILE_EVENTS];
+
+    void profileBegin(SerialProfileEvent event)
+    {
+        beginCycles[event] = Sim::machine().cycles();
+        beginTimes[event] = std::chrono::steady_clock::now();
+    }
+
+    void profileEnd(SerialProfileEvent event)
+    {
+        std::chrono::nanoseconds elapsed = std::chrono::steady_clock::now() - beginTimes[event];
+        totals[event].count++;
+        totals[event].cycles += Sim::machine().cycles() - beginCycles[event];
+        totals[event].hostNs += elapsed.count();
+    }
+
+    const ProfileTotals& profileTotals(SerialProfileEvent event)
+    {
+        return totals[event];
+    }
+}
+
+namespace
+{
+    const uint32_t CPU_HZ = 16000000;
+    const uint32_t LOOP_CYCLES = 200;   // Main loop's other work each time round
+    const uint32_t ACCESS_CYCLES = 4;   // A register access and the instructions around it
+    const uint32_t ENTRY_CYCLES = 24;   // Interrupt response, vector jump, and a prologue saving about eight registers
+    const uint32_t EXIT_CYCLES = 20;    // Epilogue and RETI
+
+    // What the software serial's timing constants allow for. The busy waiting paths count their pin
+    // accesses, virtual calls, as part of each bit, so those take time here too
+    const uint32_t SOFT_PIN_CHANGE_LATENCY = 80;    // Edge to the timed RX timer restart
+    const uint32_t SOFT_SAMPLE_LATENCY = 40;        // Compare match to the timed RX pin read
+    const uint32_t SOFT_SET_CYCLES = 86;            // Setting the TX pin
+    const uint32_t SOFT_READ_CYCLES = 106;          // Reading the RX pin
+
+    const uint16_t LOG_BURST = 48;          // Bytes written in each burst of log lines
+    const uint8_t COMMAND_LENGTH = 16;      // Echo command, newline included
+    const uint32_t ECHO_TIMEOUT_MS = 20;    // Far end gives up on an echo after this long
+    const uint8_t SEQUENCE_PERIOD = 251;    // Streamed bytes count modulo this, so a gap shows as a jump
+    const uint16_t DUPLEX_CHUNK = 16;       // Most bytes written at once while streaming
+
+    const uint16_t RING_LENGTH = 64;
+
+    enum Pattern
+    {
+        PATTERN_LOGS = 0,
+        PATTERN_ECHO,
+        PATTERN_DUPLEX,
+        NUM_PATTERNS
+    };
+
+    const char* const PATTERN_NAMES[NUM_PATTERNS] = { "logs", "echo", "duplex" };
+
+    uint8_t sequenceByte(uint32_t position)
+    {
+        return (uint8_t)(position % SEQUENCE_PERIOD);
+    }
+
+    /**
+     * Follows a stream of sequenceByte() values, counting the bytes missing from the jumps in it
+     */
+    struct SequenceCheck
+    {
+        uint32_t next = 0;
+        uint32_t received = 0;
+        uint32_t lost = 0;
+
+        void feed(uint8_t byte)
+        {
+            uint32_t gap = (byte + SEQUENCE_PERIOD - (next % SEQUENCE_PERIOD)) % SEQUENCE_PERIOD;
+            lost += gap;
+            next += gap + 1;
+            received++;
+        }
+    };
+
+    /**
+     * Pin that takes as long to set and read as the busy waiting paths allow for, or no time for the
+     * timed paths, whose interrupt latencies already cover theirs. The time passes after the access,
+     * so edges and samples stay where the driver put them
+     */
+    class TimedDio : public Atmega328Dio
+    {
+        public:
+            TimedDio(Port port, uint8_t pin, Mode mode, Level level, bool usePullup, uint32_t setCycles, uint32_t readCycles):
+                Atmega328Dio(port, pin, mode, level, false, usePullup), setCycles_(setCycles), readCycles_(readCycles) {}
+
+            bool set(Level level) override
+            {
+                bool result = Atmega328Dio::set(level);
+                Sim::machine().delay(setCycles_);
+                return result;
+            }
+
+            void set(uint8_t level) override
+            {
+                Atmega328Dio::set(level);
+                Sim::machine().delay(setCycles_);
+            }
+
+            Level read() override
+            {
+                Level level = Atmega328Dio::read();
+                Sim::machine().delay(readCycles_);
+                return level;
+            }
+
+        private:
+            uint32_t setCycles_;
+            uint32_t readCycles_;
+    };
+
+    /**
+     * A driver under test and the far end of its line
+     */
+    struct Rig
+    {
+        Sim::Avr* pAvr;
+        ISerial* pSerial;
+        Sim::UartLine* pLine;                   // Far end sending to the driver
+        std::vector<Sim::LineFrame>* pPeerRx;   // Frames the far end has received from the driver
+        bool readBlocks;                        // read() waits for every byte asked for
+        uint16_t txCapacity;                    // Bytes write() can buffer, 0 if it blocks instead
+        std::function<int32_t()> txHighWaterMark;   // Driver's own, empty if it does not keep one
+        std::function<int32_t()> rxHighWaterMark;
+    };
+
+    struct Result
+    {
+        double seconds;
+        uint32_t txBytes;
+        uint32_t rxBytes;
+        uint32_t lost;
+        uint64_t stallCycles;
+        int32_t txPeak;             // Seen from the main loop
+        int32_t rxPeak;
+        double worstResponseUs;     // Negative when not measured
+    };
+
+    /**
+     * Calls into the driver from the main loop, timing them and watching its buffers
+     */
+    class Device
+    {
+        public:
+            Device(Rig& rig, Result& result): rig_(rig), result_(result) {}
+
+            uint16_t write(const uint8_t* buff, uint16_t numBytes)
+            {
+                uint64_t start = rig_.pAvr->cycles();
+                uint16_t written = rig_.pSerial->write(buff, numBytes);
+                result_.stallCycles += rig_.pAvr->cycles() - start;
+
+                if (rig_.txCapacity != 0)
+                {
+                    int32_t queued = rig_.txCapacity - rig_.pSerial->getTxSpace();
+                    if (queued > result_.txPeak) result_.txPeak = queued;
+                }
+                return written;
+            }
+
+            uint16_t read(uint8_t* buff, uint16_t maxBytes)
+            {
+                uint64_t start = rig_.pAvr->cycles();
+                uint16_t numRead = 0;
+                if (rig_.readBlocks)
+                {
+                    // Only ask for what is already there
+                    while ((numRead < maxBytes) && rig_.pSerial->isDataAvailable())
+                    {
+                        numRead += rig_.pSerial->read(&buff[numRead], 1);
+                    }
+                }
+                else
+                {
+                    numRead = rig_.pSerial->read(buff, maxBytes);
+                }
+                result_.stallCycles += rig_.pAvr->cycles() - start;
+
+                if ((int32_t)numRead > result_.rxPeak) result_.rxPeak = numRead;
+                result_.rxBytes += numRead;
+                return numRead;
+            }
+
+        private:
+            Rig& rig_;
+            Result& result_;
+    };
+
+    uint64_t msToCycles(uint32_t ms)
+    {
+        return (uint64_t)ms * (CPU_HZ / 1000);
+    }
+
+    uint32_t countPeerLost(Rig& rig, uint64_t end, SequenceCheck& check)
+    {
+        uint32_t corrupt = 0;
+        for (const Sim::LineFrame& frame : *rig.pPeerRx)
+        {
+            if (frame.end > end) break;
+            if (frame.framingError)
+            {
+                corrupt++;
+                continue;
+            }
+            check.feed((uint8_t)frame.value);
+        }
+        return check.lost + corrupt;
+    }
+
+    void runLogs(Rig& rig, uint32_t baudRate, uint64_t duration, Result& result)
+    {
+        Device device(rig, result);
+        Sim::Avr& avr = *rig.pAvr;
+
+        // Each burst at half the line rate on average
+        uint64_t period = ((uint64_t)LOG_BURST * 10 * 2 * CPU_HZ) / baudRate;
+        uint64_t end = avr.cycles() + duration;
+        uint64_t nextBurst = avr.cycles();
+        uint32_t produced = 0;
+        uint32_t dropped = 0;
+
+        uint8_t burst[LOG_BURST];
+        while (avr.cycles() < end)
+        {
+            if (avr.cycles() >= nextBurst)
+            {
+                for (uint16_t i=0; i<LOG_BURST; i++) burst[i] = sequenceByte(produced + i);
+                uint16_t written = device.write(burst, LOG_BURST);
+                produced += written;
+                dropped += LOG_BURST - written;
+                nextBurst += period;
+            }
+            avr.advance(LOOP_CYCLES);
+        }
+
+        SequenceCheck check;
+        result.lost = dropped + countPeerLost(rig, end, check);
+        result.txBytes = check.received;
+    }
+
+    void runEcho(Rig& rig, uint64_t duration, Result& result)
+    {
+        Device device(rig, result);
+        Sim::Avr& avr = *rig.pAvr;
+        uint64_t end = avr.cycles() + duration;
+
+        uint8_t line[64];
+        uint16_t lineLength = 0;
+
+        char command[COMMAND_LENGTH + 1];
+        uint32_t commandNumber = 0;
+        uint64_t commandSentAt = 0;     // Cycle the stop bit of the command's last byte ends
+        uint32_t echoStart = 0;         // Index in the far end's frames the echo starts at
+        bool waiting = false;
+        result.worstResponseUs = 0;
+
+        while (avr.cycles() < end)
+        {
+            // Far end: check the echo, then send the next command
+            std::vector<Sim::LineFrame>& echoed = *rig.pPeerRx;
+            if (waiting)
+            {
+                uint32_t echoEnd = echoStart;
+                while ((echoEnd < echoed.size()) && (echoed[echoEnd].value != '\n')) echoEnd++;
+
+                if (echoEnd < echoed.size())
+                {
+                    uint32_t echoLength = echoEnd + 1 - echoStart;
+                    uint32_t mismatches = (echoLength > COMMAND_LENGTH) ? (echoLength - COMMAND_LENGTH) : (COMMAND_LENGTH - echoLength);
+                    for (uint32_t i=0; (i<echoLength) && (i<COMMAND_LENGTH); i++)
+                    {
+                        if (echoed[echoStart + i].value != (uint8_t)command[i]) mismatches++;
+                    }
+                    result.lost += mismatches;
+                    result.txBytes += echoLength;
+
+                    double responseUs = (echoed[echoEnd].end - commandSentAt) * 1e6 / CPU_HZ;
+                    if (responseUs > result.worstResponseUs) result.worstResponseUs = responseUs;
+                    echoStart = echoEnd + 1;
+                    waiting = false;
+                }
+                else if (avr.cycles() > commandSentAt + msToCycles(ECHO_TIMEOUT_MS))
+                {
+                    result.lost += COMMAND_LENGTH;
+                    echoStart = echoed.size();
+                    waiting = false;
+                }
+            }
+
+            if (!waiting)
+            {
+                snprintf(command, sizeof(command), "SET PWM %04u ON\n", (unsigned)(commandNumber++ % 10000));
+                rig.pLine->send((const uint8_t*)command, COMMAND_LENGTH);
+                uint32_t lastFrame = rig.pLine->getNumFramesQueued() - 1;
+                commandSentAt = (uint64_t)ceil(rig.pLine->getFrameStart(lastFrame) + 10 * rig.pLine->getBitCycles());
+                waiting = true;
+            }
+
+            // Device: read what has come in, and send back each whole line
+            uint16_t numRead = device.read(&line[lineLength], sizeof(line) - lineLength);
+            for (uint16_t i=lineLength; i<lineLength + numRead; i++)
+            {
+                if (line[i] != '\n') continue;
+                uint16_t length = i + 1;
+                uint16_t written = 0;
+                while (written < length) written += device.write(&line[written], length - written);
+                memmove(line, &line[length], lineLength + numRead - length);
+                numRead -= length - lineLength;
+                lineLength = 0;
+                i = (uint16_t)-1;
+            }
+            lineLength += numRead;
+            if (lineLength == sizeof(line)) lineLength = 0;
+
+            avr.advance(LOOP_CYCLES);
+        }
+    }
+
+    void runDuplex(Rig& rig, uint32_t baudRate, uint64_t duration, Result& result)
+    {
+        Device device(rig, result);
+        Sim::Avr& avr = *rig.pAvr;
+        uint64_t end = avr.cycles() + duration;
+
+        // The far end sends back to back for the whole run
+        uint32_t numSent = (uint32_t)((duration * baudRate) / (10ull * CPU_HZ)) + 1;
+        std::vector<uint8_t> stream(numSent);
+        for (uint32_t i=0; i<numSent; i++) stream[i] = sequenceByte(i);
+        for (uint32_t i=0; i<numSent; i += 0xFFFF)
+        {
+            uint32_t length = numSent - i;
+            rig.pLine->send(&stream[i], (length > 0xFFFF) ? 0xFFFF : length);
+        }
+
+        SequenceCheck rxCheck;
+        uint32_t produced = 0;
+        uint8_t buff[DUPLEX_CHUNK];
+        while (avr.cycles() < end)
+        {
+            uint16_t numRead = device.read(buff, sizeof(buff));
+            for (uint16_t i=0; i<numRead; i++) rxCheck.feed(buff[i]);
+
+            // A driver that blocks gets a byte at a time, so reading is not held off for long
+            uint16_t chunk = 1;
+            if (rig.txCapacity != 0)
+            {
+                uint16_t space = rig.pSerial->getTxSpace();
+                chunk = (space < DUPLEX_CHUNK) ? space : DUPLEX_CHUNK;
+            }
+            for (uint16_t i=0; i<chunk; i++) buff[i] = sequenceByte(produced + i);
+            if (chunk > 0) produced += device.write(buff, chunk);
+
+            avr.advance(LOOP_CYCLES);
+        }
+
+        SequenceCheck txCheck;
+        result.lost = rxCheck.lost + countPeerLost(rig, end, txCheck);
+        result.txBytes = txCheck.received;
+    }
+
+    void report(const char* driver, uint32_t baudRate, Pattern pattern, Rig& rig, Result& result)
+    {
+        static const SerialProfileEvent ISR_EVENTS[] =
+        {
+            SERIAL_PROFILE_RX_ISR,
+            SERIAL_PROFILE_TX_ISR,
+            SERIAL_PROFILE_SOFT_RX_ISR,
+            SERIAL_PROFILE_SOFT_RX_SAMPLE,
+            SERIAL_PROFILE_SOFT_TX_TICK
+        };
+
+        uint64_t isrNs = 0;
+        for (SerialProfileEvent event : ISR_EVENTS) isrNs += SerialBench::profileTotals(event).hostNs;
+
+        RxStatistics stats = rig.pSerial->getRxStatistics();
+        uint32_t moved = result.txBytes + result.rxBytes;
+        double perByte = (moved > 0) ? 1.0 / moved : 0;
+
+        char txHwm[16];
+        char rxHwm[16];
+        if (rig.txHighWaterMark) snprintf(txHwm, sizeof(txHwm), "%d", (int)rig.txHighWaterMark());
+        else if (rig.txCapacity != 0) snprintf(txHwm, sizeof(txHwm), "~%d", (int)result.txPeak);
+        else snprintf(txHwm, sizeof(txHwm), "-");
+        if (rig.rxHighWaterMark) snprintf(rxHwm, sizeof(rxHwm), "%d", (int)rig.rxHighWaterMark());
+        else snprintf(rxHwm, sizeof(rxHwm), "~%d", (int)result.rxPeak);
+
+        char response[16];
+        if (result.worstResponseUs >= 0) snprintf(response, sizeof(response), "%.0f", result.worstResponseUs);
+        else snprintf(response, sizeof(response), "-");
+
+        printf("%-10s %6u %-6s %8.0f %8.0f %9.1f %8.0f %6s %6s %6.1f %6u %8s   (ovr %u fe %u drop %u)\n",
+               driver, (unsigned)baudRate, PATTERN_NAMES[pattern],
+               result.txBytes / result.seconds, result.rxBytes / result.seconds,
+               rig.pAvr->getInterruptCycles() * perByte, isrNs * perByte,
+               txHwm, rxHwm,
+               100.0 * result.stallCycles / (result.seconds * CPU_HZ),
+               (unsigned)result.lost, response,
+               (unsigned)stats.overruns, (unsigned)stats.framingErrors, (unsigned)stats.droppedBytes);
+    }
+
+    void run(const char* driver, uint32_t baudRate, Pattern pattern, uint64_t duration, Rig& rig)
+    {
+        Result result = Result();
+        result.seconds = (double)duration / CPU_HZ;
+        result.worstResponseUs = -1;
+
+        switch (pattern)
+        {
+            case PATTERN_LOGS: runLogs(rig, baudRate, duration, result); break;
+            case PATTERN_ECHO: runEcho(rig, duration, result); break;
+            default: runDuplex(rig, baudRate, duration, result); break;
+        }
+
+        report(driver, baudRate, pattern, rig, result);
+    }
+
+    void setUpMachine(Sim::Avr& avr)
+    {
+        avr.setInterruptLatency(ENTRY_CYCLES);
+        avr.setInterruptExitCycles(EXIT_CYCLES);
+        avr.setAccessCycles(ACCESS_CYCLES);
+    }
+
+    BaudRate toBaudRate(uint32_t baudRate)
+    {
+        switch (baudRate)
+        {
+            case 9600: return BAUD_9600;
+            case 19200: return BAUD_19200;
+            case 38400: return BAUD_38400;
+            case 57600: return BAUD_57600;
+            case 115200: return BAUD_115200;
+            case 250000: return BAUD_250000;
+            default: return BAUD_500000;
+        }
+    }
+}
+
+uint8_t asynchTxBuffer[RING_LENGTH];
+uint8_t asynchRxBuffer[RING_LENGTH];
+Atmega328AsynchUart asynchUart(asynchTxBuffer, asynchRxBuffer, RING_LENGTH, RING_LENGTH, BAUD_115200, CPU_HZ);
+ASYNCH_UART_ISRS(asynchUart)
+
+namespace
+{
+    void runPolled(uint32_t baudRate, Pattern pattern, uint64_t duration)
+    {
+        Sim::Avr avr(CPU_HZ);
+        setUpMachine(avr);
+        Sim::Pins pins(avr);
+        Sim::Usart usart(avr, pins);
+        Sim::UartLine line(avr, pins, Sim::PORT_D, 0, baudRate);
+
+        Atmega328Uart uart(toBaudRate(baudRate), CPU_HZ);
+        uart.initialize();
+        sei();
+
+        Rig rig = { &avr, &uart, &line, &usart.sent, true, 0, nullptr, nullptr };
+        run("polled", baudRate, pattern, duration, rig);
+    }
+
+    void runAsynch(uint32_t baudRate, Pattern pattern, uint64_t duration)
+    {
+        Sim::Avr avr(CPU_HZ);
+        setUpMachine(avr);
+        Sim::Pins pins(avr);
+        Sim::Usart usart(avr, pins);
+        Sim::UartLine line(avr, pins, Sim::PORT_D, 0, baudRate);
+
+        asynchUart.setBaudRate(toBaudRate(baudRate), CPU_HZ);
+        asynchUart.initialize();
+        sei();
+
+        Rig rig = { &avr, &asynchUart, &line, &usart.sent, false, RING_LENGTH,
+                    []() { return (int32_t)asynchUart.getTxHighWaterMark(); },
+                    []() { return (int32_t)asynchUart.getRxHighWaterMark(); } };
+        run("asynch", baudRate, pattern, duration, rig);
+    }
+
+    void runSoft(uint32_t baudRate, Pattern pattern, uint64_t duration, bool timed)
+    {
+        Sim::Avr avr(CPU_HZ);
+        setUpMachine(avr);
+        Sim::Pins pins(avr);
+        Sim::CtcTimer rxTimer(avr, 8);
+        Sim::CtcTimer txTimer(avr, 8);
+        Sim::UartLine line(avr, pins, Sim::PORT_D, 2, baudRate);
+        Sim::UartMonitor monitor(avr, pins, Sim::PORT_D, 3, baudRate);
+        pins.setInterruptLatency(SOFT_PIN_CHANGE_LATENCY);
+        rxTimer.setInterruptLatency(SOFT_SAMPLE_LATENCY);
+
+        uint32_t setCycles = timed ? 0 : SOFT_SET_CYCLES;
+        uint32_t readCycles = timed ? 0 : SOFT_READ_CYCLES;
+        TimedDio rxPin(Port::D, 2, INPUT, L_HIGH, true, setCycles, readCycles);
+        TimedDio txPin(Port::D, 3, OUTPUT, L_HIGH, false, setCycles, readCycles);
+        Interrupt::Atmega328Interrupt interrupts;
+        uint8_t rxBuffer[RING_LENGTH];
+        uint8_t txBuffer[RING_LENGTH];
+        Atmega328SoftwareSerial serial(&rxPin, &txPin, &interrupts, baudRate, CPU_HZ, rxBuffer, sizeof(rxBuffer));
+        serial.initialize();
+
+        if (timed)
+        {
+            serial.enableTimedRx(&rxTimer, rxTimer.getTicksPerSecond());
+
+            // One tick per bit
+            uint32_t ticsPerBit = (txTimer.getTicksPerSecond() + (baudRate / 2)) / baudRate;
+            txTimer.setPeriodTics(ticsPerBit - 1);
+            serial.enableTimedTx(&txTimer, txTimer.getTicksPerSecond() / ticsPerBit, txBuffer, sizeof(txBuffer));
+        }
+        interrupts.enableInterrupts();
+
+        Rig rig = { &avr, &serial, &line, &monitor.frames, false, (uint16_t)(timed ? RING_LENGTH : 0), nullptr, nullptr };
+        run(timed ? "soft-timed" : "soft", baudRate, pattern, duration, rig);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool quick = (argc > 1) && (strcmp(argv[1], "--quick") == 0);
+    uint64_t duration = (quick ? 20 : 250) * (uint64_t)(CPU_HZ / 1000);
+
+    static const uint32_t USART_BAUDS[] = { 9600, 115200, 250000 };
+    static const uint32_t SOFT_BAUDS[] = { 9600, 38400 };
+
+    printf("%-10s %6s %-6s %8s %8s %9s %8s %6s %6s %6s %6s %8s\n",
+           "driver", "baud", "load", "tx B/s", "rx B/s", "isr cyc/B", "isr ns/B", "tx hwm", "rx hwm", "stall%", "lost", "resp us");
+
+    for (uint8_t p=0; p<NUM_PATTERNS; p++)
+    {
+        Pattern pattern = (Pattern)p;
+        for (uint32_t baudRate : USART_BAUDS)
+        {
+            HostTest::runIsolated("polled", [&]() { runPolled(baudRate, pattern, duration); });
+        }
+        for (uint32_t baudRate : USART_BAUDS)
+        {
+            HostTest::runIsolated("asynch", [&]() { runAsynch(baudRate, pattern, duration); });
+        }
+        for (uint32_t baudRate : SOFT_BAUDS)
+        {
+            HostTest::runIsolated("soft", [&]() { runSoft(baudRate, pattern, duration, false); });
+        }
+        for (uint32_t baudRate : SOFT_BAUDS)
+        {
+            HostTest::runIsolated("soft-timed", [&]() { runSoft(baudRate, pattern, duration, true); });
+        }
+    }
+
+    return HostTest::result();
+}
@@ -0,0 +1,34 @@
+/**
+ * Serial profiling hooks for the benchmark, see serial/SerialProfile.hpp
+ *
+ * Each event adds up the simulated cycles and the host time spent between its BEGIN and END.
+ * The simulated time of a handler body only covers its register accesses and waits, the host
+ * time is the real cost of running the same code natively, useful to compare drivers' handlers.
+ */
+#ifndef SERIAL_BENCH_HOOKS_HPP
+#define SERIAL_BENCH_HOOKS_HPP
+
+#include <stdint.h>
+
+namespace SerialBench
+{
+    struct ProfileTotals
+    {
+        uint32_t count;
+        uint64_t cycles;
+        uint64_t hostNs;
+    };
+
+    void profileBegin(SerialComm::SerialProfileEvent event);
+    void profileEnd(SerialComm::SerialProfileEvent event);
+
+    /**
+     * @return  Totals for an event since the program started
+     */
+    const ProfileTotals& profileTotals(SerialComm::SerialProfileEvent event);
+}
+
+#define SERIAL_PROFILE_BEGIN(event) SerialBench::profileBegin(event)
+#define SERIAL_PROFILE_END(event) SerialBench::profileEnd(event)
+
+#endif
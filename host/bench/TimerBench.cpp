@@ -0,0 +1,147 @@
+/**
+ * TimerWheel against polled SoftwareTimers, as a main loop would run them
+ *
+ * N periodic timers with periods spread over 10 to 1000 tics run for a stretch of tics, with the
+ * main loop going round LOOPS_PER_TIC times each tic:
+ *     polled  N SoftwareTimers, every pass calls hasPeriodPassed() on each one, which reads the
+ *             tic count and divides by the period
+ *     wheel   N WheelTimers, every pass calls TimerWheel::dispatch() once
+ * Both see the same expiries, which the benchmark checks.
+ *
+ * Columns:
+ *     ns/pass     host time per main loop pass, spent in the timers
+ *     reads/pass  tic count reads per pass, each a 32-bit read with interrupts in the way on the part
+ *     expiries    callbacks run, or periods seen passing
+ *
+ *     TimerBench [--quick]
+ */
+#include <vector>
+#include <chrono>
+#include <string.h>
+#include <stdio.h>
+#include "drivers/timer/TimerWheel.hpp"
+#include "drivers/timer/SoftwareTimer.hpp"
+#include "HostTest.hpp"
+
+namespace
+{
+    const uint32_t TICS_PER_SECOND = 1000;
+    const uint32_t LOOPS_PER_TIC = 16;      // Main loop passes between tics
+    const uint32_t MIN_PERIOD_TICS = 10;
+    const uint32_t MAX_PERIOD_TICS = 1000;
+
+    // getTicCount() returns a volatile value, which an override has to repeat
+    #pragma GCC diagnostic ignored "-Wignored-qualifiers"
+
+    /**
+     * Tic counter that counts how often it is read
+     */
+    class CountingTics : public Tic::TicCounter
+    {
+        public:
+            CountingTics(): TicCounter(TICS_PER_SECOND), reads(0) {}
+
+            volatile uint32_t getTicCount() override
+            {
+                reads++;
+                return TicCounter::getTicCount();
+            }
+
+            uint64_t reads;
+    };
+
+    uint64_t expiries;
+    void onExpiry() { expiries++; }
+
+    struct Result
+    {
+        double nsPerPass;
+        double readsPerPass;
+        uint64_t expiries;
+    };
+
+    uint32_t periodOf(uint32_t index)
+    {
+        return MIN_PERIOD_TICS + ((index * 397) % (MAX_PERIOD_TICS - MIN_PERIOD_TICS + 1));
+    }
+
+    /**
+     * Run the loop for numTics, timing only the calls to the timers
+     */
+    template <typename Poll>
+    Result runLoop(CountingTics& tics, uint32_t numTics, Poll poll)
+    {
+        tics.reads = 0;
+        expiries = 0;
+        std::chrono::nanoseconds elapsed(0);
+
+        for (uint32_t tic=0; tic<numTics; tic++)
+        {
+            tics.incrementTicCount();
+
+            std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+            for (uint32_t pass=0; pass<LOOPS_PER_TIC; pass++) poll();
+            elapsed += std::chrono::steady_clock::now() - start;
+        }
+
+        uint64_t numPasses = (uint64_t)numTics * LOOPS_PER_TIC;
+        return Result{ (double)elapsed.count() / numPasses, (double)tics.reads / numPasses, expiries };
+    }
+
+    Result runPolled(uint32_t numTimers, uint32_t numTics)
+    {
+        CountingTics tics;
+        std::vector<Timer::SoftwareTimer> timers;
+        timers.reserve(numTimers);
+        for (uint32_t i=0; i<numTimers; i++)
+        {
+            timers.emplace_back(periodOf(i), &tics);
+            timers.back().enable();
+        }
+
+        return runLoop(tics, numTics, [&]()
+        {
+            for (Timer::SoftwareTimer& timer : timers)
+            {
+                if (timer.hasPeriodPassed()) onExpiry();
+            }
+        });
+    }
+
+    Result runWheel(uint32_t numTimers, uint32_t numTics)
+    {
+        CountingTics tics;
+        Timer::TimerWheel wheel(&tics);
+        std::vector<Timer::WheelTimer> timers(numTimers, Timer::WheelTimer(onExpiry));
+        for (uint32_t i=0; i<numTimers; i++) wheel.startPeriodic(&timers[i], periodOf(i));
+
+        return runLoop(tics, numTics, [&]() { wheel.dispatch(); });
+    }
+}
+
+int main(int argc, char** argv)
+{
+    bool quick = (argc > 1) && (strcmp(argv[1], "--quick") == 0);
+    uint32_t numTics = quick ? 2000 : 60000;
+
+    static const uint32_t TIMER_COUNTS[] = { 1, 4, 12, 32, 128 };
+
+    printf("%-7s %6s %9s %10s %9s\n", "timers", "method", "ns/pass", "reads/pass", "expiries");
+
+    for (uint32_t numTimers : TIMER_COUNTS)
+    {
+        Result polled = runPolled(numTimers, numTics);
+        Result wheel = runWheel(numTimers, numTics);
+
+        printf("%-7u %6s %9.1f %10.2f %9llu\n", (unsigned)numTimers, "polled",
+               polled.nsPerPass, polled.readsPerPass, (unsigned long long)polled.expiries);
+        printf("%-7u %6s %9.1f %10.2f %9llu\n", (unsigned)numTimers, "wheel",
+               wheel.nsPerPass, wheel.readsPerPass, (unsigned long long)wheel.expiries);
+
+        // Every period passing is seen once either way
+        CHECK_EQUAL(wheel.expiries, polled.expiries);
+        CHECK(wheel.readsPerPass <= 1.0);
+    }
+
+    return HostTest::result();
+}
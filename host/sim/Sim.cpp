@@ -0,0 +1,43 @@
+#include "Sim.hpp"
+#include <avr/io.h>
+#include <avr/wdt.h>
+
+#define SIM_REG8(name) Sim::Reg8 Sim_##name;
+#define SIM_REG16(name) Sim::Reg16 Sim_##name;
+#include "SimRegisters.def"
+#undef SIM_REG8
+#undef SIM_REG16
+
+namespace Sim
+{
+    static Machine plainMachine;
+    static Machine* pMachine = &plainMachine;
+
+    Machine& machine()
+    {
+        return *pMachine;
+    }
+
+    void setMachine(Machine* pNewMachine)
+    {
+        pMachine = (pNewMachine != nullptr) ? pNewMachine : &plainMachine;
+    }
+
+    bool interruptsEnabled()
+    {
+        return (SREG.raw() & (1 << SREG_INTERRUPT_BIT)) != 0;
+    }
+
+    void interrupt(void (*vector)(void))
+    {
+        SREG.raw() &= ~(1 << SREG_INTERRUPT_BIT);
+        vector();
+        SREG = SREG | (1 << SREG_INTERRUPT_BIT);
+    }
+
+    uint32_t& watchdogResets()
+    {
+        static uint32_t resets = 0;
+        return resets;
+    }
+}
@@ -0,0 +1,116 @@
+/**
+ * Simulated AVR core for the host build
+ *
+ * Every I/O register is an object that hands its reads and writes to the installed Machine, so a
+ * test can model a peripheral (a USART shifting out what is written to UDR0, a timer counting in
+ * TCNT1) and keep a virtual clock in CPU cycles. With no machine installed the registers are plain
+ * memory. Taking a register's address gives the raw storage, as the drivers' pointer tables
+ * expect, and accesses through it bypass the machine.
+ *
+ * ISR() defines an extern "C" function named after the vector, so a machine or test raises an
+ * interrupt by calling e.g. Sim::interrupt(USART_RX_vect).
+ */
+#ifndef HOST_SIM_HPP
+#define HOST_SIM_HPP
+
+#include <stdint.h>
+
+namespace Sim
+{
+    const static uint8_t SREG_INTERRUPT_BIT = 7;
+
+    class Machine
+    {
+        public:
+            virtual ~Machine() {}
+
+            /**
+             * Register accesses, reg is the register's storage as the drivers see it (&UDR0)
+             */
+            virtual uint8_t read(volatile uint8_t* reg) { return *reg; }
+            virtual void write(volatile uint8_t* reg, uint8_t value) { *reg = value; }
+            virtual uint16_t read(volatile uint16_t* reg) { return *reg; }
+            virtual void write(volatile uint16_t* reg, uint16_t value) { *reg = value; }
+
+            /**
+             * The CPU spends cycles busy waiting, e.g. in _delay_loop_2
+             */
+            virtual void delay(uint32_t cycles) { cycles_ += cycles; }
+
+            /**
+             * sleep_cpu() with sleep enabled, wakes on the next interrupt
+             */
+            virtual void sleep() {}
+
+            /**
+             * @return  CPU cycles since the machine started
+             */
+            uint64_t cycles() const { return cycles_; }
+
+            /**
+             * Move the clock on, e.g. to account for the instructions between register accesses
+             */
+            void advance(uint32_t cycles) { cycles_ += cycles; }
+
+        protected:
+            uint64_t cycles_ = 0;
+    };
+
+    /**
+     * @return  Machine every register access goes to, a plain memory one by default
+     */
+    Machine& machine();
+
+    /**
+     * Install a machine, nullptr restores the plain memory one
+     */
+    void setMachine(Machine* pMachine);
+
+    template <typename T>
+    class Reg
+    {
+        public:
+            Reg(): value_(0) {}
+
+            operator T() const { return machine().read(&value_); }
+
+            Reg& operator=(T value)
+            {
+                machine().write(&value_, value);
+                return *this;
+            }
+
+            Reg& operator=(const Reg& other) { return *this = (T)other; }
+
+            // Operands are promoted ints, as with the part's registers, e.g. reg &= ~(1 << BIT)
+            Reg& operator|=(int bits) { return *this = (T)(*this | bits); }
+            Reg& operator&=(int bits) { return *this = (T)(*this & bits); }
+            Reg& operator^=(int bits) { return *this = (T)(*this ^ bits); }
+
+            volatile T* operator&() { return &value_; }
+
+            /**
+             * Storage, for machines to change without going through their own hooks
+             */
+            volatile T& raw() { return value_; }
+
+        private:
+            mutable volatile T value_;
+    };
+
+    typedef Reg<uint8_t> Reg8;
+    typedef Reg<uint16_t> Reg16;
+
+    /**
+     * @return  True if the global interrupt enable bit is set
+     */
+    bool interruptsEnabled();
+
+    /**
+     * Run an interrupt vector the way the core does: the global enable bit is cleared while it runs
+     * and set again by the RETI
+     */
+    void interrupt(void (*vector)(void));
+}
+
+#endif
@@ -0,0 +1,708 @@
+#include "SimAvr.hpp"
+#include <math.h>
+#include <memory>
+#include <avr/io.h>
+
+// Pin change vectors, weak so the machine links without the Dio driver that defines them
+extern "C" void PCINT0_vect(void) __attribute__((weak));
+extern "C" void PCINT1_vect(void) __attribute__((weak));
+extern "C" void PCINT2_vect(void) __attribute__((weak));
+extern "C" void USART_RX_vect(void) __attribute__((weak));
+extern "C" void USART_UDRE_vect(void) __attribute__((weak));
+extern "C" void USART_TX_vect(void) __attribute__((weak));
+
+namespace Sim
+{
+    Avr::Avr(uint32_t fCpu):
+        fCpu_(fCpu),
+        defaultLatency_(0),
+        exitCycles_(0),
+        accessCycles_(0),
+        dispatching_(false),
+        interruptCount_(0),
+        interruptCycles_(0)
+    {
+        setMachine(this);
+    }
+
+    Avr::~Avr()
+    {
+        setMachine(nullptr);
+    }
+
+    void Avr::runUntil(uint64_t cycle)
+    {
+        // Pins set through the raw registers since the last access change at this cycle, not the next one
+        service();
+
+        while (cycles_ < cycle)
+        {
+            uint64_t next = NEVER;
+            for (Peripheral* pPeripheral : peripherals_)
+            {
+                uint64_t event = pPeripheral->nextEvent();
+                if (event < next) next = event;
+            }
+
+            cycles_ = (next < cycle) ? ((next > cycles_) ? next : cycles_ + 1) : cycle;
+            service();
+        }
+    }
+
+    bool Avr::runUntilInterrupt(uint64_t limit)
+    {
+        uint64_t count = interruptCount_;
+        service();
+        while ((interruptCount_ == count) && (cycles_ < limit))
+        {
+            uint64_t next = NEVER;
+            for (Peripheral* pPeripheral : peripherals_)
+            {
+                uint64_t event = pPeripheral->nextEvent();
+                if (event < next) next = event;
+            }
+
+            if (next >= limit)
+            {
+                runUntil(limit);
+                break;
+            }
+            runUntil((next > cycles_) ? next : cycles_ + 1);
+        }
+        return interruptCount_ != count;
+    }
+
+    void Avr::service()
+    {
+        sync(cycles_);
+        dispatch();
+    }
+
+    void Avr::sleep()
+    {
+        // Nothing left to wake the part leaves it asleep for good, let the test carry on instead
+        runUntilInterrupt(NEVER);
+    }
+
+    void Avr::sync(uint64_t now)
+    {
+        for (Peripheral* pPeripheral : peripherals_) pPeripheral->update(now);
+    }
+
+    void Avr::dispatch()
+    {
+        // The handlers' own register accesses and the RETI come back through here
+        if (dispatching_) return;
+        dispatching_ = true;
+
+        while (interruptsEnabled())
+        {
+            // Peripherals attached first win, as lower vectors do on the part
+            Vector vector = nullptr;
+            Peripheral* pSource = nullptr;
+            for (Peripheral* pPeripheral : peripherals_)
+            {
+                vector = pPeripheral->takeInterrupt();
+                if (vector != nullptr)
+                {
+                    pSource = pPeripheral;
+                    break;
+                }
+            }
+            if (vector == nullptr) break;
+
+            SREG.raw() &= ~(1 << SREG_INTERRUPT_BIT);
+            uint64_t taken = cycles_;
+            int32_t latency = pSource->getInterruptLatency();
+            step(cycles_ + ((latency < 0) ? defaultLatency_ : (uint32_t)latency));
+
+            interruptCount_++;
+            vector();
+            step(cycles_ + exitCycles_);
+            interruptCycles_ += cycles_ - taken;
+
+            SREG.raw() |= (1 << SREG_INTERRUPT_BIT);
+            sync(cycles_);
+        }
+
+        dispatching_ = false;
+    }
+
+    void Avr::step(uint64_t cycle)
+    {
+        // Peripherals keep running, but nothing is dispatched
+        while (cycles_ < cycle)
+        {
+            uint64_t next = cycle;
+            for (Peripheral* pPeripheral : peripherals_)
+            {
+                uint64_t event = pPeripheral->nextEvent();
+                if ((event > cycles_) && (event < next)) next = event;
+            }
+            cycles_ = next;
+            sync(cycles_);
+        }
+    }
+
+    void Avr::access()
+    {
+        if (accessCycles_ != 0) runUntil(cycles_ + accessCycles_);
+        else service();
+    }
+
+    uint8_t Avr::read(volatile uint8_t* reg)
+    {
+        access();
+        uint8_t value;
+        for (Peripheral* pPeripheral : peripherals_)
+        {
+            if (pPeripheral->read(reg, value)) return value;
+        }
+        return *reg;
+    }
+
+    void Avr::write(volatile uint8_t* reg, uint8_t value)
+    {
+        bool handled = false;
+        for (Peripheral* pPeripheral : peripherals_)
+        {
+            if (pPeripheral->write(reg, value))
+            {
+                handled = true;
+                break;
+            }
+        }
+        if (!handled) *reg = value;
+        access();
+    }
+
+    uint16_t Avr::read(volatile uint16_t* reg)
+    {
+        access();
+        uint16_t value;
+        for (Peripheral* pPeripheral : peripherals_)
+        {
+            if (pPeripheral->read(reg, value)) return value;
+        }
+        return *reg;
+    }
+
+    void Avr::write(volatile uint16_t* reg, uint16_t value)
+    {
+        bool handled = false;
+        for (Peripheral* pPeripheral : peripherals_)
+        {
+            if (pPeripheral->write(reg, value))
+            {
+                handled = true;
+                break;
+            }
+        }
+        if (!handled) *reg = value;
+        access();
+    }
+
+    static Reg8* const PIN_REGS[NUM_PORTS] = { std::addressof(Sim_PINB), std::addressof(Sim_PINC), std::addressof(Sim_PIND) };
+    static Reg8* const DDR_REGS[NUM_PORTS] = { std::addressof(Sim_DDRB), std::addressof(Sim_DDRC), std::addressof(Sim_DDRD) };
+    static Reg8* const PORT_REGS[NUM_PORTS] = { std::addressof(Sim_PORTB), std::addressof(Sim_PORTC), std::addressof(Sim_PORTD) };
+    static Reg8* const PCMSK_REGS[NUM_PORTS] = { std::addressof(Sim_PCMSK0), std::addressof(Sim_PCMSK1), std::addressof(Sim_PCMSK2) };
+
+    Pins::Pins(Avr& avr):
+        avr_(avr),
+        driven_{ 0 },
+        drivenHigh_{ 0 },
+        lastPins_{ 0 }
+    {
+        refresh();
+        for (uint8_t port=0; port<NUM_PORTS; port++) lastPins_[port] = PIN_REGS[port]->raw();
+        PCIFR.raw() = 0;
+        avr_.attach(this);
+    }
+
+    void Pins::drive(PortName port, uint8_t pin, bool high)
+    {
+        driven_[port] |= (1 << pin);
+        if (high) drivenHigh_[port] |= (1 << pin);
+        else drivenHigh_[port] &= ~(1 << pin);
+        refresh();
+    }
+
+    void Pins::release(PortName port, uint8_t pin)
+    {
+        driven_[port] &= ~(1 << pin);
+        refresh();
+    }
+
+    bool Pins::level(PortName port, uint8_t pin)
+    {
+        refresh();
+        return (PIN_REGS[port]->raw() & (1 << pin)) != 0;
+    }
+
+    void Pins::refresh()
+    {
+        bool changed = false;
+        for (uint8_t port=0; port<NUM_PORTS; port++)
+        {
+            uint8_t ddr = DDR_REGS[port]->raw();
+            uint8_t out = PORT_REGS[port]->raw();
+
+            // Undriven inputs follow their pull-up, i.e. the PORT bit
+            uint8_t outside = (driven_[port] & drivenHigh_[port]) | (~driven_[port] & out);
+            uint8_t pins = (ddr & out) | (~ddr & outside);
+
+            if (((pins ^ lastPins_[port]) & PCMSK_REGS[port]->raw()) != 0) PCIFR.raw() |= (1 << port);
+            if (pins != lastPins_[port]) changed = true;
+            lastPins_[port] = pins;
+            PIN_REGS[port]->raw() = pins;
+        }
+
+        // PINx is up to date by now, so watchers reading it back do not come round again
+        if (changed)
+        {
+            for (Peripheral* pWatcher : watchers_) pWatcher->update(avr_.cycles());
+        }
+    }
+
+    Vector Pins::takeInterrupt()
+    {
+        static const Vector VECTORS[NUM_PORTS] = { PCINT0_vect, PCINT1_vect, PCINT2_vect };
+
+        uint8_t pending = PCIFR.raw() & PCICR.raw();
+        for (uint8_t port=0; port<NUM_PORTS; port++)
+        {
+            if ((pending & (1 << port)) == 0) continue;
+            PCIFR.raw() &= ~(1 << port);
+            if (VECTORS[port] != nullptr) return VECTORS[port];
+        }
+        return nullptr;
+    }
+
+    int Pins::portOf(volatile uint8_t* reg, Reg8* const* regs)
+    {
+        for (int port=0; port<NUM_PORTS; port++)
+        {
+            if (&(*regs[port]) == reg) return port;
+        }
+        return -1;
+    }
+
+    bool Pins::read(volatile uint8_t* reg, uint8_t& value)
+    {
+        if (portOf(reg, PIN_REGS) < 0) return false;
+        refresh();
+        value = *reg;
+        return true;
+    }
+
+    bool Pins::write(volatile uint8_t* reg, uint8_t value)
+    {
+        // Writing a one to a PIN bit toggles the PORT bit, writing a one to a PCIFR bit clears it
+        int port = portOf(reg, PIN_REGS);
+        if (port >= 0)
+        {
+            PORT_REGS[port]->raw() ^= value;
+            refresh();
+            return true;
+        }
+        if (reg == &PCIFR)
+        {
+            PCIFR.raw() &= ~value;
+            return true;
+        }
+        return false;
+    }
+
+    CtcTimer::CtcTimer(Avr& avr, uint16_t prescale):
+        avr_(avr),
+        prescale_(prescale),
+        top_(0xFF),
+        count_(0),
+        enabled_(false),
+        flag_(false),
+        lastStep_(avr.cycles() / prescale),
+        interrupt_(nullptr)
+    {
+        avr_.attach(this);
+    }
+
+    uint32_t CtcTimer::stepsToMatch()
+    {
+        // Above the top the counter runs on to its maximum and around before it can match
+        uint32_t max = getMaxPeriodTics();
+        if (count_ <= top_) return top_ - count_ + 1;
+        return (max - count_ + 1) + top_ + 1;
+    }
+
+    void CtcTimer::update(uint64_t now)
+    {
+        uint64_t step = now / prescale_;
+        if (step <= lastStep_) return;
+
+        uint64_t steps = step - lastStep_;
+        lastStep_ = step;
+
+        uint32_t toMatch;
+        while (steps >= (toMatch = stepsToMatch()))
+        {
+            steps -= toMatch;
+            count_ = 0;
+            flag_ = true;
+        }
+        count_ += steps;
+    }
+
+    uint64_t CtcTimer::nextEvent()
+    {
+        return (lastStep_ + stepsToMatch()) * prescale_;
+    }
+
+    Vector CtcTimer::takeInterrupt()
+    {
+        if (!enabled_ || !flag_) return nullptr;
+        flag_ = false;
+        return interrupt_;
+    }
+
+    void CtcTimer::enable()
+    {
+        update(avr_.cycles());
+        flag_ = false;
+        enabled_ = true;
+    }
+
+    void CtcTimer::disable()
+    {
+        update(avr_.cycles());
+        enabled_ = false;
+    }
+
+    void CtcTimer::setPeriodTics(uint16_t tics)
+    {
+        update(avr_.cycles());
+        top_ = tics & getMaxPeriodTics();
+    }
+
+    uint16_t CtcTimer::microSecondsToTics(uint32_t microseconds)
+    {
+        return ((uint64_t)microseconds * getTicksPerSecond()) / 1000000 - 1;
+    }
+
+    void CtcTimer::reset()
+    {
+        update(avr_.cycles());
+        count_ = 0;
+    }
+
+    UartLine::UartLine(Avr& avr, Pins& pins, PortName port, uint8_t pin, uint32_t baudRate, double skew):
+        avr_(avr),
+        pins_(pins),
+        port_(port),
+        pin_(pin),
+        bitCycles_((double)avr.getFCpu() / (baudRate * (1 + skew))),
+        nextFrame_(0),
+        bit_(0),
+        lineFreeAt_(0)
+    {
+        pins_.drive(port_, pin_, true);
+        avr_.attach(this);
+    }
+
+    void UartLine::send(const uint8_t* bytes, uint16_t numBytes, double idleBits)
+    {
+        for (uint16_t i=0; i<numBytes; i++)
+        {
+            double now = (double)avr_.cycles();
+            double start = ((lineFreeAt_ > now) ? lineFreeAt_ : now) + (idleBits * bitCycles_);
+            frames_.push_back({ bytes[i], idleBits, start });
+            lineFreeAt_ = start + (10 * bitCycles_);
+        }
+    }
+
+    uint64_t UartLine::nextEvent()
+    {
+        if (nextFrame_ >= frames_.size()) return NEVER;
+        return (uint64_t)ceil(bitStart(bit_));
+    }
+
+    void UartLine::update(uint64_t now)
+    {
+        while ((nextFrame_ < frames_.size()) && ((uint64_t)ceil(bitStart(bit_)) <= now))
+        {
+            // Start bit low, data bits LSB first, stop bit high, then on to the next frame
+            if (bit_ == 10)
+            {
+                nextFrame_++;
+                bit_ = 0;
+                continue;
+            }
+
+            bool high;
+            if (bit_ == 0) high = false;
+            else if (bit_ == 9) high = true;
+            else high = (frames_[nextFrame_].byte >> (bit_ - 1)) & 0x01;
+
+            bit_++;
+            pins_.drive(port_, pin_, high);
+        }
+    }
+
+    bool FrameReceiver::update(uint64_t now, bool level, double bitCycles, uint8_t dataBits, bool parity, LineFrame& frame)
+    {
+        if (!busy_)
+        {
+            if (level) return false;
+
+            // Falling edge, the start bit began at this update
+            busy_ = true;
+            bitCycles_ = bitCycles;
+            dataBits_ = dataBits;
+            parity_ = parity;
+            start_ = (double)now;
+            bit_ = 0;
+            shift_ = 0;
+            return false;
+        }
+
+        if (now < sampleAt(bit_)) return false;
+
+        uint8_t stopBit = 1 + dataBits_ + (parity_ ? 1 : 0);
+        if (bit_ == 0)
+        {
+            // Line is high again at the center of the start bit, it was a glitch
+            if (level) busy_ = false;
+            else bit_++;
+            return false;
+        }
+
+        if (bit_ < stopBit)
+        {
+            if (level) shift_ |= (1 << (bit_ - 1));
+            bit_++;
+            return false;
+        }
+
+        busy_ = false;
+        uint16_t dataMask = (1 << dataBits_) - 1;
+        frame.value = shift_ & dataMask;
+        frame.end = now;
+        frame.framingError = !level;
+
+        frame.parityError = false;
+        if (parity_)
+        {
+            uint8_t ones = (shift_ & (1 << dataBits_)) ? 1 : 0;
+            for (uint16_t data = frame.value; data != 0; data >>= 1) ones += data & 0x01;
+            frame.parityError = (ones & 0x01) != 0;
+        }
+        return true;
+    }
+
+    Usart::Usart(Avr& avr, Pins& pins):
+        avr_(avr),
+        pins_(pins),
+        txShifting_(false),
+        txShift_(0),
+        txShiftEnd_(0),
+        txDataFull_(false),
+        txData_(0),
+        txComplete_(false),
+        receiver_(),
+        rxFifo_(),
+        rxCount_(0),
+        rxOverrun_(false)
+    {
+        avr_.attach(this);
+        pins_.watch(this);
+    }
+
+    double Usart::getBitCycles()
+    {
+        uint16_t ubrr = ((UBRR0H.raw() & 0x0F) << 8) | UBRR0L.raw();
+        uint8_t samples = (UCSR0A.raw() & (1 << U2X0)) ? 8 : 16;
+        return (double)samples * (ubrr + 1);
+    }
+
+    uint8_t Usart::dataBits()
+    {
+        return (UCSR0B.raw() & (1 << UCSZ02)) ? 9 : 8;
+    }
+
+    bool Usart::parityEnabled()
+    {
+        return (UCSR0C.raw() & (1 << UPM01)) != 0;
+    }
+
+    uint8_t Usart::frameBits()
+    {
+        uint8_t stopBits = (UCSR0C.raw() & (1 << USBS0)) ? 2 : 1;
+        return 1 + dataBits() + (parityEnabled() ? 1 : 0) + stopBits;
+    }
+
+    void Usart::startShift(uint16_t frame, uint64_t start)
+    {
+        txShifting_ = true;
+        txShift_ = frame;
+        txShiftEnd_ = start + (uint64_t)llround(frameBits() * getBitCycles());
+    }
+
+    void Usart::update(uint64_t now)
+    {
+        while (txShifting_ && (txShiftEnd_ <= now))
+        {
+            sent.push_back({ txShift_, txShiftEnd_, false, false });
+            txShifting_ = false;
+
+            // The next frame follows straight on from the last stop bit
+            if (txDataFull_)
+            {
+                txDataFull_ = false;
+                startShift(txData_, txShiftEnd_);
+            }
+            else
+            {
+                txComplete_ = true;
+            }
+        }
+
+        if (!(UCSR0B.raw() & (1 << RXEN0))) return;
+
+        LineFrame frame;
+        if (!receiver_.update(now, pins_.level(PORT_D, 0), getBitCycles(), dataBits(), parityEnabled(), frame)) return;
+
+        // Multi-processor mode lets only address frames, with the 9th bit set, through
+        if ((UCSR0A.raw() & (1 << MPCM0)) && !(frame.value & 0x100)) return;
+
+        if (rxCount_ == RX_FIFO_DEPTH)
+        {
+            rxOverrun_ = true;
+            return;
+        }
+
+        rxFifo_[rxCount_++] = { frame.value, frame.framingError, frame.parityError, rxOverrun_ };
+        rxOverrun_ = false;
+    }
+
+    uint64_t Usart::nextEvent()
+    {
+        uint64_t next = (UCSR0B.raw() & (1 << RXEN0)) ? receiver_.nextEvent() : NEVER;
+        if (txShifting_ && (txShiftEnd_ < next)) next = txShiftEnd_;
+        return next;
+    }
+
+    Vector Usart::takeInterrupt()
+    {
+        uint8_t ucsrb = UCSR0B.raw();
+
+        // RX complete and data register empty stay pending until the handler reads or writes UDR0
+        if ((ucsrb & (1 << RXCIE0)) && (rxCount_ > 0) && (USART_RX_vect != nullptr)) return USART_RX_vect;
+        if ((ucsrb & (1 << UDRIE0)) && !txDataFull_ && (USART_UDRE_vect != nullptr)) return USART_UDRE_vect;
+        if ((ucsrb & (1 << TXCIE0)) && txComplete_ && (USART_TX_vect != nullptr))
+        {
+            txComplete_ = false;
+            return USART_TX_vect;
+        }
+        return nullptr;
+    }
+
+    bool Usart::read(volatile uint8_t* reg, uint8_t& value)
+    {
+        if (reg == &UCSR0A)
+        {
+            value = UCSR0A.raw() & ((1 << U2X0) | (1 << MPCM0));
+            if (rxCount_ > 0)
+            {
+                value |= (1 << RXC0);
+                if (rxFifo_[0].framingError) value |= (1 << FE0);
+                if (rxFifo_[0].parityError) value |= (1 << UPE0);
+                if (rxFifo_[0].overrun) value |= (1 << DOR0);
+            }
+            if (txComplete_) value |= (1 << TXC0);
+            if (!txDataFull_) value |= (1 << UDRE0);
+            return true;
+        }
+
+        if (reg == &UCSR0B)
+        {
+            value = UCSR0B.raw() & ~(1 << RXB80);
+            if ((rxCount_ > 0) && (rxFifo_[0].value & 0x100)) value |= (1 << RXB80);
+            return true;
+        }
+
+        if (reg == &UDR0)
+        {
+            value = 0;
+            if (rxCount_ == 0) return true;
+
+            value = (uint8_t)rxFifo_[0].value;
+            rxCount_--;
+            for (uint8_t i=0; i<rxCount_; i++) rxFifo_[i] = rxFifo_[i + 1];
+            return true;
+        }
+
+        return false;
+    }
+
+    bool Usart::write(volatile uint8_t* reg, uint8_t value)
+    {
+        if (reg == &UCSR0A)
+        {
+            // Only U2X0 and MPCM0 are stored, writing a one to TXC0 clears it
+            UCSR0A.raw() = value & ((1 << U2X0) | (1 << MPCM0));
+            if (value & (1 << TXC0)) txComplete_ = false;
+            return true;
+        }
+
+        if (reg == &UCSR0B)
+        {
+            UCSR0B.raw() = value & ~(1 << RXB80);
+            if (!(value & (1 << RXEN0)))
+            {
+                // Turning the receiver off flushes it
+                receiver_.reset();
+                rxCount_ = 0;
+                rxOverrun_ = false;
+            }
+            return true;
+        }
+
+        if (reg == &UDR0)
+        {
+            if (!(UCSR0B.raw() & (1 << TXEN0)) || txDataFull_) return true;
+
+            // TXB8 is latched with the data
+            uint16_t frame = value;
+            if ((UCSR0B.raw() & (1 << UCSZ02)) && (UCSR0B.raw() & (1 << TXB80))) frame |= 0x100;
+
+            if (txShifting_)
+            {
+                txDataFull_ = true;
+                txData_ = frame;
+            }
+            else
+            {
+                startShift(frame, avr_.cycles());
+            }
+            return true;
+        }
+
+        return false;
+    }
+
+    UartMonitor::UartMonitor(Avr& avr, Pins& pins, PortName port, uint8_t pin, uint32_t baudRate, double skew):
+        pins_(pins),
+        port_(port),
+        pin_(pin),
+        bitCycles_((double)avr.getFCpu() / (baudRate * (1 + skew))),
+        receiver_()
+    {
+        avr.attach(this);
+        pins_.watch(this);
+    }
+
+    void UartMonitor::update(uint64_t now)
+    {
+        LineFrame frame;
+        if (receiver_.update(now, pins_.level(port_, pin_), bitCycles_, 8, false, frame)) frames.push_back(frame);
+    }
+}
@@ -0,0 +1,517 @@
+/**
+ * Event driven ATmega328P model for the host tests
+ *
+ * The clock only moves when the code under test busy waits (_delay_loop_2, Delay), sleeps, or
+ * the test calls advance(). On the way the peripherals set their flags at the cycle they would on
+ * the part, and any enabled interrupt runs then, if the global interrupt bit is set. Code between
+ * two waits takes no time, except for the modelled entry latency of each interrupt.
+ *
+ *     Sim::Avr avr(16000000);
+ *     Sim::Pins pins(avr);
+ *     pins.drive(Sim::PORT_D, 2, false);   // Pulls PD2 low, PCINT18 fires if enabled
+ *     avr.advance(1000);                   // Runs the handler, then on for 1000 cycles
+ */
+#ifndef HOST_SIM_AVR_HPP
+#define HOST_SIM_AVR_HPP
+
+#include <stdint.h>
+#include <vector>
+#include <math.h>
+#include "Sim.hpp"
+#include "drivers/timer/ITimer.hpp"
+
+namespace Sim
+{
+    const static uint64_t NEVER = UINT64_MAX;
+
+    typedef void (*Vector)(void);
+
+    class Avr;
+
+    /**
+     * A piece of hardware that sets flags over time
+     */
+    class Peripheral
+    {
+        public:
+            virtual ~Peripheral() {}
+
+            /**
+             * Bring the state up to cycle now, setting any flags that came due
+             */
+            virtual void update(uint64_t now) = 0;
+
+            /**
+             * @return  Cycle after the last update at which something next happens, or NEVER
+             */
+            virtual uint64_t nextEvent() = 0;
+
+            /**
+             * Take an enabled, pending interrupt, clearing its flag as entering the vector does
+             * @return  Vector to run, or nullptr if nothing is pending
+             */
+            virtual Vector takeInterrupt() { return nullptr; }
+
+            /**
+             * Register access, only called for registers the peripheral claims
+             * @return  True if the access was handled
+             */
+            virtual bool read(volatile uint8_t* reg, uint8_t& value) { (void)reg; (void)value; return false; }
+            virtual bool write(volatile uint8_t* reg, uint8_t value) { (void)reg; (void)value; return false; }
+            virtual bool read(volatile uint16_t* reg, uint16_t& value) { (void)reg; (void)value; return false; }
+            virtual bool write(volatile uint16_t* reg, uint16_t value) { (void)reg; (void)value; return false; }
+
+            /**
+             * Entry latency for this peripheral's interrupts, replacing the machine's default
+             */
+            void setInterruptLatency(uint32_t cycles) { latency_ = (int32_t)cycles; }
+            int32_t getInterruptLatency() { return latency_; }
+
+        private:
+            int32_t latency_ = -1;  // Negative for the machine's default
+    };
+
+    class Avr : public Machine
+    {
+        public:
+            /**
+             * Constructor, installs the machine for every register access until destroyed
+             * @param   fCpu    Clock frequency, only used to convert times for the tests
+             */
+            explicit Avr(uint32_t fCpu);
+            ~Avr();
+
+            uint32_t getFCpu() { return fCpu_; }
+
+            void attach(Peripheral* pPeripheral) { peripherals_.push_back(pPeripheral); }
+
+            /**
+             * Cycles from an interrupt flag being set to the handler being called, e.g. 4 cycles of
+             * response, 3 for the vector's jump, and the rest for the prologue and any calls down to
+             * the code of interest. 0 by default
+             */
+            void setInterruptLatency(uint32_t cycles) { defaultLatency_ = cycles; }
+
+            /**
+             * Cycles from a handler returning to the interrupted code carrying on, for the epilogue
+             * and the RETI. 0 by default
+             */
+            void setInterruptExitCycles(uint32_t cycles) { exitCycles_ = cycles; }
+
+            /**
+             * Cycles every register access through the machine takes, standing in for the
+             * instructions around it so that a loop polling a flag lets the clock run. 0 by default,
+             * where only waits and advance() move the clock
+             */
+            void setAccessCycles(uint32_t cycles) { accessCycles_ = cycles; }
+
+            /**
+             * Run the clock on, servicing interrupts when they come due
+             */
+            void advance(uint32_t cycles) { runUntil(cycles_ + cycles); }
+            void runUntil(uint64_t cycle);
+
+            /**
+             * Run until the next interrupt has been serviced, or until limit
+             * @return  False if nothing happened before limit
+             */
+            bool runUntilInterrupt(uint64_t limit);
+
+            /**
+             * Bring every peripheral up to the current cycle and run any interrupts that are due
+             */
+            void service();
+
+            /**
+             * @return  Number of interrupts run so far
+             */
+            uint64_t getInterruptCount() { return interruptCount_; }
+
+            /**
+             * @return  Cycles spent in interrupts so far, from each flag being taken to the code it
+             *          interrupted carrying on
+             */
+            uint64_t getInterruptCycles() { return interruptCycles_; }
+
+            uint8_t read(volatile uint8_t* reg) override;
+            void write(volatile uint8_t* reg, uint8_t value) override;
+            uint16_t read(volatile uint16_t* reg) override;
+            void write(volatile uint16_t* reg, uint16_t value) override;
+            void delay(uint32_t cycles) override { advance(cycles); }
+            void sleep() override;
+
+        private:
+            uint32_t fCpu_;
+            std::vector<Peripheral*> peripherals_;
+            uint32_t defaultLatency_;
+            uint32_t exitCycles_;
+            uint32_t accessCycles_;
+            bool dispatching_;
+            uint64_t interruptCount_;
+            uint64_t interruptCycles_;
+
+            /**
+             * Let the clock run for one register access
+             */
+            void access();
+
+            void sync(uint64_t now);
+            void dispatch();
+
+            /**
+             * Run the peripherals on to cycle without running interrupts, e.g. through an
+             * interrupt's entry
+             */
+            void step(uint64_t cycle);
+    };
+
+    enum PortName: uint8_t
+    {
+        PORT_B = 0,
+        PORT_C,
+        PORT_D,
+        NUM_PORTS
+    };
+
+    /**
+     * Ports B, C and D with their pin change interrupts
+     *
+     * PINx reads the pins: outputs read back PORTx, inputs read whatever drives them, or the
+     * pull-up if nothing does. The drivers reach DDRx, PORTx and PCMSKx through pointers that skip
+     * the machine, so those are picked up from the raw registers each time something changes.
+     */
+    class Pins : public Peripheral
+    {
+        public:
+            explicit Pins(Avr& avr);
+
+            /**
+             * Drive an input pin from outside, at the current cycle. A pin change interrupt it
+             * raises runs on the next register access or step of the clock, or service()
+             */
+            void drive(PortName port, uint8_t pin, bool high);
+
+            /**
+             * Stop driving an input pin, it floats back to its pull-up (or reads low without one)
+             */
+            void release(PortName port, uint8_t pin);
+
+            /**
+             * @return  Level the pin is at, driven from outside or by the part
+             */
+            bool level(PortName port, uint8_t pin);
+
+            /**
+             * Recompute PINx from PORTx, DDRx and the outside drivers, flagging pin changes
+             */
+            void refresh();
+
+            /**
+             * Have a peripheral updated as soon as any pin changes, whatever order they were
+             * attached in, e.g. a receiver that has to see a start bit at its edge
+             */
+            void watch(Peripheral* pWatcher) { watchers_.push_back(pWatcher); }
+
+            void update(uint64_t now) override { (void)now; refresh(); }
+            uint64_t nextEvent() override { return NEVER; }
+            Vector takeInterrupt() override;
+            bool read(volatile uint8_t* reg, uint8_t& value) override;
+            bool write(volatile uint8_t* reg, uint8_t value) override;
+
+        private:
+            Avr& avr_;
+            uint8_t driven_[NUM_PORTS];     // Pins driven from outside
+            uint8_t drivenHigh_[NUM_PORTS]; // Level of each driven pin
+            uint8_t lastPins_[NUM_PORTS];   // PINx as of the last refresh, for pin changes
+            std::vector<Peripheral*> watchers_;
+
+            int portOf(volatile uint8_t* reg, Reg8* const* regs);
+    };
+    /**
+     * A timer counting in CTC mode, as Atmega328Timer sets them up, behind the ITimer interface
+     *
+     * The counter steps on every prescale'th cycle of the free running prescaler, so the first
+     * step after reset() comes anywhere from 1 to prescale cycles later. The compare flag is set
+     * on the step that takes the counter past the top, top + 1 steps after it was 0. disable()
+     * only masks the interrupt, the counter keeps running and enable() clears a stale flag. The
+     * counter is as wide as getMaxPeriodTics(), 16 bits unless a subclass narrows it.
+     */
+    class CtcTimer : public Peripheral, public Timer::ITimer
+    {
+        public:
+            /**
+             * Constructor
+             * @param   avr         Machine to count on, the timer attaches itself
+             * @param   prescale    CPU cycles per count
+             */
+            CtcTimer(Avr& avr, uint16_t prescale);
+
+            uint32_t getTicksPerSecond() { return avr_.getFCpu() / prescale_; }
+            uint16_t getCount() { update(avr_.cycles()); return count_; }
+            bool isEnabled() { return enabled_; }
+
+            void enable() override;
+            void disable() override;
+            void setInterrupt(void (*interrupt)(void)) override { interrupt_ = interrupt; }
+            void setPeriodTics(uint16_t tics) override;
+            uint16_t microSecondsToTics(uint32_t microseconds) override;
+            void reset() override;
+
+            void update(uint64_t now) override;
+            uint64_t nextEvent() override;
+            Vector takeInterrupt() override;
+
+        private:
+            Avr& avr_;
+            uint16_t prescale_;
+            uint16_t top_;
+            uint16_t count_;
+            bool enabled_;
+            bool flag_;
+            uint64_t lastStep_;     // Prescaler steps up to the last update
+            void (*interrupt_)(void);
+
+            /**
+             * @return  Steps from the current count until the compare flag is set
+             */
+            uint32_t stepsToMatch();
+    };
+
+    /**
+     * CtcTimer with an 8 bit counter, like Timer0 and Timer2
+     */
+    class CtcTimer8 : public CtcTimer
+    {
+        public:
+            CtcTimer8(Avr& avr, uint16_t prescale): CtcTimer(avr, prescale) {}
+
+            uint16_t getMaxPeriodTics() override { return 0xFF; }
+    };
+
+    /**
+     * The far end of a serial line, sending 8N1 frames into an input pin
+     *
+     * The line may run at a skewed baud rate to model both ends' clock error. The start of every
+     * frame is recorded, so a test can tell where within each bit the receiver sampled.
+     */
+    class UartLine : public Peripheral
+    {
+        public:
+            /**
+             * Constructor, the line idles high
+             * @param   avr         Machine to send on, the line attaches itself
+             * @param   pins        Pins of the machine
+             * @param   port        Port of the receiving pin
+             * @param   pin         Receiving pin
+             * @param   baudRate    Nominal baud rate
+             * @param   skew        Fraction the sender's baud rate is off by, e.g. 0.02 for 2% fast
+             */
+            UartLine(Avr& avr, Pins& pins, PortName port, uint8_t pin, uint32_t baudRate, double skew = 0);
+
+            /**
+             * Queue bytes to send after those already queued
+             * @param   idleBits    Bit times the line stays idle before each of these frames
+             */
+            void send(const uint8_t* bytes, uint16_t numBytes, double idleBits = 0);
+
+            /**
+             * @return  True when every queued byte has been sent, including its stop bit
+             */
+            bool isIdle() { return (nextFrame_ >= frames_.size()) && (bit_ == 0); }
+
+            /**
+             * @return  Cycles per bit the line actually runs at
+             */
+            double getBitCycles() { return bitCycles_; }
+
+            /**
+             * @return  Cycle the start bit of the index'th frame began on, index counting every frame sent
+             */
+            double getFrameStart(uint32_t index) { return frames_[index].start; }
+            uint32_t getNumFramesStarted() { return nextFrame_; }
+
+            /**
+             * @return  Number of frames sent so far, including those still waiting to start
+             */
+            uint32_t getNumFramesQueued() { return frames_.size(); }
+
+            void update(uint64_t now) override;
+            uint64_t nextEvent() override;
+
+        private:
+            struct Frame
+            {
+                uint8_t byte;
+                double idleBits;
+                double start;   // Cycle the start bit began, set once it is sent
+            };
+
+            Avr& avr_;
+            Pins& pins_;
+            PortName port_;
+            uint8_t pin_;
+            double bitCycles_;
+            std::vector<Frame> frames_;
+            uint32_t nextFrame_;    // Frame being sent, or next to send when bit_ is 0
+            uint8_t bit_;           // Bit of the frame next to start, 0 when between frames
+            double lineFreeAt_;     // Cycle the last stop bit ends
+
+            double bitStart(uint8_t bit) { return frames_[nextFrame_].start + bit * bitCycles_; }
+    };
+
+    /**
+     * One frame seen on a serial line
+     */
+    struct LineFrame
+    {
+        uint16_t value;         // Data bits, the 9th bit included in 9 bit frames
+        uint64_t end;           // Cycle the stop bit was sampled
+        bool framingError;      // Stop bit was low
+        bool parityError;       // Even parity did not match
+    };
+
+    /**
+     * Receives frames from a pin by sampling each bit at its center, for the peripherals listening
+     * on a line. It must be updated at every change of the line, and at nextEvent()
+     */
+    class FrameReceiver
+    {
+        public:
+            FrameReceiver(): busy_(false), bitCycles_(0), dataBits_(8), parity_(false), start_(0), bit_(0), shift_(0) {}
+
+            /**
+             * Follow the line up to now
+             * @param   now         Current cycle
+             * @param   level       Level of the line at now
+             * @param   bitCycles   Cycles per bit, taken when a start bit begins
+             * @param   dataBits    8 or 9, taken when a start bit begins
+             * @param   parity      True for an even parity bit after the data, taken when a start bit begins
+             * @param   frame       Set to the frame completed at now
+             * @return  True if a frame was completed
+             */
+            bool update(uint64_t now, bool level, double bitCycles, uint8_t dataBits, bool parity, LineFrame& frame);
+
+            /**
+             * @return  Cycle of the next sample, or NEVER while waiting for a start bit
+             */
+            uint64_t nextEvent() { return busy_ ? sampleAt(bit_) : NEVER; }
+
+            /**
+             * Drop a frame being received and wait for the next start bit
+             */
+            void reset() { busy_ = false; }
+
+        private:
+            bool busy_;
+            double bitCycles_;
+            uint8_t dataBits_;
+            bool parity_;
+            double start_;      // Cycle the start bit began
+            uint8_t bit_;       // Bit of the frame sampled next, 0 for the start bit
+            uint16_t shift_;    // Data and parity bits received so far, LSB first
+
+            uint64_t sampleAt(uint8_t bit) { return (uint64_t)ceil(start_ + (bit + 0.5) * bitCycles_); }
+    };
+
+    /**
+     * USART0 in asynchronous mode, running from UBRR0 and U2X0
+     *
+     * Written bytes go through the data register and shift register and are recorded as they
+     * leave, with their 9th bit in 9 bit mode. RXD (PD0) is sampled like any other pin, so a
+     * UartLine on it sends to the USART, and an autobaud routine can read the same edges from
+     * PIND. Received frames go into a FIFO as deep as the part's, the data register, its second
+     * level and the shift register. A frame that finishes with the FIFO full is lost, and DOR is
+     * set on the next byte that is stored. Multi-processor mode drops data frames before they
+     * reach the FIFO.
+     */
+    class Usart : public Peripheral
+    {
+        public:
+            /**
+             * Constructor
+             * @param   avr     Machine to run on, the USART attaches itself
+             * @param   pins    Pins of the machine, RXD is read from them
+             */
+            Usart(Avr& avr, Pins& pins);
+
+            /**
+             * @return  Cycles per bit the USART runs at with the current UBRR0 and U2X0
+             */
+            double getBitCycles();
+
+            std::vector<LineFrame> sent;    // Every frame shifted out on TXD, in order
+
+            void update(uint64_t now) override;
+            uint64_t nextEvent() override;
+            Vector takeInterrupt() override;
+            bool read(volatile uint8_t* reg, uint8_t& value) override;
+            bool write(volatile uint8_t* reg, uint8_t value) override;
+
+        private:
+            const static uint8_t RX_FIFO_DEPTH = 3;
+
+            struct RxEntry
+            {
+                uint16_t value;
+                bool framingError;
+                bool parityError;
+                bool overrun;
+            };
+
+            Avr& avr_;
+            Pins& pins_;
+
+            bool txShifting_;
+            uint16_t txShift_;      // Frame being shifted out
+            uint64_t txShiftEnd_;   // Cycle its stop bit ends
+            bool txDataFull_;
+            uint16_t txData_;       // Frame waiting in the data register
+            bool txComplete_;       // TXC0
+
+            FrameReceiver receiver_;
+            RxEntry rxFifo_[RX_FIFO_DEPTH];
+            uint8_t rxCount_;
+            bool rxOverrun_;        // A frame was lost, flagged on the next stored one
+
+            uint8_t frameBits();
+            uint8_t dataBits();
+            bool parityEnabled();
+            void startShift(uint16_t frame, uint64_t start);
+    };
+
+    /**
+     * The far end of a serial line, receiving 8N1 frames from an output pin
+     *
+     * The pin is sampled at the center of each bit, at the far end's baud rate. The drivers set
+     * pins through the raw registers, so an edge is seen at the next register access, wait, or
+     * clock step, which is when the code setting it would next let time pass.
+     */
+    class UartMonitor : public Peripheral
+    {
+        public:
+            /**
+             * Constructor
+             * @param   avr         Machine to listen on, the monitor attaches itself
+             * @param   pins        Pins of the machine
+             * @param   port        Port of the sending pin
+             * @param   pin         Sending pin
+             * @param   baudRate    Nominal baud rate
+             * @param   skew        Fraction the far end's baud rate is off by, e.g. 0.02 for 2% fast
+             */
+            UartMonitor(Avr& avr, Pins& pins, PortName port, uint8_t pin, uint32_t baudRate, double skew = 0);
+
+            std::vector<LineFrame> frames;  // Every frame received, in order
+
+            void update(uint64_t now) override;
+            uint64_t nextEvent() override { return receiver_.nextEvent(); }
+
+        private:
+            Pins& pins_;
+            PortName port_;
+            uint8_t pin_;
+            double bitCycles_;
+            FrameReceiver receiver_;
+    };
+}
+
+#endif
@@ -0,0 +1,14 @@
+/**
+ * Host stand in for <avr/interrupt.h>
+ */
+#ifndef HOST_SIM_AVR_INTERRUPT_H
+#define HOST_SIM_AVR_INTERRUPT_H
+
+#include <avr/io.h>
+
+#define ISR(vector, ...) extern "C" void vector(void); extern "C" void vector(void)
+
+#define sei() (SREG = SREG | (1 << Sim::SREG_INTERRUPT_BIT))
+#define cli() (SREG.raw() &= (uint8_t)~(1 << Sim::SREG_INTERRUPT_BIT))
+
+#endif
@@ -0,0 +1,346 @@
+/**
+ * Host stand in for <avr/io.h>, an ATmega328P whose registers are Sim objects
+ */
+#ifndef HOST_SIM_AVR_IO_H
+#define HOST_SIM_AVR_IO_H
+
+#include <stdint.h>
+#include "Sim.hpp"
+
+#define SIM_REG8(name) extern Sim::Reg8 Sim_##name;
+#define SIM_REG16(name) extern Sim::Reg16 Sim_##name;
+#include "SimRegisters.def"
+#undef SIM_REG8
+#undef SIM_REG16
+
+#define _BV(bit) (1 << (bit))
+#define bit_is_set(reg, bit) ((reg) & _BV(bit))
+#define bit_is_clear(reg, bit) (!((reg) & _BV(bit)))
+
+// Registers, defined as macros like avr-libc does so #ifdef works on them
+#define PINB Sim_PINB
+#define DDRB Sim_DDRB
+#define PORTB Sim_PORTB
+#define PINC Sim_PINC
+#define DDRC Sim_DDRC
+#define PORTC Sim_PORTC
+#define PIND Sim_PIND
+#define DDRD Sim_DDRD
+#define PORTD Sim_PORTD
+#define TIFR0 Sim_TIFR0
+#define TIFR1 Sim_TIFR1
+#define TIFR2 Sim_TIFR2
+#define PCIFR Sim_PCIFR
+#define EIFR Sim_EIFR
+#define EIMSK Sim_EIMSK
+#define GPIOR0 Sim_GPIOR0
+#define GPIOR1 Sim_GPIOR1
+#define GPIOR2 Sim_GPIOR2
+#define EECR Sim_EECR
+#define EEDR Sim_EEDR
+#define EEAR Sim_EEAR
+#define GTCCR Sim_GTCCR
+#define TCCR0A Sim_TCCR0A
+#define TCCR0B Sim_TCCR0B
+#define TCNT0 Sim_TCNT0
+#define OCR0A Sim_OCR0A
+#define OCR0B Sim_OCR0B
+#define SPCR Sim_SPCR
+#define SPSR Sim_SPSR
+#define SPDR Sim_SPDR
+#define ACSR Sim_ACSR
+#define SMCR Sim_SMCR
+#define MCUSR Sim_MCUSR
+#define MCUCR Sim_MCUCR
+#define SPMCSR Sim_SPMCSR
+#define SPL Sim_SPL
+#define SPH Sim_SPH
+#define SREG Sim_SREG
+#define WDTCSR Sim_WDTCSR
+#define CLKPR Sim_CLKPR
+#define PRR Sim_PRR
+#define OSCCAL Sim_OSCCAL
+#define PCICR Sim_PCICR
+#define EICRA Sim_EICRA
+#define PCMSK0 Sim_PCMSK0
+#define PCMSK1 Sim_PCMSK1
+#define PCMSK2 Sim_PCMSK2
+#define TIMSK0 Sim_TIMSK0
+#define TIMSK1 Sim_TIMSK1
+#define TIMSK2 Sim_TIMSK2
+#define ADC Sim_ADC
+#define ADCW Sim_ADC
+#define ADCL Sim_ADCL
+#define ADCH Sim_ADCH
+#define ADCSRA Sim_ADCSRA
+#define ADCSRB Sim_ADCSRB
+#define ADMUX Sim_ADMUX
+#define DIDR0 Sim_DIDR0
+#define DIDR1 Sim_DIDR1
+#define TCCR1A Sim_TCCR1A
+#define TCCR1B Sim_TCCR1B
+#define TCCR1C Sim_TCCR1C
+#define TCNT1 Sim_TCNT1
+#define ICR1 Sim_ICR1
+#define OCR1A Sim_OCR1A
+#define OCR1B Sim_OCR1B
+#define OCR1AL Sim_OCR1AL
+#define OCR1AH Sim_OCR1AH
+#define TCCR2A Sim_TCCR2A
+#define TCCR2B Sim_TCCR2B
+#define TCNT2 Sim_TCNT2
+#define OCR2A Sim_OCR2A
+#define OCR2B Sim_OCR2B
+#define ASSR Sim_ASSR
+#define TWBR Sim_TWBR
+#define TWSR Sim_TWSR
+#define TWAR Sim_TWAR
+#define TWDR Sim_TWDR
+#define TWCR Sim_TWCR
+#define TWAMR Sim_TWAMR
+#define UCSR0A Sim_UCSR0A
+#define UCSR0B Sim_UCSR0B
+#define UCSR0C Sim_UCSR0C
+#define UBRR0L Sim_UBRR0L
+#define UBRR0H Sim_UBRR0H
+#define UDR0 Sim_UDR0
+
+// Status register
+#define SREG_C 0
+#define SREG_Z 1
+#define SREG_N 2
+#define SREG_V 3
+#define SREG_S 4
+#define SREG_H 5
+#define SREG_T 6
+#define SREG_I 7
+
+// Port pins
+#define PINB0 0
+#define PINB1 1
+#define PINB2 2
+#define PINB3 3
+#define PINB4 4
+#define PINB5 5
+#define PINB6 6
+#define PINB7 7
+#define PINC0 0
+#define PINC1 1
+#define PINC2 2
+#define PINC3 3
+#define PINC4 4
+#define PINC5 5
+#define PINC6 6
+#define PIND0 0
+#define PIND1 1
+#define PIND2 2
+#define PIND3 3
+#define PIND4 4
+#define PIND5 5
+#define PIND6 6
+#define PIND7 7
+
+// Timer/counter 0
+#define TOV0 0
+#define OCF0A 1
+#define OCF0B 2
+#define TOIE0 0
+#define OCIE0A 1
+#define OCIE0B 2
+#define WGM00 0
+#define WGM01 1
+#define COM0B0 4
+#define COM0B1 5
+#define COM0A0 6
+#define COM0A1 7
+#define CS00 0
+#define CS01 1
+#define CS02 2
+#define WGM02 3
+#define FOC0B 6
+#define FOC0A 7
+
+// Timer/counter 1
+#define TOV1 0
+#define OCF1A 1
+#define OCF1B 2
+#define ICF1 5
+#define TOIE1 0
+#define OCIE1A 1
+#define OCIE1B 2
+#define ICIE1 5
+#define WGM10 0
+#define WGM11 1
+#define COM1B0 4
+#define COM1B1 5
+#define COM1A0 6
+#define COM1A1 7
+#define CS10 0
+#define CS11 1
+#define CS12 2
+#define WGM12 3
+#define WGM13 4
+#define ICES1 6
+#define ICNC1 7
+#define FOC1B 6
+#define FOC1A 7
+
+// Timer/counter 2
+#define TOV2 0
+#define OCF2A 1
+#define OCF2B 2
+#define TOIE2 0
+#define OCIE2A 1
+#define OCIE2B 2
+#define WGM20 0
+#define WGM21 1
+#define COM2B0 4
+#define COM2B1 5
+#define COM2A0 6
+#define COM2A1 7
+#define CS20 0
+#define CS21 1
+#define CS22 2
+#define WGM22 3
+#define FOC2B 6
+#define FOC2A 7
+#define TCR2BUB 0
+#define TCR2AUB 1
+#define OCR2BUB 2
+#define OCR2AUB 3
+#define TCN2UB 4
+#define AS2 5
+#define EXCLK 6
+#define PSRSYNC 0
+#define PSRASY 1
+#define TSM 7
+
+// Pin change and external interrupts
+#define PCIE0 0
+#define PCIE1 1
+#define PCIE2 2
+#define PCIF0 0
+#define PCIF1 1
+#define PCIF2 2
+#define INT0 0
+#define INT1 1
+
+// EEPROM
+#define EERE 0
+#define EEPE 1
+#define EEMPE 2
+#define EERIE 3
+
+// SPI
+#define SPR0 0
+#define SPR1 1
+#define CPHA 2
+#define CPOL 3
+#define MSTR 4
+#define DORD 5
+#define SPE 6
+#define SPIE 7
+#define SPI2X 0
+#define WCOL 6
+#define SPIF 7
+
+// Sleep, reset and watchdog
+#define SE 0
+#define SM0 1
+#define SM1 2
+#define SM2 3
+#define PORF 0
+#define EXTRF 1
+#define BORF 2
+#define WDRF 3
+#define WDP0 0
+#define WDP1 1
+#define WDP2 2
+#define WDE 3
+#define WDCE 4
+#define WDP3 5
+#define WDIE 6
+#define WDIF 7
+
+// ADC
+#define ADPS0 0
+#define ADPS1 1
+#define ADPS2 2
+#define ADIE 3
+#define ADIF 4
+#define ADATE 5
+#define ADSC 6
+#define ADEN 7
+#define MUX0 0
+#define MUX1 1
+#define MUX2 2
+#define MUX3 3
+#define ADLAR 5
+#define REFS0 6
+#define REFS1 7
+
+// TWI
+#define TWIE 0
+#define TWEN 2
+#define TWWC 3
+#define TWSTO 4
+#define TWSTA 5
+#define TWEA 6
+#define TWINT 7
+#define TWPS0 0
+#define TWPS1 1
+
+// USART0
+#define MPCM0 0
+#define U2X0 1
+#define UPE0 2
+#define DOR0 3
+#define FE0 4
+#define UDRE0 5
+#define TXC0 6
+#define RXC0 7
+#define TXB80 0
+#define RXB80 1
+#define UCSZ02 2
+#define TXEN0 3
+#define RXEN0 4
+#define UDRIE0 5
+#define TXCIE0 6
+#define RXCIE0 7
+#define UCPOL0 0
+#define UCSZ00 1
+#define UCSZ01 2
+#define USBS0 3
+#define UPM00 4
+#define UPM01 5
+#define UMSEL00 6
+#define UMSEL01 7
+
+// Interrupt vectors, each ISR() defines an extern "C" function with the vector's name
+#define INT0_vect Sim_INT0_vect
+#define INT1_vect Sim_INT1_vect
+#define PCINT0_vect Sim_PCINT0_vect
+#define PCINT1_vect Sim_PCINT1_vect
+#define PCINT2_vect Sim_PCINT2_vect
+#define WDT_vect Sim_WDT_vect
+#define TIMER2_COMPA_vect Sim_TIMER2_COMPA_vect
+#define TIMER2_COMPB_vect Sim_TIMER2_COMPB_vect
+#define TIMER2_OVF_vect Sim_TIMER2_OVF_vect
+#define TIMER1_CAPT_vect Sim_TIMER1_CAPT_vect
+#define TIMER1_COMPA_vect Sim_TIMER1_COMPA_vect
+#define TIMER1_COMPB_vect Sim_TIMER1_COMPB_vect
+#define TIMER1_OVF_vect Sim_TIMER1_OVF_vect
+#define TIMER0_COMPA_vect Sim_TIMER0_COMPA_vect
+#define TIMER0_COMPB_vect Sim_TIMER0_COMPB_vect
+#define TIMER0_OVF_vect Sim_TIMER0_OVF_vect
+#define SPI_STC_vect Sim_SPI_STC_vect
+#define USART_RX_vect Sim_USART_RX_vect
+#define USART_UDRE_vect Sim_USART_UDRE_vect
+#define USART_TX_vect Sim_USART_TX_vect
+#define ADC_vect Sim_ADC_vect
+#define EE_READY_vect Sim_EE_READY_vect
+#define ANALOG_COMP_vect Sim_ANALOG_COMP_vect
+#define TWI_vect Sim_TWI_vect
+#define SPM_READY_vect Sim_SPM_READY_vect
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * Host stand in for <avr/pgmspace.h>, flash and RAM are the same address space here
+ */
+#ifndef HOST_SIM_AVR_PGMSPACE_H
+#define HOST_SIM_AVR_PGMSPACE_H
+
+#include <stdint.h>
+#include <string.h>
+
+#define PROGMEM
+#define PSTR(s) (s)
+#define pgm_read_byte(address) (*(const uint8_t*)(address))
+#define pgm_read_word(address) (*(const uint16_t*)(address))
+#define pgm_read_dword(address) (*(const uint32_t*)(address))
+#define pgm_read_ptr(address) (*(void* const*)(address))
+#define memcpy_P memcpy
+#define strlen_P strlen
+
+#endif
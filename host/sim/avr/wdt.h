@@ -0,0 +1,32 @@
+/**
+ * Host stand in for <avr/wdt.h>, resets are counted in WDTCSR's place by the machine if it cares
+ */
+#ifndef HOST_SIM_AVR_WDT_H
+#define HOST_SIM_AVR_WDT_H
+
+#include <avr/io.h>
+
+#define WDTO_15MS 0
+#define WDTO_30MS 1
+#define WDTO_60MS 2
+#define WDTO_120MS 3
+#define WDTO_250MS 4
+#define WDTO_500MS 5
+#define WDTO_1S 6
+#define WDTO_2S 7
+#define WDTO_4S 8
+#define WDTO_8S 9
+
+namespace Sim
+{
+    /**
+     * @return  Number of wdt_reset() calls so far
+     */
+    uint32_t& watchdogResets();
+}
+
+#define wdt_reset() (Sim::watchdogResets()++)
+#define wdt_enable(timeout) (WDTCSR = (uint8_t)(_BV(WDE) | ((timeout) & 0x07) | (((timeout) & 0x08) ? _BV(WDP3) : 0)))
+#define wdt_disable() (WDTCSR = 0)
+
+#endif
@@ -0,0 +1,31 @@
+/**
+ * Host stand in for <util/atomic.h>
+ */
+#ifndef HOST_SIM_UTIL_ATOMIC_H
+#define HOST_SIM_UTIL_ATOMIC_H
+
+#include <avr/interrupt.h>
+
+namespace Sim
+{
+    // Interrupts off for the block, then back to how they were
+    struct AtomicRestoreState
+    {
+        uint8_t sreg;
+        AtomicRestoreState(): sreg(SREG) { cli(); }
+        ~AtomicRestoreState() { SREG = sreg; }
+    };
+
+    // Interrupts off for the block, then on
+    struct AtomicForceOn
+    {
+        AtomicForceOn() { cli(); }
+        ~AtomicForceOn() { sei(); }
+    };
+}
+
+#define ATOMIC_RESTORESTATE Sim::AtomicRestoreState
+#define ATOMIC_FORCEON Sim::AtomicForceOn
+#define ATOMIC_BLOCK(type) for (type simAtomicGuard, *pSimAtomicOnce = &simAtomicGuard; pSimAtomicOnce != nullptr; pSimAtomicOnce = nullptr)
+
+#endif
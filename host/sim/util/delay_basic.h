@@ -0,0 +1,22 @@
+/**
+ * Host stand in for <util/delay_basic.h>, the busy loops move the machine's clock on instead
+ */
+#ifndef HOST_SIM_UTIL_DELAY_BASIC_H
+#define HOST_SIM_UTIL_DELAY_BASIC_H
+
+#include <stdint.h>
+#include "Sim.hpp"
+
+// 3 cycles per count, 0 is 256 counts
+inline void _delay_loop_1(uint8_t count)
+{
+    Sim::machine().delay(3 * ((count == 0) ? 256u : count));
+}
+
+// 4 cycles per count, 0 is 65536 counts
+inline void _delay_loop_2(uint16_t count)
+{
+    Sim::machine().delay(4 * ((count == 0) ? 65536u : count));
+}
+
+#endif
@@ -0,0 +1,55 @@
+/**
+ * Host stand in for the utilities circular queue, a fixed size FIFO over a caller's buffer
+ */
+#ifndef HOST_SIM_CIRCULAR_QUEUE_HPP
+#define HOST_SIM_CIRCULAR_QUEUE_HPP
+
+#include <stdint.h>
+
+template <typename T>
+class CircularQueue
+{
+    public:
+        CircularQueue(T* buffer, uint16_t length, bool overwrite = false):
+            buffer_(buffer), length_(length), head_(0), count_(0), overwrite_(overwrite)
+        {}
+
+        bool isEmpty() { return count_ == 0; }
+        bool isFull() { return count_ == length_; }
+        uint16_t length() { return count_; }
+
+        void push(T value)
+        {
+            if (isFull())
+            {
+                if (!overwrite_) return;
+                pop();
+            }
+            buffer_[(head_ + count_) % length_] = value;
+            count_++;
+        }
+
+        T pop()
+        {
+            if (isEmpty()) return T();
+            T value = buffer_[head_];
+            head_ = (head_ + 1) % length_;
+            count_--;
+            return value;
+        }
+
+        void flush()
+        {
+            head_ = 0;
+            count_ = 0;
+        }
+
+    private:
+        T* buffer_;
+        uint16_t length_;
+        volatile uint16_t head_;
+        volatile uint16_t count_;
+        bool overwrite_;
+};
+
+#endif
@@ -0,0 +1,19 @@
+/**
+ * Host stand in for the print utilities
+ *
+ * Output is dropped. PRINT_FLUSH() is only reached on the way into assertCustom's endless loop,
+ * so here it throws HostSim::AssertFailed instead and tests can check that an assert fired.
+ */
+#ifndef HOST_SIM_PRINT_HPP
+#define HOST_SIM_PRINT_HPP
+
+namespace HostSim
+{
+    struct AssertFailed {};
+}
+
+#define PRINT(...)
+#define PRINTLN(...)
+#define PRINT_FLUSH() throw HostSim::AssertFailed()
+
+#endif
@@ -0,0 +1,175 @@
+/**
+ * BinaryLog draining into a driver that is short of room
+ *
+ * The fake driver takes bytes up to the room the test gives it. Packets are decoded by a second
+ * PacketSerial reading the same bytes back, and split into records the way log_decoder.py does.
+ */
+#include <vector>
+#include "drivers/log/BinaryLog.hpp"
+#include "HostTest.hpp"
+
+using SerialComm::PacketSerial;
+
+namespace
+{
+    class FakeSerial : public SerialComm::ISerial
+    {
+        public:
+            FakeSerial(): room(0), readIndex_(0) {}
+
+            uint16_t write(const uint8_t* buff, uint16_t numBytes) override
+            {
+                uint16_t accepted = (numBytes < room) ? numBytes : room;
+                wire.insert(wire.end(), buff, buff + accepted);
+                room -= accepted;
+                return accepted;
+            }
+
+            uint16_t read(uint8_t* buff, uint16_t numBytes) override
+            {
+                uint16_t count = 0;
+                while ((count < numBytes) && (readIndex_ < wire.size())) buff[count++] = wire[readIndex_++];
+                return count;
+            }
+
+            uint16_t getTxSpace() override { return room; }
+
+            std::vector<uint8_t> wire;  // Every byte accepted, in order
+            uint16_t room;              // Bytes the driver takes before it is full
+
+        private:
+            uint32_t readIndex_;
+    };
+
+    struct Receiver
+    {
+        Receiver(FakeSerial* pSerial): packets(pSerial, rxBuffer, sizeof(rxBuffer)), numPackets(0) {}
+
+        // Collect every record sent so far, checking each packet splits into whole records
+        void collect()
+        {
+            const uint8_t* pPacket;
+            uint16_t length;
+            while ((length = packets.receivePacket(&pPacket)) != 0)
+            {
+                CHECK(length <= Log::LOG_MAX_PACKET);
+                numPackets++;
+                uint16_t index = 0;
+                while (index < length)
+                {
+                    uint8_t recordLength = pPacket[index];
+                    CHECK_EQUAL(recordLength, sizeof(uint16_t) + sizeof(int));
+                    if (index + 1 + recordLength > length) break;
+                    int value;
+                    memcpy(&value, &pPacket[index + 1 + sizeof(uint16_t)], sizeof(value));
+                    values.push_back(value);
+                    index += 1 + recordLength;
+                }
+                CHECK_EQUAL(index, length);
+            }
+        }
+
+        uint8_t rxBuffer[128];
+        PacketSerial packets;
+        std::vector<int> values;    // Argument of each record received, in order
+        uint32_t numPackets;
+    };
+
+    void checkInOrder(const std::vector<int>& values, int count)
+    {
+        CHECK_EQUAL(values.size(), (size_t)count);
+        for (int i=0; (i<count) && (i<(int)values.size()); i++) CHECK_EQUAL(values[i], i);
+    }
+
+    /**
+     * With room to spare several records go in each packet
+     */
+    void testBatching()
+    {
+        FakeSerial serial;
+        serial.room = 1000;
+        uint8_t senderRx[16];
+        PacketSerial sender(&serial, senderRx, sizeof(senderRx));
+        uint8_t buffer[128];
+        Log::BinaryLog log(&sender, buffer, sizeof(buffer));
+        Receiver receiver(&serial);
+
+        const int COUNT = 16;
+        for (int i=0; i<COUNT; i++) log.log("value %d", i);
+        log.drain();
+        receiver.collect();
+
+        checkInOrder(receiver.values, COUNT);
+        CHECK(receiver.numPackets <= 2);
+        CHECK_EQUAL(log.getDroppedRecords(), 0);
+    }
+
+    /**
+     * A busy driver gets only what it has room for, and the rest waits in the ring rather than
+     * being dropped or blocking
+     */
+    void testBusyDriver()
+    {
+        FakeSerial serial;
+        uint8_t senderRx[16];
+        PacketSerial sender(&serial, senderRx, sizeof(senderRx));
+        uint8_t buffer[128];
+        Log::BinaryLog log(&sender, buffer, sizeof(buffer));
+        Receiver receiver(&serial);
+
+        const int COUNT = 12;
+        for (int i=0; i<COUNT; i++) log.log("value %d", i);
+
+        // Not enough for a single record
+        serial.room = 10;
+        log.drain();
+        CHECK(serial.wire.empty());
+        CHECK_EQUAL(serial.room, 10);
+
+        // Room frees up a little at a time
+        for (uint16_t round=0; (round<100) && (receiver.values.size() < COUNT); round++)
+        {
+            serial.room += 20;
+            uint16_t before = serial.room;
+            log.drain();
+            CHECK(serial.room <= before);
+            receiver.collect();
+        }
+
+        checkInOrder(receiver.values, COUNT);
+        CHECK(receiver.numPackets < COUNT);
+        CHECK_EQUAL(log.getDroppedRecords(), 0);
+        CHECK_EQUAL(sender.getTxFailures(), 0);
+    }
+
+    /**
+     * maxRecords caps each call, however much room there is
+     */
+    void testMaxRecords()
+    {
+        FakeSerial serial;
+        serial.room = 1000;
+        uint8_t senderRx[16];
+        PacketSerial sender(&serial, senderRx, sizeof(senderRx));
+        uint8_t buffer[128];
+        Log::BinaryLog log(&sender, buffer, sizeof(buffer));
+        Receiver receiver(&serial);
+
+        const int COUNT = 10;
+        for (int i=0; i<COUNT; i++) log.log("value %d", i);
+        log.drain(3);
+        receiver.collect();
+        CHECK_EQUAL(receiver.values.size(), 3);
+        log.drain();
+        receiver.collect();
+        checkInOrder(receiver.values, COUNT);
+    }
+}
+
+int main()
+{
+    testBatching();
+    testBusyDriver();
+    testMaxRecords();
+    return HostTest::result();
+}
@@ -0,0 +1,115 @@
+/**
+ * Minimal checks for the host tests, each test is its own executable and ctest runs it
+ *
+ *     CHECK(ring.isEmpty());
+ *     CHECK_EQUAL(ring.length(), 3);
+ *     return HostTest::result();
+ */
+#ifndef HOST_TEST_HPP
+#define HOST_TEST_HPP
+
+#include <stdio.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+namespace HostTest
+{
+    inline uint32_t& failures()
+    {
+        static uint32_t count = 0;
+        return count;
+    }
+
+    inline bool check(bool passed, const char* expression, const char* file, int line)
+    {
+        if (!passed)
+        {
+            fprintf(stderr, "%s:%d: check failed: %s\n", file, line, expression);
+            failures()++;
+        }
+        return passed;
+    }
+
+    inline bool checkEqual(long long actual, long long expected, const char* expression, const char* file, int line)
+    {
+        if (actual != expected)
+        {
+            fprintf(stderr, "%s:%d: check failed: %s, got %lld expected %lld\n", file, line, expression, actual, expected);
+            failures()++;
+        }
+        return actual == expected;
+    }
+
+    /**
+     * @return  Exit code for main(), non-zero if any check failed
+     */
+    inline int result()
+    {
+        if (failures() != 0)
+        {
+            fprintf(stderr, "%u check(s) failed\n", (unsigned)failures());
+            return 1;
+        }
+        return 0;
+    }
+
+    /**
+     * Run part of a test in a child process, for drivers whose static tables only take a few
+     * instances per program. A failed check, assert or crash in the child fails the test
+     * @param   name        Printed if the part fails
+     * @param   function    Part to run, e.g. a lambda
+     */
+    template <typename Function>
+    void runIsolated(const char* name, Function function)
+    {
+        fflush(stdout);
+        fflush(stderr);
+        pid_t pid = fork();
+        if (pid == 0)
+        {
+            failures() = 0;
+            function();
+            fflush(stdout);
+            fflush(stderr);
+            _exit(result());
+        }
+
+        int status = 0;
+        if ((pid < 0) || (waitpid(pid, &status, 0) != pid) || !WIFEXITED(status) || (WEXITSTATUS(status) != 0))
+        {
+            fprintf(stderr, "%s failed\n", name);
+            failures()++;
+        }
+    }
+
+    /**
+     * Small deterministic generator, so a failing run can be repeated exactly
+     */
+    class Random
+    {
+        public:
+            explicit Random(uint32_t seed): state_(seed ? seed : 1) {}
+
+            uint32_t next()
+            {
+                state_ ^= state_ << 13;
+                state_ ^= state_ >> 17;
+                state_ ^= state_ << 5;
+                return state_;
+            }
+
+            /**
+             * @return  Value from 0 to range - 1
+             */
+            uint32_t below(uint32_t range) { return next() % range; }
+
+        private:
+            uint32_t state_;
+    };
+}
+
+#define CHECK(expression) HostTest::check((expression), #expression, __FILE__, __LINE__)
+#define CHECK_EQUAL(actual, expected) HostTest::checkEqual((long long)(actual), (long long)(expected), #actual " == " #expected, __FILE__, __LINE__)
+
+#endif
@@ -0,0 +1,353 @@
+/**
+ * ModbusSlave answering a master stand-in
+ *
+ * The master puts each request into the fake driver's RX side a byte at a time, calling
+ * HandleByteReceived as the driver's byte callback would, then fires HandleFrameGap for the end of
+ * frame. The driver sends one byte per tic of the clock, a tic passing each time it is polled for
+ * room or the master waits for the wire to go quiet, so the time from the gap to the last byte of
+ * the answer leaving is the slave's response time on the bus. Each test runs in its own process,
+ * the slave owns static callbacks.
+ */
+#include <vector>
+#include "drivers/modbus/ModbusSlave.hpp"
+#include "drivers/serial/Crc16.hpp"
+#include "drivers/timer/SoftwareTimer.hpp"
+#include "HostTest.hpp"
+
+using namespace Modbus;
+
+namespace
+{
+    const uint32_t TICS_PER_SECOND = 10000;     // One byte per tic is about 100k baud
+    const uint32_t BAUD_RATE = 115200;
+    const uint16_t TIMEOUT_MS = 50;
+    const uint8_t SLAVE_ADDRESS = 17;
+    const uint8_t FRAME_QUEUE_LENGTH = 4;       // Frames the slave queues between updates
+
+    class BusSerial : public SerialComm::ISerial
+    {
+        public:
+            BusSerial(uint16_t capacity, uint16_t sentPerTic, Tic::TicCounter* pTics):
+                lastByteOutTic(0), capacity_(capacity), sentPerTic_(sentPerTic), queued_(0), rxIndex_(0), pTics_(pTics) {}
+
+            uint16_t write(const uint8_t* buff, uint16_t numBytes) override
+            {
+                uint16_t space = capacity_ - queued_;
+                uint16_t accepted = (numBytes < space) ? numBytes : space;
+                wire.insert(wire.end(), buff, buff + accepted);
+                queued_ += accepted;
+                return accepted;
+            }
+
+            uint16_t read(uint8_t* buff, uint16_t numBytes) override
+            {
+                uint16_t count = 0;
+                while ((count < numBytes) && (rxIndex_ < rx.size())) buff[count++] = rx[rxIndex_++];
+                return count;
+            }
+
+            uint16_t getTxSpace() override
+            {
+                tick();
+                return capacity_ - queued_;
+            }
+
+            /**
+             * Let time pass until everything queued has gone out
+             */
+            void drain()
+            {
+                while (queued_ > 0) tick();
+            }
+
+            void setSentPerTic(uint16_t sentPerTic) { sentPerTic_ = sentPerTic; }
+
+            std::vector<uint8_t> rx;    // Bytes from the master, read by the slave
+            std::vector<uint8_t> wire;  // Every byte the slave sent, in order
+            uint32_t lastByteOutTic;    // Tic the last byte sent left the driver
+
+        private:
+            uint16_t capacity_;
+            uint16_t sentPerTic_;
+            uint16_t queued_;
+            uint32_t rxIndex_;
+            Tic::TicCounter* pTics_;
+
+            void tick()
+            {
+                pTics_->incrementTicCount();
+                if (queued_ == 0) return;
+                queued_ = (queued_ > sentPerTic_) ? (queued_ - sentPerTic_) : 0;
+                if (queued_ == 0) lastByteOutTic = pTics_->getTicCount();
+            }
+    };
+
+    /**
+     * Gap timer, the master fires the gap itself once it sees the timer running
+     */
+    class GapTimer : public Timer::ITimer
+    {
+        public:
+            GapTimer(): enabled(false), top(0), interrupt(nullptr) {}
+
+            void enable() override { enabled = true; }
+            void disable() override { enabled = false; }
+            void setInterrupt(void (*pInterrupt)(void)) override { interrupt = pInterrupt; }
+            void setPeriodTics(uint16_t tics) override { top = tics; }
+            uint16_t microSecondsToTics(uint32_t microseconds) override { return (uint16_t)microseconds; }
+            void reset() override {}
+
+            bool enabled;
+            uint16_t top;
+            void (*interrupt)(void);
+    };
+
+    struct Bus
+    {
+        Bus(uint16_t capacity, bool withTimeout):
+            tics(TICS_PER_SECOND),
+            timeout(0, &tics),
+            serial(capacity, 1, &tics),
+            holding(),
+            input(),
+            slave(&serial, SLAVE_ADDRESS, { holding, NUM_HOLDING, input, NUM_INPUT, onWrite },
+                  frameBuffer, sizeof(frameBuffer), &gapTimer, 1000000, BAUD_RATE),
+            worstResponseTics(0)
+        {
+            for (uint16_t i=0; i<NUM_INPUT; i++) input[i] = 0x1000 + i;
+            slave.initialize();
+            if (withTimeout) slave.setTimeoutTimer(&timeout, TIMEOUT_MS);
+            writes().clear();
+        }
+
+        // Send a frame without calling update(), as if the main loop were busy
+        void sendFrame(std::vector<uint8_t> frame, bool goodCrc = true)
+        {
+            uint16_t crc = SerialComm::crc16(frame.data(), frame.size());
+            if (!goodCrc) crc ^= 0x0101;
+            frame.push_back((uint8_t)crc);
+            frame.push_back((uint8_t)(crc >> 8));
+
+            for (uint8_t byte : frame)
+            {
+                serial.rx.push_back(byte);
+                ModbusSlave::HandleByteReceived();
+                CHECK(gapTimer.enabled);
+            }
+            CHECK(gapTimer.interrupt == ModbusSlave::HandleFrameGap);
+            gapTimer.interrupt();
+            CHECK(!gapTimer.enabled);
+        }
+
+        /**
+         * Let the slave answer everything sent so far, timing it
+         * @return  Bytes sent back since the last call
+         */
+        std::vector<uint8_t> answer()
+        {
+            size_t before = serial.wire.size();
+            uint32_t gapTic = tics.getTicCount();
+            slave.update();
+            serial.drain();
+
+            if (serial.wire.size() > before)
+            {
+                uint32_t response = serial.lastByteOutTic - gapTic;
+                if (response > worstResponseTics) worstResponseTics = response;
+            }
+            return std::vector<uint8_t>(serial.wire.begin() + before, serial.wire.end());
+        }
+
+        std::vector<uint8_t> transact(const std::vector<uint8_t>& request, bool goodCrc = true)
+        {
+            sendFrame(request, goodCrc);
+            return answer();
+        }
+
+        static std::vector<std::pair<uint16_t, uint16_t>>& writes()
+        {
+            static std::vector<std::pair<uint16_t, uint16_t>> list;
+            return list;
+        }
+
+        static void onWrite(uint16_t firstRegister, uint16_t numRegisters)
+        {
+            writes().push_back(std::make_pair(firstRegister, numRegisters));
+        }
+
+        static const uint16_t NUM_HOLDING = 130;
+        static const uint16_t NUM_INPUT = 8;
+
+        Tic::TicCounter tics;
+        Timer::SoftwareTimer timeout;
+        BusSerial serial;
+        GapTimer gapTimer;
+        uint16_t holding[NUM_HOLDING];
+        uint16_t input[NUM_INPUT];
+        uint8_t frameBuffer[MODBUS_MAX_FRAME];
+        ModbusSlave slave;
+        uint32_t worstResponseTics;
+    };
+
+    std::vector<uint8_t> request(uint8_t function, uint16_t first, uint16_t second, uint8_t address = SLAVE_ADDRESS)
+    {
+        return { address, function, (uint8_t)(first >> 8), (uint8_t)first, (uint8_t)(second >> 8), (uint8_t)second };
+    }
+
+    /**
+     * Check an answer's address and CRC
+     * @return  The answer's PDU, empty if the frame is bad
+     */
+    std::vector<uint8_t> checkFrame(const std::vector<uint8_t>& frame)
+    {
+        if (!CHECK(frame.size() >= 4)) return std::vector<uint8_t>();
+        CHECK_EQUAL(frame[0], SLAVE_ADDRESS);
+        uint16_t crc = frame[frame.size() - 2] | ((uint16_t)frame[frame.size() - 1] << 8);
+        if (!CHECK_EQUAL(crc, SerialComm::crc16(frame.data(), frame.size() - 2))) return std::vector<uint8_t>();
+        return std::vector<uint8_t>(frame.begin() + 1, frame.end() - 2);
+    }
+
+    void checkException(const std::vector<uint8_t>& frame, uint8_t function, ModbusException exception)
+    {
+        std::vector<uint8_t> pdu = checkFrame(frame);
+        if (!CHECK_EQUAL(pdu.size(), 2)) return;
+        CHECK_EQUAL(pdu[0], function | 0x80);
+        CHECK_EQUAL(pdu[1], exception);
+    }
+
+    void checkReadAnswer(const std::vector<uint8_t>& frame, uint8_t function, const uint16_t* expected, uint16_t quantity)
+    {
+        std::vector<uint8_t> pdu = checkFrame(frame);
+        if (!CHECK_EQUAL(pdu.size(), 2u + (2u * quantity))) return;
+        CHECK_EQUAL(pdu[0], function);
+        CHECK_EQUAL(pdu[1], 2 * quantity);
+        for (uint16_t i=0; i<quantity; i++)
+        {
+            CHECK_EQUAL(((uint16_t)pdu[2 + (2 * i)] << 8) | pdu[3 + (2 * i)], expected[i]);
+        }
+    }
+
+    /**
+     * Every function and exception, with answers up to the longest one going through a driver buffer
+     * much shorter than them
+     */
+    void testFunctions()
+    {
+        Bus bus(16, true);
+
+        // Write single register, answered with an echo of the request
+        std::vector<uint8_t> writeSingle = request(0x06, 3, 0xBEEF);
+        std::vector<uint8_t> pdu = checkFrame(bus.transact(writeSingle));
+        CHECK(pdu == std::vector<uint8_t>(writeSingle.begin() + 1, writeSingle.end()));
+        CHECK_EQUAL(bus.holding[3], 0xBEEF);
+        CHECK(Bus::writes().back() == std::make_pair((uint16_t)3, (uint16_t)1));
+
+        // Write multiple registers, answered with the start and quantity
+        std::vector<uint8_t> writeMultiple = request(0x10, 10, 120);
+        writeMultiple.push_back(240);
+        for (uint16_t i=0; i<120; i++)
+        {
+            writeMultiple.push_back((uint8_t)(i >> 8));
+            writeMultiple.push_back((uint8_t)(0x40 + i));
+        }
+        pdu = checkFrame(bus.transact(writeMultiple));
+        CHECK(pdu == std::vector<uint8_t>(writeMultiple.begin() + 1, writeMultiple.begin() + 6));
+        for (uint16_t i=0; i<120; i++) CHECK_EQUAL(bus.holding[10 + i], (uint8_t)(0x40 + i));
+        CHECK(Bus::writes().back() == std::make_pair((uint16_t)10, (uint16_t)120));
+
+        // Read holding registers, up to the most a frame takes
+        checkReadAnswer(bus.transact(request(0x03, 3, 1)), 0x03, &bus.holding[3], 1);
+        checkReadAnswer(bus.transact(request(0x03, 5, 125)), 0x03, &bus.holding[5], 125);
+
+        // Read input registers
+        checkReadAnswer(bus.transact(request(0x04, 2, 6)), 0x04, &bus.input[2], 6);
+
+        // Exceptions
+        checkException(bus.transact(request(0x05, 0, 0xFF00)), 0x05, EXCEPTION_ILLEGAL_FUNCTION);
+        checkException(bus.transact(request(0x03, 129, 2)), 0x03, EXCEPTION_ILLEGAL_DATA_ADDRESS);
+        checkException(bus.transact(request(0x04, 0, Bus::NUM_INPUT + 1)), 0x04, EXCEPTION_ILLEGAL_DATA_ADDRESS);
+        checkException(bus.transact(request(0x03, 0, 0)), 0x03, EXCEPTION_ILLEGAL_DATA_VALUE);
+        checkException(bus.transact(request(0x03, 0, 126)), 0x03, EXCEPTION_ILLEGAL_DATA_VALUE);
+        checkException(bus.transact(request(0x06, Bus::NUM_HOLDING, 1)), 0x06, EXCEPTION_ILLEGAL_DATA_ADDRESS);
+        std::vector<uint8_t> badCount = request(0x10, 0, 2);
+        badCount.push_back(3);
+        badCount.insert(badCount.end(), { 0, 1, 0, 2 });
+        checkException(bus.transact(badCount), 0x10, EXCEPTION_ILLEGAL_DATA_VALUE);
+        CHECK_EQUAL(bus.slave.getExceptions(), 7);
+
+        // Other slaves' frames and broadcasts get no answer, broadcasts are still applied
+        CHECK(bus.transact(request(0x03, 0, 1, SLAVE_ADDRESS + 1)).empty());
+        CHECK(bus.transact(request(0x06, 0, 0x1234, 0)).empty());
+        CHECK_EQUAL(bus.holding[0], 0x1234);
+
+        // Bad CRC and too short frames are dropped
+        CHECK(bus.transact(request(0x03, 0, 1), false).empty());
+        CHECK(bus.transact({ SLAVE_ADDRESS }, true).empty());
+        CHECK_EQUAL(bus.slave.getBadFrames(), 2);
+        CHECK_EQUAL(bus.slave.getTxFailures(), 0);
+
+        // The longest answer is 255 bytes. Waiting on room must not add to the time the bytes
+        // themselves take, beyond the tic the answer starts on
+        const uint32_t LONGEST_ANSWER = 1 + 2 + 250 + 2;
+        printf("worst response %u tics (%.1f ms at %u bytes/s) for a %u byte answer\n",
+               (unsigned)bus.worstResponseTics, bus.worstResponseTics * 1000.0 / TICS_PER_SECOND,
+               (unsigned)TICS_PER_SECOND, (unsigned)LONGEST_ANSWER);
+        CHECK(bus.worstResponseTics <= LONGEST_ANSWER + 1);
+    }
+
+    /**
+     * Frames beyond what the queue holds before update() are merged into the next one, which fails
+     * its CRC, and the frames after that line up again
+     */
+    void testQueueOverflow()
+    {
+        Bus bus(256, false);
+        for (uint8_t i=0; i<=FRAME_QUEUE_LENGTH; i++) bus.sendFrame(request(0x06, i, 0x100 + i));
+
+        std::vector<uint8_t> answers = bus.answer();
+        CHECK_EQUAL(answers.size(), FRAME_QUEUE_LENGTH * 8);
+        for (uint8_t i=0; i<FRAME_QUEUE_LENGTH; i++) CHECK_EQUAL(bus.holding[i], 0x100 + i);
+        CHECK_EQUAL(bus.holding[FRAME_QUEUE_LENGTH], 0);
+
+        // The frame left over is merged with the next
+        CHECK(bus.transact(request(0x06, 20, 0x20)).empty());
+        CHECK_EQUAL(bus.slave.getBadFrames(), 1);
+        CHECK_EQUAL(bus.holding[20], 0);
+
+        checkReadAnswer(bus.transact(request(0x03, 0, 4)), 0x03, bus.holding, 4);
+        CHECK_EQUAL(bus.slave.getBadFrames(), 1);
+    }
+
+    /**
+     * Without a timeout an answer that does not fit is not sent, with one a stalled driver times out.
+     * Neither blocks update()
+     */
+    void testNoRoom()
+    {
+        Bus bus(16, false);
+
+        // 10 registers are a 25 byte answer
+        CHECK(bus.transact(request(0x03, 0, 10)).empty());
+        CHECK_EQUAL(bus.slave.getTxFailures(), 1);
+        checkReadAnswer(bus.transact(request(0x03, 0, 4)), 0x03, bus.holding, 4);
+
+        // The master never lets the driver send
+        bus.slave.setTimeoutTimer(&bus.timeout, TIMEOUT_MS);
+        bus.serial.setSentPerTic(0);
+        uint32_t start = bus.tics.getTicCount();
+        bus.sendFrame(request(0x03, 0, 10));
+        bus.slave.update();
+        uint32_t waited = bus.tics.getTicCount() - start;
+        CHECK(waited >= bus.tics.msecondsToTics(TIMEOUT_MS));
+        CHECK(waited <= bus.tics.msecondsToTics(TIMEOUT_MS) + 2);
+        CHECK_EQUAL(bus.slave.getTxFailures(), 2);
+    }
+}
+
+int main()
+{
+    HostTest::runIsolated("functions", testFunctions);
+    HostTest::runIsolated("queue overflow", testQueueOverflow);
+    HostTest::runIsolated("no room", testNoRoom);
+    return HostTest::result();
+}
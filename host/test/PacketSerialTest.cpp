@@ -0,0 +1,192 @@
+/**
+ * PacketSerial sending into a driver that is short of room
+ *
+ * The fake driver has a fixed amount of TX room, frees it at a set rate each time it is polled
+ * (none at all stands in for masked interrupts or a peer holding off with XOFF/CTS), and counts
+ * the bytes it had to refuse. Each poll is also one tic of the timeout's clock.
+ */
+#include <vector>
+#include "drivers/serial/PacketSerial.hpp"
+#include "drivers/timer/SoftwareTimer.hpp"
+#include "HostTest.hpp"
+
+using SerialComm::PacketSerial;
+
+namespace
+{
+    const uint32_t TICS_PER_SECOND = 1000;
+
+    class FakeSerial : public SerialComm::ISerial
+    {
+        public:
+            FakeSerial(uint16_t capacity, uint16_t freedPerPoll, Tic::TicCounter* pTics):
+                refused(0), capacity_(capacity), freedPerPoll_(freedPerPoll), queued_(0), readIndex_(0), pTics_(pTics) {}
+
+            uint16_t write(const uint8_t* buff, uint16_t numBytes) override
+            {
+                uint16_t space = capacity_ - queued_;
+                uint16_t accepted = (numBytes < space) ? numBytes : space;
+                wire.insert(wire.end(), buff, buff + accepted);
+                queued_ += accepted;
+                refused += numBytes - accepted;
+                return accepted;
+            }
+
+            uint16_t read(uint8_t* buff, uint16_t numBytes) override
+            {
+                uint16_t count = 0;
+                while ((count < numBytes) && (readIndex_ < wire.size())) buff[count++] = wire[readIndex_++];
+                return count;
+            }
+
+            uint16_t getTxSpace() override
+            {
+                pTics_->incrementTicCount();
+                queued_ = (queued_ > freedPerPoll_) ? (queued_ - freedPerPoll_) : 0;
+                return capacity_ - queued_;
+            }
+
+            void setFreedPerPoll(uint16_t freedPerPoll) { freedPerPoll_ = freedPerPoll; }
+            void empty() { queued_ = 0; }
+
+            std::vector<uint8_t> wire;  // Every byte accepted, in order
+            uint32_t refused;           // Bytes offered beyond the room there was
+
+        private:
+            uint16_t capacity_;
+            uint16_t freedPerPoll_;
+            uint16_t queued_;
+            uint32_t readIndex_;
+            Tic::TicCounter* pTics_;
+    };
+
+    std::vector<uint8_t> makePayload(uint16_t length, uint32_t seed)
+    {
+        HostTest::Random random(seed);
+        std::vector<uint8_t> payload(length);
+        // Plenty of zeros, and long enough runs without any for full COBS codes
+        for (uint16_t i=0; i<length; i++) payload[i] = (random.below(8) == 0) ? 0 : (uint8_t)random.next();
+        return payload;
+    }
+
+    void checkReceived(PacketSerial& receiver, const std::vector<uint8_t>& payload)
+    {
+        const uint8_t* pPacket = nullptr;
+        uint16_t length = receiver.receivePacket(&pPacket);
+        CHECK_EQUAL(length, payload.size());
+        if (length != payload.size()) return;
+        for (uint16_t i=0; i<length; i++) CHECK_EQUAL(pPacket[i], payload[i]);
+    }
+
+    /**
+     * With room to spare packets go straight through, and never take more than the worst case length
+     */
+    void testRoundTrip()
+    {
+        Tic::TicCounter tics(TICS_PER_SECOND);
+        FakeSerial serial(600, 600, &tics);
+        uint8_t rxBuffer[600];
+        PacketSerial packets(&serial, rxBuffer, sizeof(rxBuffer));
+
+        static const uint16_t LENGTHS[] = { 1, 2, 100, 252, 253, 254, 255, 400, 508 };
+        for (uint16_t length : LENGTHS)
+        {
+            std::vector<uint8_t> payload = makePayload(length, length);
+            size_t before = serial.wire.size();
+            CHECK(packets.sendPacket(payload.data(), length));
+            CHECK(serial.wire.size() - before <= PacketSerial::getMaxEncodedLength(length));
+            checkReceived(packets, payload);
+        }
+
+        // A run as long as a code can cover, with no zeros at all
+        std::vector<uint8_t> ones(300, 0x01);
+        CHECK(packets.sendPacket(ones.data(), ones.size()));
+        checkReceived(packets, ones);
+
+        CHECK_EQUAL(serial.refused, 0);
+        CHECK_EQUAL(packets.getTxFailures(), 0);
+    }
+
+    /**
+     * Without a timeout a packet that does not fit is not sent at all, nothing waits
+     */
+    void testNoRoomWithoutTimeout()
+    {
+        Tic::TicCounter tics(TICS_PER_SECOND);
+        FakeSerial serial(32, 0, &tics);
+        uint8_t rxBuffer[64];
+        PacketSerial packets(&serial, rxBuffer, sizeof(rxBuffer));
+
+        std::vector<uint8_t> payload = makePayload(40, 1);
+        CHECK(!packets.sendPacket(payload.data(), payload.size()));
+        CHECK_EQUAL(serial.wire.size(), 0);
+        CHECK_EQUAL(serial.refused, 0);
+        CHECK_EQUAL(packets.getTxFailures(), 1);
+
+        // A timeout without a timer does not wait either
+        CHECK(!packets.sendPacket(payload.data(), payload.size(), 100));
+        CHECK_EQUAL(serial.wire.size(), 0);
+
+        std::vector<uint8_t> small = makePayload(20, 2);
+        CHECK(packets.sendPacket(small.data(), small.size()));
+        checkReceived(packets, small);
+    }
+
+    /**
+     * A driver that stops taking bytes part way through a packet times out, and the packet cut short
+     * is ended before the next one so only it is lost
+     */
+    void testStalledDriver()
+    {
+        Tic::TicCounter tics(TICS_PER_SECOND);
+        Timer::SoftwareTimer timeout(0, &tics);
+        FakeSerial serial(32, 0, &tics);
+        uint8_t rxBuffer[128];
+        PacketSerial packets(&serial, rxBuffer, sizeof(rxBuffer));
+        packets.setTimeoutTimer(&timeout);
+
+        std::vector<uint8_t> cut = makePayload(60, 3);
+        uint32_t start = tics.getTicCount();
+        CHECK(!packets.sendPacket(cut.data(), cut.size(), 50));
+        CHECK(tics.getTicCount() - start >= 50);
+        CHECK(tics.getTicCount() - start <= 52);
+        CHECK_EQUAL(serial.wire.size(), 32);
+        CHECK_EQUAL(serial.refused, 0);
+        CHECK_EQUAL(packets.getTxFailures(), 1);
+
+        // The peer lets go
+        serial.empty();
+        serial.setFreedPerPoll(32);
+        std::vector<uint8_t> next = makePayload(20, 4);
+        CHECK(packets.sendPacket(next.data(), next.size(), 50));
+        checkReceived(packets, next);
+        CHECK_EQUAL(packets.getCrcErrors() + packets.getFramingErrors(), 1);
+    }
+
+    /**
+     * With a timeout a packet longer than the driver's buffer goes out as room frees up
+     */
+    void testSlowDriver()
+    {
+        Tic::TicCounter tics(TICS_PER_SECOND);
+        Timer::SoftwareTimer timeout(0, &tics);
+        FakeSerial serial(16, 3, &tics);
+        uint8_t rxBuffer[256];
+        PacketSerial packets(&serial, rxBuffer, sizeof(rxBuffer));
+        packets.setTimeoutTimer(&timeout);
+
+        std::vector<uint8_t> payload = makePayload(200, 5);
+        CHECK(packets.sendPacket(payload.data(), payload.size(), 1000));
+        CHECK_EQUAL(serial.refused, 0);
+        checkReceived(packets, payload);
+    }
+}
+
+int main()
+{
+    testRoundTrip();
+    testNoRoomWithoutTimeout();
+    testStalledDriver();
+    testSlowDriver();
+    return HostTest::result();
+}
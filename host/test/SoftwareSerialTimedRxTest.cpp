@@ -0,0 +1,200 @@
+/**
+ * Atmega328SoftwareSerial timed RX sampling points
+ *
+ * A simulated line sends frames into the RX pin while the driver runs against the simulated pins
+ * and a CTC timer. Every pin read the sample interrupt makes is timestamped, so the test sees
+ * where inside each bit the driver sampled, across baud rates, timer resolutions, interrupt entry
+ * latencies and both ends' clock error. Each case runs in its own process since the driver's
+ * static tables only take a few instances.
+ */
+#include <vector>
+#include <math.h>
+#include "drivers/serial/atmega328/Atmega328SoftwareSerial.hpp"
+#include "drivers/dio/atmega328/Atmega328Dio.hpp"
+#include "drivers/interrupt/atmega328/Atmega328Interrupt.hpp"
+#include "SimAvr.hpp"
+#include "utilities/print/Print.hpp"
+#include "HostTest.hpp"
+
+using namespace Dio;
+
+namespace
+{
+    const uint32_t CPU_HZ = 16000000;
+
+    /**
+     * RX pin that timestamps every read, the sample interrupt reads through it
+     */
+    class SamplingDio : public Atmega328Dio
+    {
+        public:
+            SamplingDio(Port port, uint8_t pin): Atmega328Dio(port, pin, INPUT, L_HIGH, false, true) {}
+
+            Level read() override
+            {
+                samples.push_back(Sim::machine().cycles());
+                return Atmega328Dio::read();
+            }
+
+            std::vector<uint64_t> samples;
+    };
+
+    struct Case
+    {
+        uint32_t baudRate;
+        uint16_t prescale;
+        bool narrowTimer;       // 8 bit counter
+        uint32_t pinLatency;    // Cycles from the start bit edge to the driver restarting the timer
+        uint32_t sampleLatency; // Cycles from the compare match to the driver reading the pin
+        double skew;            // Sender's baud rate error
+        double tolerance;       // How far from the center of a bit it may be sampled, as a fraction
+                                // of the bit, on top of the drift the skew builds up by that bit
+    };
+
+    void runCase(const Case& c)
+    {
+        Sim::Avr avr(CPU_HZ);
+        Sim::Pins pins(avr);
+        Sim::CtcTimer wideTimer(avr, c.prescale);
+        Sim::CtcTimer8 narrowTimer(avr, c.prescale);
+        Sim::CtcTimer& timer = c.narrowTimer ? (Sim::CtcTimer&)narrowTimer : wideTimer;
+        Sim::UartLine line(avr, pins, Sim::PORT_D, 2, c.baudRate, c.skew);
+        pins.setInterruptLatency(c.pinLatency);
+        timer.setInterruptLatency(c.sampleLatency);
+
+        SamplingDio rxPin(Port::D, 2);
+        Atmega328Dio txPin(Port::D, 3, OUTPUT, L_HIGH, false, false);
+        Interrupt::Atmega328Interrupt interrupts;
+        uint8_t rxBuffer[64];
+        SerialComm::Atmega328SoftwareSerial serial(&rxPin, &txPin, &interrupts, c.baudRate, CPU_HZ, rxBuffer, sizeof(rxBuffer));
+        serial.initialize();
+        serial.enableTimedRx(&timer, timer.getTicksPerSecond());
+        interrupts.enableInterrupts();
+
+        // Patterns with single bit runs and long runs, back to back and with the frames at
+        // varying phase against the timer's prescaler
+        static const uint8_t PATTERNS[] = { 0x55, 0xAA, 0x00, 0xFF, 0x01, 0x80, 0x0F, 0xF0, 0xA5, 0x5A };
+        HostTest::Random random(c.baudRate + c.pinLatency);
+        std::vector<uint8_t> sent;
+        for (uint8_t round=0; round<4; round++)
+        {
+            double idleBits = (round == 0) ? 0 : random.below(1000) / 400.0;
+            for (uint8_t byte : PATTERNS)
+            {
+                line.send(&byte, 1, idleBits);
+                sent.push_back(byte);
+                idleBits = (round % 2 == 0) ? 0 : random.below(1000) / 1000.0;
+            }
+        }
+
+        uint32_t bitCycles = CPU_HZ / c.baudRate;
+        while (!line.isIdle()) avr.advance(bitCycles);
+        avr.advance(4 * bitCycles);
+
+        uint8_t received[64];
+        uint16_t numReceived = serial.read(received, sizeof(received));
+        CHECK_EQUAL(numReceived, sent.size());
+        CHECK_EQUAL(serial.getRxStatistics().framingErrors, 0);
+        for (uint16_t i=0; (i<numReceived) && (i<sent.size()); i++) CHECK_EQUAL(received[i], sent[i]);
+
+        // Start bit, 8 data bits and the stop bit are each sampled once
+        const uint8_t SAMPLES_PER_FRAME = 10;
+        CHECK_EQUAL(rxPin.samples.size(), sent.size() * SAMPLES_PER_FRAME);
+
+        double earliest = 1;
+        double latest = 0;
+        for (uint32_t i=0; (i<rxPin.samples.size()) && (i / SAMPLES_PER_FRAME < sent.size()); i++)
+        {
+            uint8_t bit = i % SAMPLES_PER_FRAME;
+            double start = line.getFrameStart(i / SAMPLES_PER_FRAME);
+            double position = ((rxPin.samples[i] - start) / line.getBitCycles()) - bit;
+            earliest = fmin(earliest, position);
+            latest = fmax(latest, position);
+
+            CHECK(fabs(position - 0.5) <= c.tolerance + (fabs(c.skew) * (bit + 0.5)));
+        }
+
+        printf("%6u baud /%-4u %2u bit, latency %3u+%3u, skew %+.2f: samples at %.2f..%.2f of a bit\n",
+               (unsigned)c.baudRate, (unsigned)c.prescale, c.narrowTimer ? 8 : 16,
+               (unsigned)c.pinLatency, (unsigned)c.sampleLatency, c.skew, earliest, latest);
+    }
+
+    /**
+     * A bit period longer than the timer's counter must be refused, the default range is 16 bits
+     */
+    void testTimerRange(bool narrowTimer)
+    {
+        Sim::Avr avr(CPU_HZ);
+        Sim::Pins pins(avr);
+        Sim::CtcTimer wideTimer(avr, 1);
+        Sim::CtcTimer8 shortTimer(avr, 1);
+        Sim::CtcTimer& timer = narrowTimer ? (Sim::CtcTimer&)shortTimer : wideTimer;
+
+        Atmega328Dio rxPin(Port::D, 2, INPUT, L_HIGH, false, true);
+        Atmega328Dio txPin(Port::D, 3, OUTPUT, L_HIGH, false, false);
+        Interrupt::Atmega328Interrupt interrupts;
+        uint8_t rxBuffer[8];
+        SerialComm::Atmega328SoftwareSerial serial(&rxPin, &txPin, &interrupts, 9600, CPU_HZ, rxBuffer, sizeof(rxBuffer));
+        serial.initialize();
+
+        // 1667 counts per bit
+        bool refused = false;
+        try
+        {
+            serial.enableTimedRx(&timer, timer.getTicksPerSecond());
+        }
+        catch (HostSim::AssertFailed&)
+        {
+            refused = true;
+        }
+        CHECK_EQUAL(refused, narrowTimer);
+    }
+}
+
+int main()
+{
+    struct Timing
+    {
+        uint32_t baudRate;
+        uint16_t prescale;
+        bool narrowTimer;
+        double tolerance;
+    };
+
+    // At 57600 baud the interrupts' entry alone takes more than half a bit, so the start bit is
+    // sampled late and everything after it with it
+    static const Timing TIMINGS[] =
+    {
+        { 2400, 64, true, 0.1 },
+        { 4800, 8, false, 0.1 },
+        { 9600, 8, true, 0.1 },
+        { 19200, 8, true, 0.1 },
+        { 19200, 1, false, 0.1 },
+        { 38400, 8, true, 0.15 },
+        { 38400, 1, false, 0.15 },
+        { 57600, 1, false, 0.3 },
+    };
+    // Around the 80 and 40 cycles the driver allows for
+    static const uint32_t PIN_LATENCIES[] = { 60, 80, 100 };
+    static const uint32_t SAMPLE_LATENCIES[] = { 25, 40, 55 };
+    static const double SKEWS[] = { -0.02, 0, 0.02 };
+
+    for (const Timing& timing : TIMINGS)
+    {
+        for (uint32_t pinLatency : PIN_LATENCIES)
+        {
+            for (uint32_t sampleLatency : SAMPLE_LATENCIES)
+            {
+                for (double skew : SKEWS)
+                {
+                    Case c = { timing.baudRate, timing.prescale, timing.narrowTimer, pinLatency, sampleLatency, skew, timing.tolerance };
+                    HostTest::runIsolated("timed RX case", [&]() { runCase(c); });
+                }
+            }
+        }
+    }
+
+    HostTest::runIsolated("narrow timer range", []() { testTimerRange(true); });
+    HostTest::runIsolated("wide timer range", []() { testTimerRange(false); });
+    return HostTest::result();
+}
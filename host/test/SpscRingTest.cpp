@@ -0,0 +1,265 @@
+/**
+ * SpscRing under interrupts
+ *
+ * The simulated ISR is the other side of the ring and fires at random points inside the main
+ * loop's calls, between the element copies that run after the other side's index was read and
+ * before this side's index is published. Every element carries a sequence number, so a lost,
+ * repeated or torn element shows up as a gap.
+ */
+#include <thread>
+#include <atomic>
+#include "drivers/serial/SpscRing.hpp"
+#include "HostTest.hpp"
+
+using SerialComm::SpscRing;
+
+namespace
+{
+    HostTest::Random random(12345);
+    void (*pendingIsr)() = nullptr;
+    bool inIsr = false;
+    uint32_t isrRate = 4;   // One in isrRate element copies is interrupted
+
+    void runIsr(void (*isr)())
+    {
+        inIsr = true;
+        isr();
+        inIsr = false;
+    }
+
+    /**
+     * Ring element that gives the interrupt a chance to fire each time it is copied
+     */
+    struct Element
+    {
+        uint32_t sequence;
+
+        Element(): sequence(0) {}
+        explicit Element(uint32_t s): sequence(s) {}
+
+        Element& operator=(const Element& other)
+        {
+            if (!inIsr && (pendingIsr != nullptr) && (random.below(isrRate) == 0)) runIsr(pendingIsr);
+            sequence = other.sequence;
+            return *this;
+        }
+    };
+
+    const uint16_t RING_LENGTH = 128;
+    Element storage[RING_LENGTH];
+    SpscRing<Element>* pRing;
+
+    uint32_t nextPushed;    // Sequence of the next element to produce
+    uint32_t nextPopped;    // Sequence the next consumed element must have
+
+    void consume(const Element& element)
+    {
+        CHECK_EQUAL(element.sequence, nextPopped);
+        nextPopped = element.sequence + 1;
+    }
+
+    // Like the TX ISR, drains a few elements
+    void consumerIsr()
+    {
+        uint8_t count = random.below(4);
+        Element element;
+        while ((count-- > 0) && pRing->pop(element)) consume(element);
+        CHECK(pRing->length() <= pRing->capacity());
+    }
+
+    // Like the RX ISR, adds a few elements
+    void producerIsr()
+    {
+        uint8_t count = random.below(4);
+        while ((count-- > 0) && pRing->push(Element(nextPushed))) nextPushed++;
+        CHECK(pRing->length() <= pRing->capacity());
+    }
+
+    void resetRing(uint16_t length)
+    {
+        static SpscRing<Element> ring(storage, RING_LENGTH);
+        ring = SpscRing<Element>(storage, length);
+        pRing = &ring;
+        nextPushed = 0;
+        nextPopped = 0;
+    }
+
+    /**
+     * Main loop producing, ISR consuming. Runs long enough for the 8 bit indices to wrap many times
+     */
+    void testMainProducer(uint16_t length)
+    {
+        resetRing(length);
+        pendingIsr = consumerIsr;
+
+        Element batch[RING_LENGTH];
+        for (uint32_t i=0; i<200000; i++)
+        {
+            // And the consumer some turns of its own so the ring also empties
+            if (random.below(3) == 0) runIsr(consumerIsr);
+
+            if (random.below(2) == 0)
+            {
+                if (pRing->push(Element(nextPushed))) nextPushed++;
+            }
+            else
+            {
+                uint16_t num = random.below(length + 1);
+                for (uint16_t j=0; j<num; j++) batch[j].sequence = nextPushed + j;
+                uint16_t added = pRing->write(batch, num);
+                CHECK(added <= num);
+                nextPushed += added;
+            }
+            CHECK(pRing->length() <= length);
+        }
+
+        // Let the ISR finish off the ring
+        pendingIsr = nullptr;
+        Element element;
+        while (pRing->pop(element)) consume(element);
+        CHECK_EQUAL(nextPopped, nextPushed);
+        CHECK(nextPushed > 100 * 256);
+    }
+
+    /**
+     * ISR producing, main loop consuming, with peek() and flush() as the line and RX paths use them
+     */
+    void testMainConsumer(uint16_t length)
+    {
+        resetRing(length);
+        pendingIsr = producerIsr;
+
+        Element batch[RING_LENGTH];
+        for (uint32_t i=0; i<200000; i++)
+        {
+            // Give the producer some turns of its own so the ring also fills up
+            if (random.below(3) == 0) runIsr(producerIsr);
+
+            uint32_t choice = random.below(16);
+            if (choice == 0)
+            {
+                // Everything flushed counts as consumed, whatever was pushed before the flush
+                pRing->flush();
+                uint8_t consumed = pRing->consumerIndex();
+                nextPopped += (uint8_t)(consumed - (uint8_t)nextPopped);
+            }
+            else if (choice < 8)
+            {
+                Element* pPeeked = pRing->peek();
+                Element element;
+                if (pPeeked != nullptr)
+                {
+                    uint32_t peeked = pPeeked->sequence;
+                    CHECK(pRing->pop(element));
+                    CHECK_EQUAL(element.sequence, peeked);
+                    consume(element);
+                }
+            }
+            else
+            {
+                uint16_t num = pRing->read(batch, random.below(length + 1));
+                for (uint16_t j=0; j<num; j++) consume(batch[j]);
+            }
+            CHECK(pRing->length() <= length);
+        }
+
+        pendingIsr = nullptr;
+        Element element;
+        while (pRing->pop(element)) consume(element);
+        CHECK_EQUAL(nextPopped, nextPushed);
+    }
+
+    /**
+     * Full and empty must still be told apart at the longest length, across the index wrap
+     */
+    void testFullAtMaxLength()
+    {
+        pendingIsr = nullptr;
+        CHECK(SpscRing<uint8_t>::isValidLength(SpscRing<uint8_t>::MAX_LENGTH));
+        CHECK(!SpscRing<uint8_t>::isValidLength(256));
+        CHECK(!SpscRing<uint8_t>::isValidLength(0));
+        CHECK(!SpscRing<uint8_t>::isValidLength(96));
+
+        uint8_t bytes[SpscRing<uint8_t>::MAX_LENGTH];
+        SpscRing<uint8_t> ring(bytes, SpscRing<uint8_t>::MAX_LENGTH);
+        CHECK_EQUAL(ring.capacity(), 128);
+
+        uint8_t value = 0;
+        for (uint16_t round=0; round<5; round++)
+        {
+            for (uint16_t i=0; i<128; i++) CHECK(ring.push((uint8_t)i));
+            CHECK(ring.isFull());
+            CHECK(!ring.push(0));
+            CHECK_EQUAL(ring.length(), 128);
+
+            for (uint16_t i=0; i<128; i++)
+            {
+                CHECK(ring.pop(value));
+                CHECK_EQUAL(value, i);
+            }
+            CHECK(ring.isEmpty());
+            CHECK(!ring.pop(value));
+
+            // Shift the indices so the next round straddles the wrap somewhere else
+            ring.push(0);
+            ring.pop(value);
+        }
+    }
+
+    /**
+     * A real second thread as the other side. x86 keeps stores and loads in program order, as
+     * the in-order AVR core does, so the compiler barrier is all the ring needs here as well
+     */
+    void testThreads()
+    {
+#if defined(__x86_64__) || defined(__i386__)
+        static uint32_t words[64];
+        SpscRing<uint32_t> ring(words, 64);
+        const uint32_t count = 500000;
+        std::atomic<bool> failed(false);
+
+        std::thread consumer([&]() {
+            uint32_t expected = 0;
+            uint32_t value;
+            while (expected < count)
+            {
+                if (ring.pop(value))
+                {
+                    if (value != expected) failed = true;
+                    expected++;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+
+        for (uint32_t i=0; i<count; )
+        {
+            if (ring.push(i)) i++;
+            else std::this_thread::yield();
+        }
+        consumer.join();
+        CHECK(!failed);
+        CHECK(ring.isEmpty());
+#endif
+    }
+}
+
+int main()
+{
+    static const uint16_t LENGTHS[] = {1, 2, 16, 128};
+    for (uint16_t length : LENGTHS)
+    {
+        isrRate = 2;
+        testMainProducer(length);
+        testMainConsumer(length);
+        isrRate = 16;
+        testMainProducer(length);
+        testMainConsumer(length);
+    }
+    testFullAtMaxLength();
+    testThreads();
+    return HostTest::result();
+}
@@ -0,0 +1,278 @@
+/**
+ * Atmega328TicCounter::nowMicros() with the tic interrupt at every point of the read
+ *
+ * The timer is a step from its compare match when nowMicros() is called, and the match is made to
+ * happen before or after each register access the read makes in turn. With interrupts on, the tic
+ * interrupt runs as soon as the match happens, otherwise its flag waits in TIFRn until they come
+ * back on. Nothing but the timer changes between two accesses, so the points before and after each
+ * access cover every instruction boundary of the read. Whichever side of the match TCNTn is read
+ * on, the result must be that exact time, with no tic missing or counted twice.
+ */
+#include <initializer_list>
+#include <avr/io.h>
+#include "drivers/timer/ATmega328/ATmega328TicCounter.hpp"
+#include "Sim.hpp"
+#include "HostTest.hpp"
+
+extern "C" void TIMER0_COMPA_vect(void);
+extern "C" void TIMER1_COMPA_vect(void);
+extern "C" void TIMER2_COMPA_vect(void);
+
+namespace
+{
+    const uint8_t OCFA_BIT = (1 << OCF1A);     // Same bit in TIFR0, TIFR1 and TIFR2
+
+    /**
+     * Counter whose tic count the test can start anywhere
+     */
+    class TestTicCounter : public Tic::Atmega328TicCounter
+    {
+        public:
+            TestTicCounter(Timer::Atmega328Timer* pTicTimer): Atmega328TicCounter(pTicTimer) {}
+
+            void setTicCount(uint32_t tics) { ticCount_ = tics; }
+    };
+
+    TestTicCounter* pTicCounter = nullptr;
+    void onTic() { pTicCounter->incrementTicCount(); }
+
+    /**
+     * Runs a timer's compare match at a chosen point of a sequence of register accesses
+     */
+    class MatchMachine : public Sim::Machine
+    {
+        public:
+            /**
+             * @param   matchPoint  2n to match just before the n'th access, 2n + 1 just after it
+             */
+            MatchMachine(Timer::Timer timer, uint32_t matchPoint):
+                timer_(timer),
+                matchPoint_(matchPoint),
+                numAccesses_(0),
+                inInterrupt_(false),
+                numInterrupts_(0),
+                matched_(false),
+                countReadAfterMatch_(false)
+            {}
+
+            uint8_t read(volatile uint8_t* reg) override
+            {
+                before();
+                uint8_t value = *reg;
+                if ((reg == &TCNT0) || (reg == &TCNT2)) countReadAfterMatch_ = matched_;
+                after();
+                return value;
+            }
+
+            void write(volatile uint8_t* reg, uint8_t value) override
+            {
+                before();
+                *reg = value;
+                after();
+            }
+
+            uint16_t read(volatile uint16_t* reg) override
+            {
+                before();
+                uint16_t value = *reg;
+                if (reg == &TCNT1) countReadAfterMatch_ = matched_;
+                after();
+                return value;
+            }
+
+            void write(volatile uint16_t* reg, uint16_t value) override
+            {
+                before();
+                *reg = value;
+                after();
+            }
+
+            uint32_t getNumAccesses() { return numAccesses_; }
+            uint32_t getNumInterrupts() { return numInterrupts_; }
+
+            /**
+             * @return  True if TCNTn was last read after the match, so it had cleared
+             */
+            bool wasCountReadAfterMatch() { return countReadAfterMatch_; }
+
+        private:
+            Timer::Timer timer_;
+            uint32_t matchPoint_;
+            uint32_t numAccesses_;
+            bool inInterrupt_;
+            uint32_t numInterrupts_;
+            bool matched_;
+            bool countReadAfterMatch_;
+
+            void before()
+            {
+                if (!inInterrupt_ && (matchPoint_ == 2 * numAccesses_)) match();
+            }
+
+            void after()
+            {
+                if (inInterrupt_) return;
+                if (matchPoint_ == 2 * numAccesses_ + 1) match();
+                numAccesses_++;
+                service();
+            }
+
+            /**
+             * Counter clears on reaching top, and the flag is set
+             */
+            void match()
+            {
+                matched_ = true;
+                switch (timer_)
+                {
+                    case Timer::TIMER_0: TCNT0.raw() = 0; TIFR0.raw() |= OCFA_BIT; break;
+                    case Timer::TIMER_1: TCNT1.raw() = 0; TIFR1.raw() |= OCFA_BIT; break;
+                    case Timer::TIMER_2: TCNT2.raw() = 0; TIFR2.raw() |= OCFA_BIT; break;
+                }
+                service();
+            }
+
+            /**
+             * Run the interrupt if its flag is set and interrupts are on, clearing the flag as
+             * entering the vector does
+             */
+            void service()
+            {
+                if (inInterrupt_ || !Sim::interruptsEnabled()) return;
+
+                volatile uint8_t& flags = (timer_ == Timer::TIMER_0) ? TIFR0.raw() :
+                                          (timer_ == Timer::TIMER_1) ? TIFR1.raw() : TIFR2.raw();
+                if (!(flags & OCFA_BIT)) return;
+
+                flags &= ~OCFA_BIT;
+                inInterrupt_ = true;
+                numInterrupts_++;
+                switch (timer_)
+                {
+                    case Timer::TIMER_0: Sim::interrupt(TIMER0_COMPA_vect); break;
+                    case Timer::TIMER_1: Sim::interrupt(TIMER1_COMPA_vect); break;
+                    case Timer::TIMER_2: Sim::interrupt(TIMER2_COMPA_vect); break;
+                }
+                inInterrupt_ = false;
+            }
+    };
+
+    struct Case
+    {
+        Timer::Timer timer;
+        Timer::TimerPrescaler prescaler;
+        uint16_t top;
+    };
+
+    void setCount(Timer::Timer timer, uint16_t count)
+    {
+        switch (timer)
+        {
+            case Timer::TIMER_0: TCNT0.raw() = (uint8_t)count; break;
+            case Timer::TIMER_1: TCNT1.raw() = count; break;
+            case Timer::TIMER_2: TCNT2.raw() = (uint8_t)count; break;
+        }
+    }
+
+    void runCase(const Case& c)
+    {
+        Timer::Atmega328Timer ticTimer(c.timer, Timer::CTC, c.prescaler, c.top, onTic);
+        TestTicCounter ticCounter(&ticTimer);
+        pTicCounter = &ticCounter;
+
+        uint32_t countRate = ticTimer.getCountRate();
+        auto micros = [&](uint32_t tics, uint16_t count) -> uint32_t
+        {
+            uint64_t ticMicros = ((uint64_t)c.top + 1) * 1000000ull / countRate;
+            return (uint32_t)((tics * ticMicros) + ((uint64_t)count * 1000000ull / countRate));
+        };
+
+        // Around the carries of each byte of the tic count and of the microseconds
+        static const uint32_t START_TICS[] = { 0, 0xFE, 0xFFFE, 0xFFFFFE, 4294966, 0xFFFFFFFE };
+
+        for (uint32_t startTics : START_TICS)
+        {
+            // Count the accesses the read makes, with the match after it
+            uint32_t numAccesses;
+            {
+                MatchMachine machine(c.timer, UINT32_MAX);
+                Sim::setMachine(&machine);
+                SREG.raw() = (1 << Sim::SREG_INTERRUPT_BIT);
+                ticCounter.nowMicros();
+                numAccesses = machine.getNumAccesses();
+                Sim::setMachine(nullptr);
+            }
+            CHECK(numAccesses >= 2);
+
+            for (uint32_t point=0; point<=2 * numAccesses; point++)
+            {
+                for (bool interruptsOn : { true, false })
+                {
+                    MatchMachine machine(c.timer, point);
+                    Sim::setMachine(&machine);
+
+                    // One count before the match
+                    ticCounter.setTicCount(startTics);
+                    setCount(c.timer, c.top);
+                    TIFR0.raw() = 0;
+                    TIFR1.raw() = 0;
+                    TIFR2.raw() = 0;
+                    SREG.raw() = interruptsOn ? (1 << Sim::SREG_INTERRUPT_BIT) : 0;
+
+                    uint32_t now = ticCounter.nowMicros();
+
+                    // The time TCNTn was read at, on whichever side of the match it was
+                    uint32_t expected = machine.wasCountReadAfterMatch() ? micros(startTics + 1, 0) : micros(startTics, c.top);
+                    if (!CHECK_EQUAL(now, expected))
+                    {
+                        printf("timer %u, tics 0x%08x, match at point %u, interrupts %s\n",
+                               (unsigned)c.timer, (unsigned)startTics, (unsigned)point, interruptsOn ? "on" : "off");
+                    }
+
+                    // The tic is counted once, by the interrupt, when interrupts allow it
+                    uint32_t expectedTics = startTics + (((point < 2 * numAccesses) && interruptsOn) ? 1 : 0);
+                    CHECK_EQUAL(ticCounter.getTicCount(), expectedTics);
+                    CHECK(machine.getNumInterrupts() <= 1);
+
+                    Sim::setMachine(nullptr);
+                }
+            }
+        }
+
+        // Time keeps going forward across many matches, with the read at every phase of the count
+        {
+            Sim::setMachine(nullptr);
+            SREG.raw() = (1 << Sim::SREG_INTERRUPT_BIT);
+            ticCounter.setTicCount(0);
+            uint32_t last = 0;
+            for (uint32_t tic=0; tic<3; tic++)
+            {
+                for (uint32_t count=0; count<=c.top; count++)
+                {
+                    setCount(c.timer, (uint16_t)count);
+                    uint32_t now = ticCounter.nowMicros();
+                    CHECK_EQUAL(now, micros(tic, (uint16_t)count));
+                    CHECK(now >= last);
+                    last = now;
+                }
+                onTic();
+            }
+        }
+
+        pTicCounter = nullptr;
+    }
+}
+
+int main()
+{
+    static const Case CASES[] =
+    {
+        { Timer::TIMER_0, Timer::PRESCALE_64, 249 },
+        { Timer::TIMER_1, Timer::PRESCALE_8, 1999 },
+        { Timer::TIMER_1, Timer::PRESCALE_1, 15999 },
+        { Timer::TIMER_2, Timer::PRESCALE_32, 124 },
+    };
+
+    for (const Case& c : CASES) runCase(c);
+    return HostTest::result();
+}
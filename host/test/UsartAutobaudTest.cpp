@@ -0,0 +1,258 @@
+/**
+ * Autobaud on the simulated USART, for the polled and interrupt driven drivers
+ *
+ * A simulated line on RXD (PD0) repeats the sync character at each standard rate, with the far
+ * end's clock off by a few percent either way. RXD feeds both the USART and PIND, so the driver
+ * times the same edges the USART then receives. Every register access lets the clock run for a
+ * few cycles, as the instructions of the polling loop would, and Timer1 counts CPU cycles while it
+ * is borrowed. After locking, a message sent at the far end's rate must come through intact.
+ */
+#include <vector>
+#include "drivers/serial/atmega328/Atmega328Uart.hpp"
+#include "drivers/serial/atmega328/Atmega328AsynchUart.hpp"
+#include "drivers/timer/TicCounter.hpp"
+#include "SimAvr.hpp"
+#include "HostTest.hpp"
+
+using namespace SerialComm;
+
+namespace
+{
+    const uint32_t CPU_HZ = 16000000;
+    const uint32_t ACCESS_CYCLES = 5;   // About one pass of the edge polling loop per two accesses
+
+    /**
+     * Timer1 free running from the CPU clock, counting only while CS10 alone is selected
+     */
+    class CycleTimer : public Sim::Peripheral
+    {
+        public:
+            CycleTimer(Sim::Avr& avr): avr_(avr), count_(0), last_(0) { avr.attach(this); }
+
+            void update(uint64_t now) override { (void)now; }
+            uint64_t nextEvent() override { return Sim::NEVER; }
+
+            bool read(volatile uint16_t* reg, uint16_t& value) override
+            {
+                if (reg != &TCNT1) return false;
+                catchUp();
+                value = count_;
+                return true;
+            }
+
+            bool write(volatile uint16_t* reg, uint16_t value) override
+            {
+                if (reg != &TCNT1) return false;
+                catchUp();
+                count_ = value;
+                return true;
+            }
+
+            bool write(volatile uint8_t* reg, uint8_t value) override
+            {
+                // Count up to the change at the old setting, the machine stores the new one
+                if (reg == &TCCR1B) catchUp();
+                (void)value;
+                return false;
+            }
+
+        private:
+            Sim::Avr& avr_;
+            uint16_t count_;
+            uint64_t last_;
+
+            void catchUp()
+            {
+                uint64_t now = avr_.cycles();
+                if ((TCCR1B.raw() & 0x07) == (1 << CS10)) count_ += (uint16_t)(now - last_);
+                last_ = now;
+            }
+    };
+
+    uint8_t txBuffer[32];
+    uint8_t rxBuffer[32];
+
+    Tic::TicCounter tics(1000);
+    void onTic() { tics.incrementTicCount(); }
+
+    const uint8_t MESSAGE[] = "Autobaud locked";
+}
+
+Atmega328AsynchUart asynchUart(txBuffer, rxBuffer, sizeof(txBuffer), sizeof(rxBuffer), BaudRate::BAUD_9600, CPU_HZ);
+ASYNCH_UART_ISRS(asynchUart)
+
+namespace
+{
+    // Standard rates 16MHz can generate, the far end's
+    struct Rate
+    {
+        BaudRate baudRate;
+        uint32_t baud;
+    };
+
+    const Rate RATES[] =
+    {
+        { BaudRate::BAUD_9600, 9600 },
+        { BaudRate::BAUD_19200, 19200 },
+        { BaudRate::BAUD_38400, 38400 },
+        { BaudRate::BAUD_57600, 57600 },
+        { BaudRate::BAUD_115200, 115200 },
+    };
+
+    /**
+     * Machine with the USART, Timer1 and a 1ms tic on a second timer for autobaud's timeout
+     */
+    struct Rig
+    {
+        Rig(uint32_t baud, double skew):
+            avr(CPU_HZ),
+            pins(avr),
+            usart(avr, pins),
+            cycleTimer(avr),
+            ticTimer(avr, 64),
+            line(avr, pins, Sim::PORT_D, 0, baud, skew)
+        {
+            avr.setAccessCycles(ACCESS_CYCLES);
+            ticTimer.setInterrupt(onTic);
+            ticTimer.setPeriodTics(CPU_HZ / 64 / 1000);
+            ticTimer.enable();
+            sei();
+        }
+
+        /**
+         * Queue sync characters with gaps of up to two bits between them, as a far end repeating
+         * it until answered would. The line idles first, so the first frame is whole
+         */
+        void sendSync(uint8_t count)
+        {
+            HostTest::Random random(count);
+            for (uint8_t i=0; i<count; i++)
+            {
+                double idleBits = (i == 0) ? 3 : random.below(1000) / 500.0;
+                line.send(&AUTOBAUD_SYNC_CHAR, 1, idleBits);
+            }
+        }
+
+        void finishLine()
+        {
+            while (!line.isIdle()) avr.advance(1000);
+            avr.advance(CPU_HZ / 1000);
+        }
+
+        /**
+         * @return  True if the USART runs at the settings for baudRate
+         */
+        bool isAt(BaudRate baudRate)
+        {
+            BaudSettings expected = calculateBaudSettings(baudRate, CPU_HZ);
+            uint16_t ubrr = ((uint16_t)UBRR0H.raw() << 8) | UBRR0L.raw();
+            bool doubleSpeed = (UCSR0A.raw() & (1 << U2X0)) != 0;
+            return CHECK_EQUAL(ubrr, expected.ubrr) && CHECK_EQUAL(doubleSpeed, expected.doubleSpeed);
+        }
+
+        Sim::Avr avr;
+        Sim::Pins pins;
+        Sim::Usart usart;
+        CycleTimer cycleTimer;
+        Sim::CtcTimer8 ticTimer;
+        Sim::UartLine line;
+    };
+
+    const double SKEWS[] = { -0.02, 0, 0.02 };
+
+    void testPolled(const Rate& rate, double skew)
+    {
+        Rig rig(rate.baud, skew);
+        Timer::SoftwareTimer timeoutTimer(0, &tics);
+        BaudRate startRate = (rate.baudRate == BaudRate::BAUD_9600) ? BaudRate::BAUD_115200 : BaudRate::BAUD_9600;
+        Atmega328Uart uart(startRate, CPU_HZ, false, false, &timeoutTimer);
+        uart.initialize();
+
+        rig.sendSync(8);
+        CHECK(uart.autobaud(CPU_HZ, 500));
+        CHECK(rig.isAt(rate.baudRate));
+        CHECK_EQUAL(TCCR1B.raw(), 0);
+
+        // Sync characters left over are received, the receiver may start mid frame on them
+        rig.finishLine();
+        uint8_t byte;
+        while (uart.isDataAvailable()) uart.read(&byte, 1);
+        uart.resetRxStatistics();
+
+        rig.line.send(MESSAGE, sizeof(MESSAGE));
+        uint8_t received[sizeof(MESSAGE)];
+        uart.read(received, sizeof(received));
+        CHECK(memcmp(received, MESSAGE, sizeof(MESSAGE)) == 0);
+        CHECK_EQUAL(uart.getRxStatistics().framingErrors, 0);
+    }
+
+    void testAsynch(const Rate& rate, double skew)
+    {
+        Rig rig(rate.baud, skew);
+        Timer::SoftwareTimer timeoutTimer(0, &tics);
+        asynchUart.setTimeoutTimer(&timeoutTimer);
+        asynchUart.initialize();
+
+        // Sent at the old rate before it changes
+        const uint8_t PROMPT[] = "?";
+        asynchUart.write(PROMPT, 1);
+
+        // The far end keeps repeating the sync character while the prompt goes out
+        rig.sendSync(40);
+        CHECK(asynchUart.autobaud(CPU_HZ, 500));
+        CHECK(rig.isAt(rate.baudRate));
+        CHECK_EQUAL(rig.usart.sent.size(), 1);
+
+        // Interrupt driven again, the message arrives while the CPU is elsewhere. Sync characters
+        // left over are received first, the receiver may start mid frame on them
+        rig.finishLine();
+        uint8_t flush[32];
+        while (asynchUart.read(flush, sizeof(flush)) != 0) {}
+        asynchUart.resetRxStatistics();
+
+        uint64_t interrupts = rig.avr.getInterruptCount();
+        rig.line.send(MESSAGE, sizeof(MESSAGE));
+        rig.finishLine();
+        CHECK(rig.avr.getInterruptCount() - interrupts >= sizeof(MESSAGE));
+
+        uint8_t received[sizeof(MESSAGE)];
+        CHECK_EQUAL(asynchUart.read(received, sizeof(received)), sizeof(MESSAGE));
+        CHECK(memcmp(received, MESSAGE, sizeof(MESSAGE)) == 0);
+        CHECK_EQUAL(asynchUart.getRxStatistics().framingErrors, 0);
+    }
+
+    /**
+     * Nothing on the line, the timeout passes and the rate is kept
+     */
+    void testTimeout()
+    {
+        Rig rig(9600, 0);
+        Timer::SoftwareTimer timeoutTimer(0, &tics);
+        Atmega328Uart uart(BaudRate::BAUD_57600, CPU_HZ, false, false, &timeoutTimer);
+        uart.initialize();
+
+        uint64_t start = rig.avr.cycles();
+        CHECK(!uart.autobaud(CPU_HZ, 20));
+        CHECK(rig.isAt(BaudRate::BAUD_57600));
+        CHECK(rig.avr.cycles() - start >= (CPU_HZ / 1000) * 19);
+        CHECK(UCSR0B.raw() & (1 << RXEN0));
+    }
+}
+
+int main()
+{
+    for (const Rate& rate : RATES)
+    {
+        for (double skew : SKEWS)
+        {
+            char name[64];
+            snprintf(name, sizeof(name), "polled %u baud, skew %+.2f", (unsigned)rate.baud, skew);
+            HostTest::runIsolated(name, [&]() { testPolled(rate, skew); });
+            snprintf(name, sizeof(name), "asynch %u baud, skew %+.2f", (unsigned)rate.baud, skew);
+            HostTest::runIsolated(name, [&]() { testAsynch(rate, skew); });
+        }
+    }
+
+    HostTest::runIsolated("timeout", testTimeout);
+    return HostTest::result();
+}
@@ -0,0 +1,10 @@
+/**
+ * Must not compile, 8MHz is 8.5% off 230400 baud in either mode. Built by ctest, which expects
+ * the build to fail
+ */
+#include "drivers/serial/atmega328/UsartBaud.hpp"
+
+int main()
+{
+    return SerialComm::UsartBaud<8000000, 230400>::ubrr;
+}
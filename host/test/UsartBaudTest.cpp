@@ -0,0 +1,119 @@
+/**
+ * Baud rate solver against the ATmega328P datasheet tables (examples of UBRRn settings for
+ * commonly used oscillator frequencies). Where both modes give the same error the solver keeps
+ * normal mode, which samples each bit more often.
+ */
+#include "drivers/serial/atmega328/UsartBaud.hpp"
+#include "utilities/print/Print.hpp"
+#include "HostTest.hpp"
+
+using namespace SerialComm;
+
+// Fails to compile with the values that came out, so a mismatch names the row
+#define CHECK_BAUD(fCpu, baud, u2x, ubrrValue)                                      \
+    static_assert(solveBaud(fCpu, baud).doubleSpeed == (u2x), "U2X for " #fCpu " " #baud);     \
+    static_assert(solveBaud(fCpu, baud).ubrr == (ubrrValue), "UBRR for " #fCpu " " #baud)
+
+// 8MHz
+CHECK_BAUD(8000000, 2400, true, 416);
+CHECK_BAUD(8000000, 9600, false, 51);
+CHECK_BAUD(8000000, 19200, false, 25);
+CHECK_BAUD(8000000, 38400, false, 12);
+CHECK_BAUD(8000000, 57600, true, 16);
+CHECK_BAUD(8000000, 76800, true, 12);
+CHECK_BAUD(8000000, 115200, true, 8);
+CHECK_BAUD(8000000, 250000, false, 1);
+CHECK_BAUD(8000000, 500000, false, 0);
+CHECK_BAUD(8000000, 1000000, true, 0);
+
+// 16MHz
+CHECK_BAUD(16000000, 2400, true, 832);
+CHECK_BAUD(16000000, 9600, false, 103);
+CHECK_BAUD(16000000, 19200, false, 51);
+CHECK_BAUD(16000000, 38400, false, 25);
+CHECK_BAUD(16000000, 57600, true, 34);
+CHECK_BAUD(16000000, 76800, false, 12);
+CHECK_BAUD(16000000, 115200, true, 16);
+CHECK_BAUD(16000000, 250000, false, 3);
+CHECK_BAUD(16000000, 500000, false, 1);
+CHECK_BAUD(16000000, 1000000, false, 0);
+CHECK_BAUD(16000000, 2000000, true, 0);
+
+// 20MHz
+CHECK_BAUD(20000000, 2400, false, 520);
+CHECK_BAUD(20000000, 9600, false, 129);
+CHECK_BAUD(20000000, 19200, false, 64);
+CHECK_BAUD(20000000, 38400, true, 64);
+CHECK_BAUD(20000000, 57600, true, 42);
+CHECK_BAUD(20000000, 76800, true, 32);
+CHECK_BAUD(20000000, 115200, false, 10);
+CHECK_BAUD(20000000, 230400, true, 10);
+CHECK_BAUD(20000000, 250000, false, 4);
+CHECK_BAUD(20000000, 500000, true, 4);
+
+// Datasheet errors, in hundredths of a percent
+static_assert(UsartBaud<16000000, 115200>::error == 212, "16MHz 115200 is 2.1% off");
+static_assert(UsartBaud<16000000, 57600>::error == 79, "16MHz 57600 is 0.8% off");
+static_assert(UsartBaud<20000000, 38400>::error == 16, "20MHz 38400 is 0.2% off");
+static_assert(baudError(8000000, 115200) == 355, "8MHz 115200 is 3.5% off");
+
+// Over the default limit, but allowed with a looser one
+static_assert(UsartBaud<8000000, 115200, 400>::ubrr == 8, "8MHz 115200 with a 4% limit");
+static_assert(UsartBaud<8000000, 115200, 400>::doubleSpeed, "8MHz 115200 with a 4% limit");
+static_assert(UsartBaud<16000000, 115200>::settings().ubrr == 16, "16MHz 115200 at the default limit");
+
+// Rejections, UsartBaud itself would fail to compile on these (see UsartBaudRejectTest)
+static_assert(baudError(8000000, 230400) > DEFAULT_MAX_BAUD_ERROR, "8MHz cannot make 230400");
+static_assert(baudError(16000000, 3000000) > DEFAULT_MAX_BAUD_ERROR, "16MHz cannot make 3M");
+static_assert(baudError(20000000, 1000000) > DEFAULT_MAX_BAUD_ERROR, "20MHz cannot make 1M");
+static_assert(baudError(16000000, 230400) > DEFAULT_MAX_BAUD_ERROR, "16MHz 230400 is 3.5% off");
+static_assert(baudError(20000000, 300) == BAUD_ERROR_INVALID, "20MHz 300 baud needs more than 12 bits of UBRR");
+static_assert(baudError(16000000, 20000000) == BAUD_ERROR_INVALID, "Faster than the clock");
+
+namespace
+{
+    void testCalculateBaudSettings()
+    {
+        BaudSettings settings = calculateBaudSettings(BAUD_115200, 16000000);
+        CHECK(settings.doubleSpeed);
+        CHECK_EQUAL(settings.ubrr, 16);
+
+        settings = calculateBaudSettings(BAUD_9600, 20000000);
+        CHECK(!settings.doubleSpeed);
+        CHECK_EQUAL(settings.ubrr, 129);
+
+        // Too far off for the default limit
+        bool asserted = false;
+        try
+        {
+            calculateBaudSettings(BAUD_1000000, 20000000);
+        }
+        catch (HostSim::AssertFailed&)
+        {
+            asserted = true;
+        }
+        CHECK(asserted);
+    }
+
+    void testMatchBaudRate()
+    {
+        // Within AUTOBAUD_MAX_ERROR of a standard rate
+        CHECK_EQUAL(matchBaudRate(9600, 16000000), BAUD_9600);
+        CHECK_EQUAL(matchBaudRate(9900, 16000000), BAUD_9600);
+        CHECK_EQUAL(matchBaudRate(111111, 16000000), BAUD_115200);
+        CHECK_EQUAL(matchBaudRate(59000, 16000000), BAUD_57600);
+
+        // Between rates, or a rate the clock cannot make
+        CHECK_EQUAL(matchBaudRate(80000, 16000000), NUM_BAUD_RATES);
+        CHECK_EQUAL(matchBaudRate(1000000, 20000000), NUM_BAUD_RATES);
+        CHECK_EQUAL(matchBaudRate(115200, 8000000), NUM_BAUD_RATES);
+        CHECK_EQUAL(matchBaudRate(0, 16000000), NUM_BAUD_RATES);
+    }
+}
+
+int main()
+{
+    testCalculateBaudSettings();
+    testMatchBaudRate();
+    return HostTest::result();
+}
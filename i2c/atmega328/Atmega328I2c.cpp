@@ -2,6 +2,7 @@
 
 #include <avr/io.h>
 #include "utilities/print/Print.hpp"
+#include "drivers/log/BinaryLog.hpp"
 #include "drivers/timer/Delay.hpp"
 #include "drivers/dio/atmega328/Atmega328Dio.hpp"
 
@@ -220,7 +221,7 @@ namespace I2c
         uint8_t status = getStatus();
 
 #ifdef PRINT_I2C
-        if (status != START_SENT) PRINTLN("SF, status = 0x%x", status);
+        if (status != START_SENT) LOG("SF, status = 0x%x", status);
 #endif
 
         return (status == START_SENT);
@@ -259,7 +260,7 @@ namespace I2c
         uint8_t status = getStatus();
 
 #ifdef PRINT_I2C
-        if (status != successCode) PRINTLN("IDF, status = 0x%x", status);
+        if (status != successCode) LOG("IDF, status = 0x%x", status);
 #endif
 
         return (status == successCode);
@@ -278,7 +279,7 @@ namespace I2c
         uint8_t status = getStatus();
 
 #ifdef PRINT_I2C
-        if (status != DATA_SENT) PRINTLN("DTF, status = 0x%x", status);
+        if (status != DATA_SENT) LOG("DTF, status = 0x%x", status);
 #endif
         return (status == DATA_SENT);
     }
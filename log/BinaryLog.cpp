@@ -0,0 +1,68 @@
+#include "BinaryLog.hpp"
+#include "drivers/assert/Assert.hpp"
+
+using namespace SerialComm;
+
+namespace Log
+{
+    BinaryLog* pDefaultLog = nullptr;
+
+    void setDefaultLog(BinaryLog* pLog)
+    {
+        pDefaultLog = pLog;
+    }
+
+    BinaryLog::BinaryLog(PacketSerial* pPacketSerial,
+                         uint8_t* buffer,
+                         uint16_t bufferLen,
+                         Interrupt::IInterrupt* pIntControl):
+        pPacketSerial_(pPacketSerial),
+        buffer_(buffer, bufferLen),
+        pIntControl_(pIntControl),
+        droppedRecords_(0)
+    {
+        assertCustom(pPacketSerial_ != nullptr);
+        assertCustom(SpscRing<uint8_t>::isValidLength(bufferLen), "Log buffer length must be a power of two up to 128");
+    }
+
+    void BinaryLog::drain(uint8_t maxRecords)
+    {
+        uint8_t packet[LOG_MAX_PACKET];
+        uint8_t numSent = 0;
+
+        while ((maxRecords == 0) || (numSent < maxRecords))
+        {
+            // One byte to spare, for the delimiter ending a packet another sender had cut short
+            uint16_t txSpace = pPacketSerial_->getTxSpace();
+            uint16_t packetLength = 0;
+            uint8_t numRecords = 0;
+
+            // Records are pushed whole, so the rest of one is in the ring once its length is
+            const uint8_t* pLength;
+            while (((maxRecords == 0) || (numSent + numRecords < maxRecords)) &&
+                   ((pLength = buffer_.peek()) != nullptr))
+            {
+                uint16_t newLength = packetLength + 1 + *pLength;
+                if ((newLength > LOG_MAX_PACKET) ||
+                    (PacketSerial::getMaxEncodedLength(newLength) >= txSpace))
+                {
+                    break;
+                }
+
+                buffer_.read(&packet[packetLength], 1 + *pLength);
+                packetLength = newLength;
+                numRecords++;
+            }
+
+            // Nothing left, or the driver is too busy for even one more record
+            if (numRecords == 0) return;
+
+            if (!pPacketSerial_->sendPacket(packet, packetLength))
+            {
+                droppedRecords_ += numRecords;
+                return;
+            }
+            numSent += numRecords;
+        }
+    }
+}
@@ -0,0 +1,178 @@
+/**
+ * Deferred formatting log.
+ * 
+ * Instead of formatting text on the processor, a log call stores the flash address of its format
+ * string and the raw bytes of its arguments in a ring. drain() later sends the records over a
+ * PacketSerial, as many to a packet as fit, each still led by its length. It only sends what the
+ * driver has room for, so it never waits and leaves the rest in the ring for the next call.
+ * log/host/log_decoder.py rebuilds the text on the host using the flash image of the same build
+ * to look up the format strings.
+ * 
+ * Arguments are stored the way printf would receive them: integers smaller than int are promoted
+ * to int, and strings (%s) are copied in, up to LOG_MAX_STRING characters.
+ * 
+ * Use LOG("status = 0x%x", status), which falls back to PRINTLN unless BINARY_LOG is defined.
+ */
+#ifndef BINARY_LOG_HPP
+#define BINARY_LOG_HPP
+
+#include <stdint.h>
+#include <string.h>
+#include <avr/pgmspace.h>
+
+#include "drivers/serial/PacketSerial.hpp"
+#include "drivers/serial/SpscRing.hpp"
+#include "drivers/interrupt/IInterrupt.hpp"
+#include "utilities/print/Print.hpp"
+
+// Place a format string in flash, and give its address
+#define LOG_FORMAT(fmt) \
+    (__extension__({ static const char logFormat[] __attribute__((section(".progmem.logfmt"))) = (fmt); &logFormat[0]; }))
+
+#ifdef BINARY_LOG
+#define LOG(fmt, ...) Log::log(LOG_FORMAT(fmt), ##__VA_ARGS__)
+#else
+#define LOG(fmt, ...) PRINTLN(fmt, ##__VA_ARGS__)
+#endif
+
+namespace Log
+{
+    const static uint8_t LOG_MAX_RECORD = 32;   // Longest record, format ID and arguments
+    const static uint8_t LOG_MAX_PACKET = 64;   // Longest packet drain() sends, whole records each led by its length
+    const static uint8_t LOG_MAX_STRING = 16;   // Longest string argument copied, not including the terminator
+
+    class BinaryLog
+    {
+        public:
+            /**
+             * Constructor
+             * @param   pPacketSerial   Where records are sent by drain()
+             * @param   buffer          Ring that records are stored in until drained
+             * @param   bufferLen       Size of buffer, must be a power of two up to 128
+             * @param   pIntControl     If logging from interrupts, used to keep records whole. May be nullptr otherwise
+             */
+            BinaryLog(SerialComm::PacketSerial* pPacketSerial,
+                      uint8_t* buffer,
+                      uint16_t bufferLen,
+                      Interrupt::IInterrupt* pIntControl = nullptr);
+
+            /**
+             * Store a record
+             * @param   format  Format string in flash, from LOG_FORMAT
+             * @param   args    Arguments for the format string
+             */
+            template <typename... Args>
+            void log(const char* format, Args... args)
+            {
+                uint16_t length = sizeof(uint16_t) + argsLength(args...);
+                if (length > LOG_MAX_RECORD)
+                {
+                    droppedRecords_++;
+                    return;
+                }
+
+                if (pIntControl_ != nullptr) pIntControl_->pauseInterrupts();
+
+                // Records are stored whole or not at all, so drain() never sees part of one
+                if ((buffer_.capacity() - buffer_.length()) < (length + 1))
+                {
+                    droppedRecords_++;
+                }
+                else
+                {
+                    uint16_t id = (uint16_t)(uintptr_t)format;
+                    buffer_.push((uint8_t)length);
+                    buffer_.write((const uint8_t*)&id, sizeof(id));
+                    putArgs(args...);
+                }
+
+                if (pIntControl_ != nullptr) pIntControl_->resumeInterrupts();
+            }
+
+            /**
+             * Send stored records, as many as the driver has room for. Does not wait, call this
+             * repeatedly
+             * @param   maxRecords  Most records to send in this call, 0 for all that fit
+             */
+            void drain(uint8_t maxRecords = 0);
+
+            /**
+             * @return  Number of records dropped because the ring was full or they were too long
+             */
+            uint16_t getDroppedRecords() { return droppedRecords_; }
+
+        private:
+            SerialComm::PacketSerial* pPacketSerial_;   // Where records are sent
+            SerialComm::SpscRing<uint8_t> buffer_;      // Records waiting to be sent, each is its length and then its bytes
+            Interrupt::IInterrupt* pIntControl_;        // Interrupt enable/disable object, may be nullptr
+            uint16_t droppedRecords_;                   // Records that did not fit
+
+            static uint16_t argsLength() { return 0; }
+
+            template <typename T, typename... Rest>
+            static uint16_t argsLength(T arg, Rest... rest)
+            {
+                return argLength(arg) + argsLength(rest...);
+            }
+
+            template <typename T>
+            static uint16_t argLength(T arg)
+            {
+                return sizeof(+arg);
+            }
+
+            static uint16_t argLength(const char* arg)
+            {
+                return strnlen(arg, LOG_MAX_STRING) + 1;
+            }
+
+            static uint16_t argLength(char* arg)
+            {
+                return argLength((const char*)arg);
+            }
+
+            void putArgs() {}
+
+            template <typename T, typename... Rest>
+            void putArgs(T arg, Rest... rest)
+            {
+                putArg(arg);
+                putArgs(rest...);
+            }
+
+            template <typename T>
+            void putArg(T arg)
+            {
+                // Promote like a variadic call would, so the host knows the size from the format
+                auto promoted = +arg;
+                buffer_.write((const uint8_t*)&promoted, sizeof(promoted));
+            }
+
+            void putArg(const char* arg)
+            {
+                uint16_t length = strnlen(arg, LOG_MAX_STRING);
+                buffer_.write((const uint8_t*)arg, length);
+                buffer_.push('\0');
+            }
+
+            void putArg(char* arg)
+            {
+                putArg((const char*)arg);
+            }
+    };
+
+    /**
+     * Set the log used by LOG() when BINARY_LOG is defined
+     */
+    void setDefaultLog(BinaryLog* pLog);
+
+    extern BinaryLog* pDefaultLog;
+
+    template <typename... Args>
+    void log(const char* format, Args... args)
+    {
+        if (pDefaultLog != nullptr) pDefaultLog->log(format, args...);
+    }
+}
+
+#endif
@@ -0,0 +1,117 @@
+#!/usr/bin/env python3
+"""
+Host decoder for Log::BinaryLog.
+
+Records arrive in PacketSerial packets, one or more to a packet, each led by its length. A record
+holds the flash address of its format string (16 bits, little endian) followed by the raw argument
+bytes. The format strings are looked up in
+the flash image of the build that is running:
+    avr-objcopy -O binary -R .eeprom firmware.elf flash.bin
+    log_decoder.py flash.bin < capture.bin
+    log_decoder.py flash.bin --port /dev/ttyUSB0 --baud 115200     (needs pyserial)
+"""
+
+import argparse
+import os
+import re
+import struct
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "serial", "host"))
+import packet_serial  # noqa: E402
+
+# printf conversions, with the flags/width/precision and length modifier split out
+SPEC_PATTERN = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l)?([diouxXcsfeEgGp%])")
+
+INT_SIZE = 2        # sizeof(int) on AVR
+FLOAT_SIZE = 4      # float and double are both 4 bytes on AVR
+
+
+def read_format(flash, address):
+    end = flash.index(b"\0", address)
+    return flash[address:end].decode("ascii", "replace")
+
+
+def format_record(format_string, args):
+    offset = 0
+    values = []
+
+    def convert(match):
+        nonlocal offset
+        flags, length, conversion = match.groups()
+        if conversion == "%":
+            return "%%"
+
+        if conversion == "s":
+            end = args.index(b"\0", offset)
+            values.append(args[offset:end].decode("ascii", "replace"))
+            offset = end + 1
+        elif conversion in "feEgG":
+            values.append(struct.unpack_from("<f", args, offset)[0])
+            offset += FLOAT_SIZE
+        else:
+            size = {"ll": 8, "l": 4}.get(length, INT_SIZE)
+            value = int.from_bytes(args[offset:offset + size], "little", signed=conversion in "di")
+            offset += size
+            values.append(value)
+            if conversion == "p":
+                return "0x%" + flags + "x"
+        return "%" + flags + conversion
+
+    python_format = SPEC_PATTERN.sub(convert, format_string)
+    return python_format % tuple(values)
+
+
+def split_records(packet):
+    """Records in a packet, None in place of the rest if its lengths do not add up"""
+    index = 0
+    while index < len(packet):
+        length = packet[index]
+        record = packet[index + 1:index + 1 + length]
+        if length < 2 or len(record) != length:
+            yield None
+            return
+        yield record
+        index += 1 + length
+
+
+def decode_record(flash, record):
+    address = record[0] | (record[1] << 8)
+    try:
+        return format_record(read_format(flash, address), record[2:])
+    except (ValueError, IndexError, TypeError, struct.error):
+        return "<undecodable record: format 0x%04x, args %s>" % (address, record[2:].hex(" "))
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("flash", help="flash image of the running build, from avr-objcopy -O binary")
+    parser.add_argument("--port", help="serial port to read, stdin if not given")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    with open(args.flash, "rb") as flash_file:
+        flash = flash_file.read()
+
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+        read = lambda: stream.read(stream.in_waiting or 1)
+    else:
+        read = lambda: sys.stdin.buffer.read1(4096)
+
+    decoder = packet_serial.PacketDecoder()
+    while True:
+        data = read()
+        if not data:
+            break
+        for packet in decoder.feed(data):
+            for record in split_records(packet):
+                if record is None:
+                    print("<malformed packet: %s>" % bytes(packet).hex(" "), flush=True)
+                else:
+                    print(decode_record(flash, record), flush=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,316 @@
+#include "ModbusSlave.hpp"
+#include "drivers/serial/Crc16.hpp"
+#include "drivers/assert/Assert.hpp"
+
+using namespace SerialComm;
+
+namespace Modbus
+{
+    const static uint8_t BROADCAST_ADDRESS = 0;
+    const static uint8_t MAX_SLAVE_ADDRESS = 247;
+    const static uint8_t MIN_FRAME_LENGTH = 4;      // Address, function code and CRC
+    const static uint8_t EXCEPTION_FLAG = 0x80;     // Set in the function code of an exception answer
+
+    // Function codes
+    const static uint8_t READ_HOLDING_REGISTERS = 0x03;
+    const static uint8_t READ_INPUT_REGISTERS = 0x04;
+    const static uint8_t WRITE_SINGLE_REGISTER = 0x06;
+    const static uint8_t WRITE_MULTIPLE_REGISTERS = 0x10;
+
+    const static uint16_t MAX_READ_REGISTERS = 125;
+    const static uint16_t MAX_WRITE_REGISTERS = 123;
+
+    // Above 19200 baud the gap is a fixed 1750us, below it is 3.5 characters of 11 bits
+    const static uint32_t FIXED_GAP_MIN_BAUD = 19200;
+
+    ModbusSlave* ModbusSlave::pInstance_ = nullptr;
+
+    static uint16_t readWord(const uint8_t* data)
+    {
+        return ((uint16_t)data[0] << 8) | data[1];
+    }
+
+    static void writeWord(uint8_t* data, uint16_t value)
+    {
+        data[0] = (uint8_t)(value >> 8);
+        data[1] = (uint8_t)value;
+    }
+
+    ModbusSlave::ModbusSlave(ISerial* pSerial,
+                             uint8_t address,
+                             RegisterMap registers,
+                             uint8_t* frameBuffer,
+                             uint16_t frameBufferLen,
+                             Timer::ITimer* pGapTimer,
+                             uint32_t timerTicksPerSecond,
+                             uint32_t baudRate):
+        pSerial_(pSerial),
+        address_(address),
+        registers_(registers),
+        frameBuffer_(frameBuffer),
+        frameBufferLen_(frameBufferLen),
+        pGapTimer_(pGapTimer),
+        gapTop_(0),
+        rxFrameBytes_(0),
+        frameLengths_(frameLengthStorage_, FRAME_QUEUE_LENGTH),
+        pTimeoutTimer_(nullptr),
+        txTimeoutMs_(0),
+        badFrames_(0),
+        exceptions_(0),
+        txFailures_(0)
+    {
+        assertCustom((address_ != BROADCAST_ADDRESS) && (address_ <= MAX_SLAVE_ADDRESS), "Invalid Modbus address");
+        assertCustom((frameBufferLen_ >= MIN_FRAME_LENGTH + 4) && (frameBufferLen_ <= MODBUS_MAX_FRAME));
+
+        // Round the gap up, stretching it is safe but cutting it short splits frames
+        uint32_t gapTics;
+        if (baudRate > FIXED_GAP_MIN_BAUD)
+        {
+            // 1750us is 7/4000 of a second
+            gapTics = ((timerTicksPerSecond * 7) + 3999) / 4000;
+        }
+        else
+        {
+            gapTics = ((timerTicksPerSecond * 77) + (2 * baudRate) - 1) / (2 * baudRate);
+        }
+        // Timer periods are top values, one less than the number of ticks
+        assertCustom((gapTics > 1) && (gapTics - 1 <= pGapTimer_->getMaxPeriodTics()), "Modbus gap timer cannot fit baud rate");
+        gapTop_ = gapTics - 1;
+
+        // Only one slave can own the callbacks
+        assertCustom(pInstance_ == nullptr);
+        pInstance_ = this;
+    }
+
+    void ModbusSlave::initialize()
+    {
+        pGapTimer_->disable();
+        pGapTimer_->setPeriodTics(gapTop_);
+        pGapTimer_->setInterrupt(HandleFrameGap);
+    }
+
+    void ModbusSlave::HandleByteReceived()
+    {
+        ModbusSlave* pSlave = pInstance_;
+        pSlave->rxFrameBytes_++;
+        pSlave->pGapTimer_->reset();
+        pSlave->pGapTimer_->enable();
+    }
+
+    void ModbusSlave::HandleFrameGap()
+    {
+        ModbusSlave* pSlave = pInstance_;
+        pSlave->pGapTimer_->disable();
+
+        // If the queue is full the bytes are kept and merged into the next frame, which then fails
+        // its CRC, but the frames after it still line up with the RX buffer
+        if ((pSlave->rxFrameBytes_ != 0) && pSlave->frameLengths_.push(pSlave->rxFrameBytes_))
+        {
+            pSlave->rxFrameBytes_ = 0;
+        }
+    }
+
+    void ModbusSlave::update()
+    {
+        uint16_t length;
+        while (frameLengths_.pop(length))
+        {
+            if (length > frameBufferLen_)
+            {
+                // Too long for us, it is still in the RX buffer and has to be skipped
+                uint16_t remaining = length;
+                while (remaining > 0)
+                {
+                    uint16_t chunk = (remaining > frameBufferLen_) ? frameBufferLen_ : remaining;
+                    remaining -= pSerial_->read(frameBuffer_, chunk);
+                }
+                badFrames_++;
+                continue;
+            }
+
+            // The bytes were buffered before the gap ended the frame, so they are all there
+            uint16_t bytesRead = 0;
+            while (bytesRead < length)
+            {
+                bytesRead += pSerial_->read(&frameBuffer_[bytesRead], length - bytesRead);
+            }
+
+            processFrame(length);
+        }
+    }
+
+    void ModbusSlave::processFrame(uint16_t length)
+    {
+        if (length < MIN_FRAME_LENGTH)
+        {
+            badFrames_++;
+            return;
+        }
+
+        uint16_t received = frameBuffer_[length - 2] | ((uint16_t)frameBuffer_[length - 1] << 8);
+        if (crc16(frameBuffer_, length - 2) != received)
+        {
+            badFrames_++;
+            return;
+        }
+
+        uint8_t address = frameBuffer_[0];
+        if ((address != address_) && (address != BROADCAST_ADDRESS)) return;
+
+        uint8_t* pdu = &frameBuffer_[1];
+        uint16_t answerLength = 0;
+        ModbusException exception = handleRequest(pdu, length - 3, &answerLength);
+
+        // Broadcasts are never answered
+        if (address == BROADCAST_ADDRESS) return;
+
+        if (exception != EXCEPTION_NONE)
+        {
+            exceptions_++;
+            pdu[0] |= EXCEPTION_FLAG;
+            pdu[1] = exception;
+            answerLength = 2;
+        }
+
+        sendFrame(1 + answerLength);
+    }
+
+    ModbusException ModbusSlave::handleRequest(uint8_t* pdu, uint16_t length, uint16_t* pAnswerLen)
+    {
+        switch (pdu[0])
+        {
+            case READ_HOLDING_REGISTERS:
+                return readRegisters(pdu, length, registers_.holdingRegisters, registers_.numHoldingRegisters, pAnswerLen);
+
+            case READ_INPUT_REGISTERS:
+                return readRegisters(pdu, length, registers_.inputRegisters, registers_.numInputRegisters, pAnswerLen);
+
+            case WRITE_SINGLE_REGISTER:
+                return writeSingleRegister(pdu, length, pAnswerLen);
+
+            case WRITE_MULTIPLE_REGISTERS:
+                return writeMultipleRegisters(pdu, length, pAnswerLen);
+
+            default:
+                return EXCEPTION_ILLEGAL_FUNCTION;
+        }
+    }
+
+    ModbusException ModbusSlave::readRegisters(uint8_t* pdu,
+                                               uint16_t length,
+                                               const uint16_t* registers,
+                                               uint16_t numRegisters,
+                                               uint16_t* pAnswerLen)
+    {
+        if (length != 5) return EXCEPTION_ILLEGAL_DATA_VALUE;
+
+        uint16_t start = readWord(&pdu[1]);
+        uint16_t quantity = readWord(&pdu[3]);
+
+        // Answer is function code, byte count and the registers, plus address and CRC around it
+        if ((quantity == 0) || (quantity > MAX_READ_REGISTERS) ||
+            ((uint32_t)(2 + (2 * quantity) + 3) > frameBufferLen_))
+        {
+            return EXCEPTION_ILLEGAL_DATA_VALUE;
+        }
+
+        if ((registers == nullptr) || ((uint32_t)start + quantity > numRegisters))
+        {
+            return EXCEPTION_ILLEGAL_DATA_ADDRESS;
+        }
+
+        pdu[1] = (uint8_t)(2 * quantity);
+        for (uint16_t i=0; i<quantity; i++)
+        {
+            writeWord(&pdu[2 + (2 * i)], registers[start + i]);
+        }
+
+        *pAnswerLen = 2 + (2 * quantity);
+        return EXCEPTION_NONE;
+    }
+
+    ModbusException ModbusSlave::writeSingleRegister(uint8_t* pdu, uint16_t length, uint16_t* pAnswerLen)
+    {
+        if (length != 5) return EXCEPTION_ILLEGAL_DATA_VALUE;
+
+        uint16_t address = readWord(&pdu[1]);
+        if ((registers_.holdingRegisters == nullptr) || (address >= registers_.numHoldingRegisters))
+        {
+            return EXCEPTION_ILLEGAL_DATA_ADDRESS;
+        }
+
+        registers_.holdingRegisters[address] = readWord(&pdu[3]);
+        if (registers_.onWrite != nullptr) registers_.onWrite(address, 1);
+
+        // Answer echoes the request
+        *pAnswerLen = 5;
+        return EXCEPTION_NONE;
+    }
+
+    ModbusException ModbusSlave::writeMultipleRegisters(uint8_t* pdu, uint16_t length, uint16_t* pAnswerLen)
+    {
+        if (length < 6) return EXCEPTION_ILLEGAL_DATA_VALUE;
+
+        uint16_t start = readWord(&pdu[1]);
+        uint16_t quantity = readWord(&pdu[3]);
+        uint8_t byteCount = pdu[5];
+
+        if ((quantity == 0) || (quantity > MAX_WRITE_REGISTERS) ||
+            (byteCount != (2 * quantity)) || (length != (6u + byteCount)))
+        {
+            return EXCEPTION_ILLEGAL_DATA_VALUE;
+        }
+
+        if ((registers_.holdingRegisters == nullptr) || ((uint32_t)start + quantity > registers_.numHoldingRegisters))
+        {
+            return EXCEPTION_ILLEGAL_DATA_ADDRESS;
+        }
+
+        for (uint16_t i=0; i<quantity; i++)
+        {
+            registers_.holdingRegisters[start + i] = readWord(&pdu[6 + (2 * i)]);
+        }
+        if (registers_.onWrite != nullptr) registers_.onWrite(start, quantity);
+
+        // Answer is the function code, start and quantity, which are already in place
+        *pAnswerLen = 5;
+        return EXCEPTION_NONE;
+    }
+
+    void ModbusSlave::sendFrame(uint16_t length)
+    {
+        uint16_t crc = crc16(frameBuffer_, length);
+        frameBuffer_[length++] = (uint8_t)crc;
+        frameBuffer_[length++] = (uint8_t)(crc >> 8);
+
+        bool waitAllowed = (pTimeoutTimer_ != nullptr) && (txTimeoutMs_ != 0);
+        if (waitAllowed)
+        {
+            pTimeoutTimer_->setPeriodMs(txTimeoutMs_);
+            pTimeoutTimer_->enable();
+        }
+        else if (pSerial_->getTxSpace() < length)
+        {
+            // A gap inside the frame would split it, sending none of it is better
+            txFailures_++;
+            return;
+        }
+
+        // Only offer what the driver has room for, a driver refusing bytes counts them as dropped
+        uint16_t bytesWritten = 0;
+        while (bytesWritten < length)
+        {
+            uint16_t space = pSerial_->getTxSpace();
+            if (space == 0)
+            {
+                if (waitAllowed && !pTimeoutTimer_->hasOneShotPassed()) continue;
+
+                txFailures_++;
+                return;
+            }
+
+            uint16_t remaining = length - bytesWritten;
+            bytesWritten += pSerial_->write(&frameBuffer_[bytesWritten], (remaining < space) ? remaining : space);
+        }
+    }
+}
@@ -0,0 +1,174 @@
+/**
+ * Modbus RTU slave.
+ * 
+ * Frames are delimited by the 3.5 character silent interval. Every received byte restarts a timer
+ * compare, and when it fires the bytes since the previous gap are a frame. Frames are then checked
+ * and answered from update() in the main loop, out of caller supplied register arrays.
+ * 
+ * Supported functions: read holding registers (0x03), read input registers (0x04), write single
+ * register (0x06) and write multiple registers (0x10). Broadcasts (address 0) are applied without
+ * an answer. The 1.5 character inter-character limit is not enforced.
+ * 
+ * An answer only goes to the driver if it has room for all of it, so update() never waits. With a
+ * timeout timer set, answers longer than the driver's buffer are fed in as room frees up instead,
+ * for up to the timeout. One cut short reaches the master as a frame failing its CRC.
+ * 
+ * Wiring, with an Atmega328AsynchUsart and a timer used only for this:
+ *     uart.setByteCallback(Modbus::ModbusSlave::HandleByteReceived);
+ *     gapTimer CTC interrupt calls Modbus::ModbusSlave::HandleFrameGap (done by initialize())
+ */
+#ifndef MODBUS_SLAVE_HPP
+#define MODBUS_SLAVE_HPP
+
+#include <stdint.h>
+#include "drivers/serial/ISerial.hpp"
+#include "drivers/serial/SpscRing.hpp"
+#include "drivers/timer/ITimer.hpp"
+
+namespace Modbus
+{
+    const static uint16_t MODBUS_MAX_FRAME = 256;   // Longest RTU frame, address + PDU + CRC
+
+    enum ModbusException: uint8_t
+    {
+        EXCEPTION_NONE = 0,
+        EXCEPTION_ILLEGAL_FUNCTION = 0x01,
+        EXCEPTION_ILLEGAL_DATA_ADDRESS = 0x02,
+        EXCEPTION_ILLEGAL_DATA_VALUE = 0x03
+    };
+
+    /**
+     * Registers served by the slave, owned by the caller
+     */
+    struct RegisterMap
+    {
+        uint16_t* holdingRegisters;     // Read and written by the master, may be nullptr
+        uint16_t numHoldingRegisters;
+        const uint16_t* inputRegisters; // Read by the master, may be nullptr
+        uint16_t numInputRegisters;
+
+        // Called after the master writes holding registers, may be nullptr
+        void (*onWrite)(uint16_t firstRegister, uint16_t numRegisters);
+    };
+
+    class ModbusSlave
+    {
+        public:
+            /**
+             * Constructor
+             * @param   pSerial             Serial the bus is on, its RX data is only read by this slave
+             * @param   address             This slave's address, 1 to 247
+             * @param   registers           Registers to serve
+             * @param   frameBuffer         Buffer for a received frame and its answer
+             * @param   frameBufferLen      Size of frameBuffer, up to MODBUS_MAX_FRAME. Longer frames are dropped
+             * @param   pGapTimer           Timer for the inter-frame gap, its interrupt is taken over
+             * @param   timerTicksPerSecond Frequency the gap timer counts at
+             * @param   baudRate            Bus baud rate
+             */
+            ModbusSlave(SerialComm::ISerial* pSerial,
+                        uint8_t address,
+                        RegisterMap registers,
+                        uint8_t* frameBuffer,
+                        uint16_t frameBufferLen,
+                        Timer::ITimer* pGapTimer,
+                        uint32_t timerTicksPerSecond,
+                        uint32_t baudRate);
+
+            /**
+             * Set up the gap timer, must be done after static initialization
+             */
+            void initialize();
+
+            /**
+             * Let answers wait for room in the driver
+             * @param   pTimer      Timer to time out with, nullptr to never wait
+             * @param   timeoutMs   Longest to spend sending one answer, should be well inside the
+             *                      master's response timeout
+             */
+            void setTimeoutTimer(Timer::SoftwareTimer* pTimer, uint16_t timeoutMs)
+            {
+                pTimeoutTimer_ = pTimer;
+                txTimeoutMs_ = timeoutMs;
+            }
+
+            /**
+             * Answer any complete frames, call from the main loop
+             */
+            void update();
+
+            /**
+             * @return  Number of frames dropped because of a bad CRC or length
+             */
+            uint16_t getBadFrames() { return badFrames_; }
+
+            /**
+             * @return  Number of frames answered with an exception
+             */
+            uint16_t getExceptions() { return exceptions_; }
+
+            /**
+             * @return  Number of answers not sent, or cut short, because the driver had no room
+             */
+            uint16_t getTxFailures() { return txFailures_; }
+
+            /**
+             * Callback for every byte received, restarts the gap timer
+             */
+            static void HandleByteReceived();
+
+            /**
+             * Callback for the gap timer, ends the frame being received
+             */
+            static void HandleFrameGap();
+
+        private:
+            const static uint8_t FRAME_QUEUE_LENGTH = 4;    // Must be a power of two
+
+            SerialComm::ISerial* pSerial_;
+            uint8_t address_;
+            RegisterMap registers_;
+            uint8_t* frameBuffer_;
+            uint16_t frameBufferLen_;
+
+            Timer::ITimer* pGapTimer_;
+            uint16_t gapTop_;               // Timer period of the 3.5 character gap, as a top value
+
+            uint16_t rxFrameBytes_;         // Bytes received since the last gap, only used by the ISRs
+            uint16_t frameLengthStorage_[FRAME_QUEUE_LENGTH];
+            SerialComm::SpscRing<uint16_t> frameLengths_;   // Length of each frame in the RX buffer, pushed by the gap ISR
+
+            Timer::SoftwareTimer* pTimeoutTimer_;  // Timeout for answers waiting on the driver, may be nullptr
+            uint16_t txTimeoutMs_;
+
+            uint16_t badFrames_;
+            uint16_t exceptions_;
+            uint16_t txFailures_;
+
+            static ModbusSlave* pInstance_;
+
+            /**
+             * Check and answer a frame in frameBuffer_
+             */
+            void processFrame(uint16_t length);
+
+            /**
+             * Run a request's function
+             * @param   pdu         Function code and data, replaced by the answer
+             * @param   length      Length of the request PDU
+             * @param   pAnswerLen  Set to the length of the answer PDU
+             * @return  Exception code, EXCEPTION_NONE on success
+             */
+            ModbusException handleRequest(uint8_t* pdu, uint16_t length, uint16_t* pAnswerLen);
+
+            ModbusException readRegisters(uint8_t* pdu, uint16_t length, const uint16_t* registers, uint16_t numRegisters, uint16_t* pAnswerLen);
+            ModbusException writeSingleRegister(uint8_t* pdu, uint16_t length, uint16_t* pAnswerLen);
+            ModbusException writeMultipleRegisters(uint8_t* pdu, uint16_t length, uint16_t* pAnswerLen);
+
+            /**
+             * Add the CRC to a frame in frameBuffer_ and send it, counting a TX failure if the driver has no room
+             */
+            void sendFrame(uint16_t length);
+    };
+}
+
+#endif
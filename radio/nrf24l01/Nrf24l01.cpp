@@ -1,6 +1,7 @@
 #include "Nrf24l01.hpp"
 #include "drivers/timer/Delay.hpp"
 #include "utilities/print/Print.hpp"
+#include "drivers/log/BinaryLog.hpp"
 
 using namespace Spi;
 using namespace Dio;
@@ -450,15 +451,15 @@ namespace Radio
 #ifdef DEBUG_RADIO
         if (status & (1 << TX_DS))
         {
-            PRINTLN("Transmission successful!");
+            LOG("Transmission successful!");
         }
         else if (status & (1 << MAX_RT))
         {
-            PRINTLN("Transmission failed: max retries used");
+            LOG("Transmission failed: max retries used");
         }
         else
         {
-            PRINTLN("Transmission failed: unknown reason");
+            LOG("Transmission failed: unknown reason");
         }
 #endif
 
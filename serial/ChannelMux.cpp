@@ -0,0 +1,187 @@
+#include "ChannelMux.hpp"
+#include "drivers/assert/Assert.hpp"
+
+namespace SerialComm
+{
+    // Channel ID, CRC, at most one COBS code per frame since frames are under 254 bytes, and delimiter
+    const static uint8_t MUX_FRAME_OVERHEAD = 1 + PACKET_CRC_LENGTH + 1 + 1;
+
+    MuxChannel::MuxChannel(uint8_t id,
+                           uint8_t* txBuffer,
+                           uint16_t txBufferLen,
+                           uint8_t* rxBuffer,
+                           uint16_t rxBufferLen,
+                           uint8_t priority,
+                           uint8_t weight):
+        id_(id),
+        priority_(priority),
+        weight_(weight),
+        credits_(weight),
+        txBuffer_(txBuffer, txBufferLen),
+        rxBuffer_(rxBuffer, rxBufferLen),
+        rxStatistics_()
+    {
+        assertCustom(SpscRing<uint8_t>::isValidLength(txBufferLen) &&
+                     SpscRing<uint8_t>::isValidLength(rxBufferLen),
+                     "Channel buffer lengths must be powers of two up to 128");
+        assertCustom(weight_ > 0);
+    }
+
+    bool MuxChannel::isDataAvailable()
+    {
+        return !rxBuffer_.isEmpty();
+    }
+
+    uint16_t MuxChannel::write(const uint8_t* buff, uint16_t numBytes)
+    {
+        return txBuffer_.write(buff, numBytes);
+    }
+
+    uint16_t MuxChannel::read(uint8_t* buff, uint16_t numBytes)
+    {
+        return rxBuffer_.read(buff, numBytes);
+    }
+
+    uint16_t MuxChannel::getTxSpace()
+    {
+        return txBuffer_.capacity() - txBuffer_.length();
+    }
+
+    void MuxChannel::flush()
+    {
+        flushRx();
+        flushTx();
+    }
+
+    void MuxChannel::flushRx()
+    {
+        rxBuffer_.flush();
+    }
+
+    void MuxChannel::flushTx()
+    {
+        // The mux consumes the TX queue from the main loop as well, so this is not racing it
+        txBuffer_.flush();
+    }
+
+    ChannelMux::ChannelMux(ISerial* pSerial, uint8_t* rxPacketBuffer, uint16_t rxPacketBufferLen):
+        pSerial_(pSerial),
+        packetSerial_(pSerial, rxPacketBuffer, rxPacketBufferLen),
+        channels_{ nullptr },
+        numChannels_(0),
+        nextChannel_(0),
+        unknownChannelFrames_(0)
+    {}
+
+    void ChannelMux::addChannel(MuxChannel* pChannel)
+    {
+        assertCustom(numChannels_ < MAX_MUX_CHANNELS);
+        for (uint8_t i=0; i<numChannels_; i++)
+        {
+            assertCustom(channels_[i]->id_ != pChannel->id_, "Duplicate mux channel ID");
+        }
+
+        channels_[numChannels_++] = pChannel;
+    }
+
+    void ChannelMux::service()
+    {
+        const uint8_t* frame;
+        uint16_t length;
+        while ((length = packetSerial_.receivePacket(&frame)) != 0)
+        {
+            receiveFrame(frame, length);
+        }
+
+        while (true)
+        {
+            uint8_t turn = nextChannel_;
+            MuxChannel* pChannel = pickChannel();
+            if (pChannel == nullptr) return;
+
+            // A frame shorter than the queued data is sent rather than none, so a driver with a
+            // small TX buffer cannot leave the first channel holding the link forever
+            uint16_t txSpace = pSerial_->getTxSpace();
+            if (txSpace <= MUX_FRAME_OVERHEAD)
+            {
+                // Driver is busy, the channel keeps its turn for the next call
+                pChannel->credits_++;
+                nextChannel_ = turn;
+                return;
+            }
+
+            uint8_t frameData[1 + MUX_MAX_FRAME_DATA];
+            uint16_t dataLength = pChannel->txBuffer_.length();
+            if (dataLength > MUX_MAX_FRAME_DATA) dataLength = MUX_MAX_FRAME_DATA;
+            if (dataLength > txSpace - MUX_FRAME_OVERHEAD) dataLength = txSpace - MUX_FRAME_OVERHEAD;
+
+            frameData[0] = pChannel->id_;
+            pChannel->txBuffer_.read(&frameData[1], dataLength);
+            packetSerial_.sendPacket(frameData, dataLength + 1);
+        }
+    }
+
+    void ChannelMux::receiveFrame(const uint8_t* frame, uint16_t length)
+    {
+        for (uint8_t i=0; i<numChannels_; i++)
+        {
+            MuxChannel* pChannel = channels_[i];
+            if (pChannel->id_ != frame[0]) continue;
+
+            uint16_t dataLength = length - 1;
+            uint16_t accepted = pChannel->rxBuffer_.write(&frame[1], dataLength);
+            pChannel->rxStatistics_.droppedBytes += dataLength - accepted;
+            return;
+        }
+
+        unknownChannelFrames_++;
+    }
+
+    MuxChannel* ChannelMux::pickChannel()
+    {
+        // Strict priority between levels, the best level with anything to send goes next
+        bool found = false;
+        uint8_t priority = 0xFF;
+        for (uint8_t i=0; i<numChannels_; i++)
+        {
+            MuxChannel* pChannel = channels_[i];
+            if (pChannel->txBuffer_.isEmpty()) continue;
+
+            if (!found || (pChannel->priority_ < priority))
+            {
+                priority = pChannel->priority_;
+                found = true;
+            }
+        }
+
+        if (!found) return nullptr;
+
+        // Weighted round robin within the level, when every waiting channel has used its credits
+        // the round is over and they are topped up
+        for (uint8_t pass=0; pass<2; pass++)
+        {
+            for (uint8_t i=0; i<numChannels_; i++)
+            {
+                uint8_t index = (nextChannel_ + i) % numChannels_;
+                MuxChannel* pChannel = channels_[index];
+                if ((pChannel->priority_ != priority) ||
+                    pChannel->txBuffer_.isEmpty() ||
+                    (pChannel->credits_ == 0))
+                {
+                    continue;
+                }
+
+                pChannel->credits_--;
+                nextChannel_ = (pChannel->credits_ == 0) ? (index + 1) % numChannels_ : index;
+                return pChannel;
+            }
+
+            for (uint8_t i=0; i<numChannels_; i++)
+            {
+                if (channels_[i]->priority_ == priority) channels_[i]->credits_ = channels_[i]->weight_;
+            }
+        }
+
+        return nullptr;
+    }
+}
@@ -0,0 +1,136 @@
+/**
+ * Several logical serial channels sharing one ISerial.
+ * 
+ * Each MuxChannel is an ISerial with its own small TX and RX queues. ChannelMux::service() moves
+ * queued TX data out as PacketSerial packets whose first byte is the channel ID, and hands the
+ * data of received packets to the channel with that ID. serial/host/channel_demux.py splits the
+ * streams apart again on the host.
+ * 
+ * Channels with a lower priority number are always sent first. Channels with the same priority
+ * share the link by weight, each sending up to weight frames per round.
+ * 
+ * The mux only sends a frame once the driver has room for all of it, so service() never blocks.
+ * Frames are shortened to fit the room the driver has. Keep the driver's own TX buffer small (a few
+ * frames), the backlog belongs in the channel queues where priority applies, not in the driver
+ * where it is sent in order.
+ */
+#ifndef CHANNEL_MUX_HPP
+#define CHANNEL_MUX_HPP
+
+#include <stdint.h>
+#include "drivers/serial/ISerial.hpp"
+#include "drivers/serial/PacketSerial.hpp"
+#include "drivers/serial/SpscRing.hpp"
+
+namespace SerialComm
+{
+    const static uint8_t MAX_MUX_CHANNELS = 4;
+    const static uint8_t MUX_MAX_FRAME_DATA = 32;   // Most channel data bytes sent in one frame
+
+    class ChannelMux;
+
+    class MuxChannel : public ISerial
+    {
+        public:
+            /**
+             * Constructor
+             * @param   id          Channel ID sent in each frame, must be unique on the mux
+             * @param   txBuffer    Queue for data written to the channel, until the mux sends it
+             * @param   txBufferLen Size of txBuffer, must be a power of two up to 128
+             * @param   rxBuffer    Queue for data received on the channel, until it is read
+             * @param   rxBufferLen Size of rxBuffer, must be a power of two up to 128
+             * @param   priority    Lower numbers are sent first
+             * @param   weight      Frames sent per round, relative to other channels of the same priority
+             */
+            MuxChannel(uint8_t id,
+                       uint8_t* txBuffer,
+                       uint16_t txBufferLen,
+                       uint8_t* rxBuffer,
+                       uint16_t rxBufferLen,
+                       uint8_t priority = 0,
+                       uint8_t weight = 1);
+
+            bool isDataAvailable() override;
+
+            /**
+             * Queue data to be sent, only as much as fits is taken
+             * @return  Number of bytes queued
+             */
+            uint16_t write(const uint8_t* buff, uint16_t numBytes) override;
+            uint16_t read(uint8_t* buff, uint16_t numBytes) override;
+            uint16_t getTxSpace() override;
+
+            void flush() override;
+            void flushRx() override;
+            void flushTx() override;
+
+            /**
+             * @return  Only droppedBytes is counted, for received data that did not fit in the RX queue
+             */
+            RxStatistics getRxStatistics() override { return rxStatistics_; }
+            void resetRxStatistics() override { rxStatistics_ = RxStatistics(); }
+
+        private:
+            friend class ChannelMux;
+
+            uint8_t id_;            // Channel ID sent in each frame
+            uint8_t priority_;      // Lower numbers are sent first
+            uint8_t weight_;        // Frames per round within the same priority
+            uint8_t credits_;       // Frames left in this round
+
+            SpscRing<uint8_t> txBuffer_;    // Data waiting for the mux to send it
+            SpscRing<uint8_t> rxBuffer_;    // Data waiting to be read
+            RxStatistics rxStatistics_;
+    };
+
+    class ChannelMux
+    {
+        public:
+            /**
+             * Constructor
+             * @param   pSerial             Driver the channels share
+             * @param   rxPacketBuffer      Buffer to collect incoming frames in
+             * @param   rxPacketBufferLen   Size of rxPacketBuffer, at least the largest frame the host sends
+             */
+            ChannelMux(ISerial* pSerial, uint8_t* rxPacketBuffer, uint16_t rxPacketBufferLen);
+
+            /**
+             * Add a channel to the mux
+             */
+            void addChannel(MuxChannel* pChannel);
+
+            /**
+             * Route received frames to their channels, and send queued channel data while the
+             * driver has room. Does not block, call this from the main loop.
+             */
+            void service();
+
+            /**
+             * @return  Number of received frames dropped because no channel had their ID
+             */
+            uint16_t getUnknownChannelFrames() { return unknownChannelFrames_; }
+
+        private:
+            ISerial* pSerial_;              // Driver the channels share
+            PacketSerial packetSerial_;     // Framing over pSerial_
+
+            MuxChannel* channels_[MAX_MUX_CHANNELS];
+            uint8_t numChannels_;
+            uint8_t nextChannel_;           // Where the weighted round robin continues from
+
+            uint16_t unknownChannelFrames_;
+
+            /**
+             * Route one received frame
+             */
+            void receiveFrame(const uint8_t* frame, uint16_t length);
+
+            /**
+             * Choose the channel to send the next frame from
+             * @return  nullptr if no channel has data
+             */
+            MuxChannel* pickChannel();
+    };
+}
+
+#endif
@@ -0,0 +1,32 @@
+/**
+ * CRC-16 shared by the serial protocols, reflected polynomial 0xA001 with an initial value
+ * of 0xFFFF (the CRC used by Modbus RTU)
+ */
+#ifndef CRC16_HPP
+#define CRC16_HPP
+
+#include <stdint.h>
+
+namespace SerialComm
+{
+    const static uint16_t CRC16_INITIAL = 0xFFFF;
+
+    /**
+     * Add one byte to a running CRC
+     * @param   crc     CRC of the data so far, CRC16_INITIAL to start
+     * @param   data    Next byte
+     * @return  CRC including data
+     */
+    uint16_t crc16Update(uint16_t crc, uint8_t data);
+
+    /**
+     * Add a buffer to a running CRC
+     * @param   buff        Data to add
+     * @param   numBytes    Number of bytes in buff
+     * @param   crc         CRC of the data so far, CRC16_INITIAL to start
+     * @return  CRC including buff
+     */
+    uint16_t crc16(const uint8_t* buff, uint16_t numBytes, uint16_t crc = CRC16_INITIAL);
+}
+
+#endif
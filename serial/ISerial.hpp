@@ -10,28 +10,65 @@ namespace SerialComm
     {
         BAUD_9600 = 0,
         BAUD_115200,
+        BAUD_19200,
+        BAUD_38400,
+        BAUD_57600,
+        BAUD_250000,
+        BAUD_500000,
+        BAUD_1000000,
         NUM_BAUD_RATES
     };
 
+    const static uint16_t TX_SPACE_UNLIMITED = 0xFFFF;
+
+    /**
+     * Receive error counts, to tell data lost on the line apart from data lost to a slow consumer
+     */
+    struct RxStatistics
+    {
+        uint16_t overruns;          // Times bytes were lost because the hardware receive register was not read in time
+        uint16_t framingErrors;     // Bytes dropped because their stop bit was low
+        uint16_t parityErrors;      // Bytes dropped because their parity did not match
+        uint16_t droppedBytes;      // Bytes dropped because the driver's RX buffer was full
+    };
+
     class ISerial
     {
         public:
             virtual void initialize(){};
             virtual bool isDataAvailable() { return false; }
-            virtual void write(const uint8_t* buff, uint16_t numBytes) = 0;
+            /**
+             * Write data
+             * @param   buff        Buffer of data to transmit
+             * @param   numBytes    Number of bytes in buff
+             * @return  Number of bytes accepted, may be less than numBytes if the driver is out of space
+             */
+            virtual uint16_t write(const uint8_t* buff, uint16_t numBytes) = 0;
             virtual uint16_t read(uint8_t* buff, uint16_t numBytes) = 0;
+
+            /**
+             * @return  Number of bytes write() can take right now without dropping any,
+             *          TX_SPACE_UNLIMITED if write() waits until everything is sent
+             */
+            virtual uint16_t getTxSpace() { return TX_SPACE_UNLIMITED; }
             virtual void flush(){}
             virtual void flushRx(){}
             virtual void flushTx(){}
 
+            /**
+             * @return  Receive error counts since the last reset, all zero if the driver does not track them
+             */
+            virtual RxStatistics getRxStatistics() { return RxStatistics(); }
+            virtual void resetRxStatistics(){}
+
             void setTimeoutTimer(Timer::SoftwareTimer* pTimer)
             {
                 pTimeoutTimer_ = pTimer;
             }
 
-            virtual void write(const char* buff, uint16_t numBytes)
+            virtual uint16_t write(const char* buff, uint16_t numBytes)
             {
-                write((uint8_t*)buff, numBytes);
+                return write((uint8_t*)buff, numBytes);
             }
 
             virtual uint16_t read(char* buff, uint16_t numBytes)
@@ -0,0 +1,234 @@
+#include "PacketSerial.hpp"
+#include "Crc16.hpp"
+#include "drivers/assert/Assert.hpp"
+
+namespace SerialComm
+{
+    const static uint8_t COBS_MAX_CODE = 0xFF;              // Code for a full run, with no zero after it
+    const static uint8_t COBS_MAX_RUN = COBS_MAX_CODE - 1;  // Most non-zero bytes one code can cover
+
+    PacketSerial::PacketSerial(ISerial* pSerial, uint8_t* rxBuffer, uint16_t rxBufferLen):
+        pSerial_(pSerial),
+        rxBuffer_(rxBuffer),
+        rxBufferLen_(rxBufferLen),
+        rxLength_(0),
+        rxDiscarding_(false),
+        pTimeoutTimer_(nullptr),
+        txWaitAllowed_(false),
+        txCutShort_(false),
+        crcErrors_(0),
+        framingErrors_(0),
+        txFailures_(0)
+    {
+        assertCustom(pSerial_ != nullptr);
+        assertCustom(rxBufferLen_ > PACKET_CRC_LENGTH + 1, "Packet RX buffer too small");
+    }
+
+    uint16_t PacketSerial::getMaxEncodedLength(uint16_t numBytes)
+    {
+        // One code per full run, one for the rest, and the delimiter
+        uint16_t streamLength = numBytes + PACKET_CRC_LENGTH;
+        return streamLength + (streamLength / COBS_MAX_RUN) + 1 + 1;
+    }
+
+    bool PacketSerial::writeAll(const uint8_t* buff, uint16_t numBytes)
+    {
+        while (numBytes > 0)
+        {
+            // Only offer what the driver has room for, a driver refusing bytes counts them as dropped
+            uint16_t space = pSerial_->getTxSpace();
+            if (space == 0)
+            {
+                if (txWaitAllowed_ && !pTimeoutTimer_->hasOneShotPassed()) continue;
+
+                txCutShort_ = true;
+                return false;
+            }
+
+            uint16_t written = pSerial_->write(buff, (numBytes < space) ? numBytes : space);
+            buff += written;
+            numBytes -= written;
+        }
+        return true;
+    }
+
+    bool PacketSerial::writeStream(const uint8_t* payload,
+                                   uint16_t payloadLength,
+                                   const uint8_t* crc,
+                                   uint16_t start,
+                                   uint16_t numBytes)
+    {
+        if (start < payloadLength)
+        {
+            uint16_t fromPayload = payloadLength - start;
+            if (fromPayload > numBytes) fromPayload = numBytes;
+
+            if (!writeAll(&payload[start], fromPayload)) return false;
+            start += fromPayload;
+            numBytes -= fromPayload;
+        }
+
+        if (numBytes > 0)
+        {
+            return writeAll(&crc[start - payloadLength], numBytes);
+        }
+        return true;
+    }
+
+    bool PacketSerial::sendPacket(const uint8_t* buff, uint16_t numBytes, uint16_t timeoutMs)
+    {
+        const uint8_t delimiter = PACKET_DELIMITER;
+
+        txWaitAllowed_ = (pTimeoutTimer_ != nullptr) && (timeoutMs != 0);
+        if (txWaitAllowed_)
+        {
+            pTimeoutTimer_->setPeriodMs(timeoutMs);
+            pTimeoutTimer_->enable();
+        }
+        else if (pSerial_->getTxSpace() < getMaxEncodedLength(numBytes) + (txCutShort_ ? 1 : 0))
+        {
+            // Sending none of the packet is better than sending part of it
+            txFailures_++;
+            return false;
+        }
+
+        // End a packet that was cut short, the receiver drops it on its own
+        if (txCutShort_)
+        {
+            txCutShort_ = false;
+            if (!writeAll(&delimiter, 1))
+            {
+                txFailures_++;
+                return false;
+            }
+        }
+
+        uint16_t crcValue = crc16(buff, numBytes);
+        const uint8_t crc[PACKET_CRC_LENGTH] = { (uint8_t)(crcValue & 0xFF), (uint8_t)(crcValue >> 8) };
+
+        // Payload and CRC are encoded as one stream, without copying them together
+        uint16_t streamLength = numBytes + PACKET_CRC_LENGTH;
+        uint16_t index = 0;
+        while (true)
+        {
+            // Find the run of non-zero bytes this code covers
+            uint8_t run = 0;
+            while (((index + run) < streamLength) && (run < COBS_MAX_RUN))
+            {
+                uint16_t position = index + run;
+                uint8_t data = (position < numBytes) ? buff[position] : crc[position - numBytes];
+                if (data == 0) break;
+                run++;
+            }
+
+            uint8_t code = run + 1;
+            if (!writeAll(&code, 1) || !writeStream(buff, numBytes, crc, index, run))
+            {
+                txFailures_++;
+                return false;
+            }
+            index += run;
+
+            if (index >= streamLength) break;
+
+            // Runs shorter than the maximum stop at a zero, which the code stands in for. A zero as
+            // the last byte still needs a code after it, which the loop sends as an empty run
+            if (run < COBS_MAX_RUN) index++;
+        }
+
+        if (!writeAll(&delimiter, 1))
+        {
+            txFailures_++;
+            return false;
+        }
+        return true;
+    }
+
+    uint16_t PacketSerial::cobsDecode(uint8_t* buff, uint16_t numBytes)
+    {
+        // Output never catches up with input, so decoding in place is safe
+        uint16_t readIndex = 0;
+        uint16_t writeIndex = 0;
+        while (readIndex < numBytes)
+        {
+            uint8_t code = buff[readIndex];
+            if ((code == 0) || ((readIndex + code) > numBytes)) return 0;
+            readIndex++;
+
+            for (uint8_t i=1; i<code; i++)
+            {
+                buff[writeIndex++] = buff[readIndex++];
+            }
+
+            if ((code != COBS_MAX_CODE) && (readIndex < numBytes))
+            {
+                buff[writeIndex++] = 0;
+            }
+        }
+        return writeIndex;
+    }
+
+    uint16_t PacketSerial::decodePacket(uint16_t encodedLength)
+    {
+        uint16_t length = cobsDecode(rxBuffer_, encodedLength);
+        if (length < PACKET_CRC_LENGTH)
+        {
+            framingErrors_++;
+            return 0;
+        }
+
+        length -= PACKET_CRC_LENGTH;
+        uint16_t received = rxBuffer_[length] | ((uint16_t)rxBuffer_[length + 1] << 8);
+        if (crc16(rxBuffer_, length) != received)
+        {
+            crcErrors_++;
+            return 0;
+        }
+        return length;
+    }
+
+    uint16_t PacketSerial::receivePacket(const uint8_t** ppPacket)
+    {
+        uint8_t data;
+        while (pSerial_->read(&data, 1) != 0)
+        {
+            if (data != PACKET_DELIMITER)
+            {
+                if (rxDiscarding_) continue;
+
+                if (rxLength_ >= rxBufferLen_)
+                {
+                    // Too long to be one of ours, skip to the next delimiter
+                    framingErrors_++;
+                    rxDiscarding_ = true;
+                    continue;
+                }
+
+                rxBuffer_[rxLength_++] = data;
+                continue;
+            }
+
+            // End of a packet, back to back delimiters are empty packets and ignored
+            uint16_t encodedLength = rxLength_;
+            bool discarded = rxDiscarding_;
+            rxLength_ = 0;
+            rxDiscarding_ = false;
+            if (discarded || (encodedLength == 0)) continue;
+
+            uint16_t length = decodePacket(encodedLength);
+            if (length != 0)
+            {
+                *ppPacket = rxBuffer_;
+                return length;
+            }
+        }
+        return 0;
+    }
+
+    void PacketSerial::resetStatistics()
+    {
+        crcErrors_ = 0;
+        framingErrors_ = 0;
+        txFailures_ = 0;
+    }
+}
@@ -0,0 +1,140 @@
+/**
+ * Binary packets over any ISerial.
+ * 
+ * Each packet is the payload followed by its CRC-16 (low byte first), COBS encoded so that the
+ * only zero byte on the wire is the delimiter ending the packet. COBS adds at most one byte per
+ * 254, plus the delimiter, so a packet costs payload + 4 bytes in most cases.
+ * 
+ * Sending encodes straight from the caller's buffer into the serial driver, runs of non-zero bytes
+ * are handed to write() as they are. Received packets are decoded in place in the RX buffer, and
+ * handed back as a pointer into it.
+ * 
+ * A host side encoder/decoder is in serial/host/packet_serial.py
+ */
+#ifndef PACKET_SERIAL_HPP
+#define PACKET_SERIAL_HPP
+
+#include <stdint.h>
+#include "drivers/serial/ISerial.hpp"
+
+namespace SerialComm
+{
+    const static uint8_t PACKET_DELIMITER = 0x00;
+    const static uint8_t PACKET_CRC_LENGTH = 2;
+
+    class PacketSerial
+    {
+        public:
+            /**
+             * Constructor
+             * @param   pSerial     Serial driver that packets are sent and received over
+             * @param   rxBuffer    Buffer where an incoming encoded packet is collected, and then decoded
+             * @param   rxBufferLen Size of rxBuffer, must fit the largest payload + CRC + COBS overhead
+             */
+            PacketSerial(ISerial* pSerial, uint8_t* rxBuffer, uint16_t rxBufferLen);
+
+            /**
+             * Set the timer sendPacket() times out with, needed for it to wait for room at all
+             */
+            void setTimeoutTimer(Timer::SoftwareTimer* pTimer) { pTimeoutTimer_ = pTimer; }
+
+            /**
+             * Encode and send a packet.
+             * Without a timeout the packet is only sent if the driver has room for all of it, so this
+             * never waits. With one, the driver is given bytes as room frees up, until the timeout
+             * runs out. Room only frees up and the timeout only runs out with interrupts enabled.
+             * A packet cut short by the timeout is ended by a delimiter ahead of the next packet, so
+             * the receiver drops it without losing the next one too.
+             * @param   buff        Payload to send
+             * @param   numBytes    Number of bytes in buff
+             * @param   timeoutMs   Longest to wait for room, 0 or no timeout timer set does not wait
+             * @return  True if the whole packet was given to the driver
+             */
+            bool sendPacket(const uint8_t* buff, uint16_t numBytes, uint16_t timeoutMs = 0);
+
+            /**
+             * @return  Most bytes a packet with this payload takes on the wire, including the delimiter
+             */
+            static uint16_t getMaxEncodedLength(uint16_t numBytes);
+
+            /**
+             * @return  Bytes the driver can take right now, see ISerial::getTxSpace()
+             */
+            uint16_t getTxSpace() { return pSerial_->getTxSpace(); }
+
+            /**
+             * Collect received data, and decode a packet if a delimiter has been reached.
+             * Does not block, call this repeatedly.
+             * @param   ppPacket    Set to the decoded payload, which is valid until the next call
+             * @return  Payload length, 0 if no complete valid packet has been received. Empty packets are
+             *          valid but not reported
+             */
+            uint16_t receivePacket(const uint8_t** ppPacket);
+
+            /**
+             * @return  Number of packets dropped because their CRC did not match
+             */
+            uint16_t getCrcErrors() { return crcErrors_; }
+
+            /**
+             * @return  Number of packets dropped because their encoding was invalid, or too long for the RX buffer
+             */
+            uint16_t getFramingErrors() { return framingErrors_; }
+
+            /**
+             * @return  Number of packets sendPacket() could not send whole
+             */
+            uint16_t getTxFailures() { return txFailures_; }
+
+            /**
+             * Clear the error counts
+             */
+            void resetStatistics();
+
+            /**
+             * Decode a COBS packet in place
+             * @param   buff        Encoded packet, without the delimiter. Overwritten with the decoded data
+             * @param   numBytes    Number of bytes in buff
+             * @return  Number of decoded bytes at the start of buff, 0 if the encoding is invalid
+             */
+            static uint16_t cobsDecode(uint8_t* buff, uint16_t numBytes);
+
+        private:
+            ISerial* pSerial_;      // Driver packets are sent and received over
+
+            uint8_t* rxBuffer_;     // Encoded packet being collected
+            uint16_t rxBufferLen_;  // Size of rxBuffer_
+            uint16_t rxLength_;     // Bytes of the current packet collected so far
+            bool rxDiscarding_;     // When true, the current packet overflowed and is skipped up to its delimiter
+
+            Timer::SoftwareTimer* pTimeoutTimer_;  // Timeout for sendPacket() waiting on the driver, may be nullptr
+            bool txWaitAllowed_;    // When true, the packet being sent may wait for room until the timeout
+            bool txCutShort_;       // When true, the last packet sent was cut short and has not been ended
+
+            uint16_t crcErrors_;        // Packets with a CRC mismatch
+            uint16_t framingErrors_;    // Packets with invalid COBS, or that overflowed rxBuffer_
+            uint16_t txFailures_;       // Packets not sent whole
+
+            /**
+             * Write to the driver until all of buff has been accepted, or the driver has no room and
+             * waiting is not allowed or has timed out
+             * @return  True if all of buff was accepted
+             */
+            bool writeAll(const uint8_t* buff, uint16_t numBytes);
+
+            /**
+             * Write part of the payload + CRC stream, taking each byte from wherever it lives
+             * @return  True if all of it was accepted
+             */
+            bool writeStream(const uint8_t* payload, uint16_t payloadLength, const uint8_t* crc, uint16_t start, uint16_t numBytes);
+
+            /**
+             * Decode a collected packet, then check and strip its CRC
+             * @param   encodedLength   Number of bytes collected in rxBuffer_
+             * @return  Payload length, 0 if the packet is invalid
+             */
+            uint16_t decodePacket(uint16_t encodedLength);
+    };
+}
+
+#endif
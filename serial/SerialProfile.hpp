@@ -0,0 +1,42 @@
+/**
+ * Profiling hooks for the serial drivers.
+ * 
+ * Every serial ISR, and every place the main loop waits on a serial driver, is wrapped in
+ * SERIAL_PROFILE_BEGIN(event) / SERIAL_PROFILE_END(event). They compile to nothing unless
+ * SERIAL_PROFILE_HOOKS names a header that defines them, e.g.
+ *     -DSERIAL_PROFILE_HOOKS='"board/SerialProfileHooks.hpp"'
+ * A hook header might set and clear a spare pin per event for a logic analyser, or add up TCNT1
+ * deltas per event, to get ISR time per byte and main loop stall time on real traffic. Combined
+ * with the TX/RX high water marks this is enough to size buffers and pick baud rates.
+ */
+#ifndef SERIAL_PROFILE_HPP
+#define SERIAL_PROFILE_HPP
+
+namespace SerialComm
+{
+    enum SerialProfileEvent
+    {
+        SERIAL_PROFILE_RX_ISR = 0,      // Hardware USART receive complete ISR
+        SERIAL_PROFILE_TX_ISR,          // Hardware USART data register empty ISR
+        SERIAL_PROFILE_SOFT_RX_ISR,     // Software serial pin change ISR
+        SERIAL_PROFILE_SOFT_RX_SAMPLE,  // Software serial timed RX sample ISR
+        SERIAL_PROFILE_SOFT_TX_TICK,    // Software serial timed TX ISR
+        SERIAL_PROFILE_TX_STALL,        // Main loop waiting for room to transmit
+        SERIAL_PROFILE_RX_STALL,        // Main loop waiting for received data
+        NUM_SERIAL_PROFILE_EVENTS
+    };
+}
+
+#ifdef SERIAL_PROFILE_HOOKS
+#include SERIAL_PROFILE_HOOKS
+#endif
+
+#ifndef SERIAL_PROFILE_BEGIN
+#define SERIAL_PROFILE_BEGIN(event)
+#endif
+
+#ifndef SERIAL_PROFILE_END
+#define SERIAL_PROFILE_END(event)
+#endif
+
+#endif
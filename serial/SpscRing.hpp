@@ -0,0 +1,199 @@
+/**
+ * Single producer, single consumer ring buffer
+ *
+ * Safe to share between the main loop and one interrupt handler, as long as only one side pushes
+ * and only the other side pops. The producer is the only writer of head_ and the consumer is the
+ * only writer of tail_. Both indices are free running and are masked on access, so the buffer
+ * length must be a power of two.
+ *
+ * The indices are single bytes, so every load and store of one is atomic on 8 bit cores and
+ * neither side ever has to mask interrupts. Free running 8 bit indices can only tell a full ring
+ * from an empty one up to 128 elements, which is the largest length a ring can have.
+ */
+#ifndef SPSC_RING_HPP
+#define SPSC_RING_HPP
+
+#include <stdint.h>
+
+// Stops the compiler from moving buffer accesses across an index update
+#define SPSC_BARRIER() __asm__ __volatile__ ("" ::: "memory")
+
+namespace SerialComm
+{
+    template <typename T>
+    class SpscRing
+    {
+        public:
+            // Longest ring the 8 bit free running indices can address
+            static const uint16_t MAX_LENGTH = 128;
+
+            /**
+             * Constructor
+             * @param   buffer  Storage for the ring
+             * @param   length  Number of elements in buffer, must be a power of two up to MAX_LENGTH
+             */
+            SpscRing(T* buffer, uint16_t length):
+                buffer_(buffer),
+                mask_(length - 1),
+                head_(0),
+                tail_(0)
+            {}
+
+            /**
+             * Check if a length can be used as the size of a ring
+             * @param   length  Number of elements
+             * @return  True if length is a non-zero power of two no longer than MAX_LENGTH
+             */
+            static bool isValidLength(uint16_t length)
+            {
+                return (length != 0) && (length <= MAX_LENGTH) && ((length & (length - 1)) == 0);
+            }
+
+            /**
+             * @return  Maximum number of elements the ring can hold
+             */
+            uint16_t capacity()
+            {
+                return (uint16_t)mask_ + 1;
+            }
+
+            /**
+             * @return  Number of elements currently in the ring
+             */
+            uint16_t length()
+            {
+                return (uint8_t)(head_ - tail_);
+            }
+
+            bool isEmpty()
+            {
+                return head_ == tail_;
+            }
+
+            bool isFull()
+            {
+                return length() > mask_;
+            }
+
+            /**
+             * Producer only
+             * @return  Free running count of every element ever pushed, modulo 256
+             */
+            uint8_t producerIndex()
+            {
+                return head_;
+            }
+
+            /**
+             * Consumer only
+             * @return  Free running count of every element ever popped, modulo 256
+             */
+            uint8_t consumerIndex()
+            {
+                return tail_;
+            }
+
+            /**
+             * Producer only. Add a single element to the ring
+             * @param   value   Element to add
+             * @return  False if the ring was full and the element was not added
+             */
+            bool push(const T& value)
+            {
+                uint8_t head = head_;
+                if ((uint8_t)(head - tail_) > mask_) return false;
+
+                buffer_[head & mask_] = value;
+                SPSC_BARRIER();
+                head_ = head + 1;
+                return true;
+            }
+
+            /**
+             * Producer only. Add as many elements as will fit, published to the consumer all at once
+             * @param   data    Elements to add
+             * @param   num     Number of elements in data
+             * @return  Number of elements added
+             */
+            uint16_t write(const T* data, uint16_t num)
+            {
+                uint8_t head = head_;
+                uint16_t space = capacity() - (uint8_t)(head - tail_);
+                if (num > space) num = space;
+
+                for (uint8_t i=0; i<num; i++)
+                {
+                    buffer_[(uint8_t)(head + i) & mask_] = data[i];
+                }
+
+                SPSC_BARRIER();
+                head_ = head + (uint8_t)num;
+                return num;
+            }
+
+            /**
+             * Consumer only. Remove a single element from the ring
+             * @param   value   Set to the removed element
+             * @return  False if the ring was empty
+             */
+            bool pop(T& value)
+            {
+                uint8_t tail = tail_;
+                if (head_ == tail) return false;
+
+                value = buffer_[tail & mask_];
+                SPSC_BARRIER();
+                tail_ = tail + 1;
+                return true;
+            }
+
+            /**
+             * Consumer only. Remove up to num elements from the ring
+             * @param   data    Buffer to copy removed elements to
+             * @param   num     Size of data
+             * @return  Number of elements removed
+             */
+            uint16_t read(T* data, uint16_t num)
+            {
+                uint8_t tail = tail_;
+                uint8_t available = head_ - tail;
+                if (num > available) num = available;
+
+                for (uint8_t i=0; i<num; i++)
+                {
+                    data[i] = buffer_[(uint8_t)(tail + i) & mask_];
+                }
+
+                SPSC_BARRIER();
+                tail_ = tail + (uint8_t)num;
+                return num;
+            }
+
+            /**
+             * Consumer only. Get the oldest element without removing it
+             * @return  Pointer to the oldest element, or nullptr if the ring is empty
+             */
+            T* peek()
+            {
+                uint8_t tail = tail_;
+                if (head_ == tail) return nullptr;
+                return &buffer_[tail & mask_];
+            }
+
+            /**
+             * Consumer only. Discard everything currently in the ring
+             */
+            void flush()
+            {
+                tail_ = head_;
+            }
+
+        private:
+            T* buffer_;
+            uint8_t mask_;              // Capacity - 1, used to wrap the free running indices
+            volatile uint8_t head_;     // Total elements pushed, only written by the producer
+            volatile uint8_t tail_;     // Total elements popped, only written by the consumer
+    };
+}
+
+#endif
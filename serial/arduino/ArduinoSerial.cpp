@@ -20,9 +20,9 @@ namespace SerialComm
         return Serial.available();
     }
 
-    void ArduinoSerial::write(const uint8_t* buff, uint16_t numBytes)
+    uint16_t ArduinoSerial::write(const uint8_t* buff, uint16_t numBytes)
     {
-        Serial.write(buff, numBytes);
+        return Serial.write(buff, numBytes);
     }
 
     uint16_t ArduinoSerial::read(uint8_t* buff, uint16_t numBytes)
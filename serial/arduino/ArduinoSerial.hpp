@@ -14,7 +14,7 @@ namespace SerialComm
 
             void initialize() override;
             bool isDataAvailable() override;
-            void write(const uint8_t* buff, uint16_t numBytes)  override;
+            uint16_t write(const uint8_t* buff, uint16_t numBytes)  override;
             uint16_t read(uint8_t* buff, uint16_t numBytes)  override;
             void flush() override;
 
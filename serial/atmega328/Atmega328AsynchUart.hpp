@@ -1,23 +1,53 @@
+/**
+ * Interrupt driven driver for USART0 with caller supplied buffers
+ *
+ * The USART0 vectors are bound straight to a global instance with ASYNCH_UART_ISRS, the same as
+ * ASYNCH_USART_ISRS does for Atmega328AsynchUsart, so the handlers inline into the ISRs and there
+ * is no instance pointer to load. A second instance bound to USART0 fails to link.
+ *
+ * Example:
+ *     uint8_t txBuffer[64];
+ *     uint8_t rxBuffer[32];
+ *     Atmega328AsynchUart uart(txBuffer, rxBuffer, 64, 32, BAUD_115200, F_CPU);
+ *     ASYNCH_UART_ISRS(uart)
+ */
 #ifndef ATMEGA328_ASYNCH_UART_HPP
 #define ATMEGA328_ASYNCH_UART_HPP
 
-#include "drivers/serial/atmega328/Atmega328Uart.hpp"
-#include "utilities/circular_queue/CircularQueue.hpp"
-#include "drivers/interrupt/IInterrupt.hpp"
+#include "drivers/serial/atmega328/Atmega328AsynchUsart.hpp"
+
+// Parts with more than one USART number the vectors
+#ifdef USART0_RX_vect
+    #define ASYNCH_UART_RX_VECT USART0_RX_vect
+    #define ASYNCH_UART_UDRE_VECT USART0_UDRE_vect
+    #define ASYNCH_UART_TX_VECT USART0_TX_vect
+#else
+    #define ASYNCH_UART_RX_VECT USART_RX_vect
+    #define ASYNCH_UART_UDRE_VECT USART_UDRE_vect
+    #define ASYNCH_UART_TX_VECT USART_TX_vect
+#endif
+
+/**
+ * Define the USART0 interrupt handlers, TX complete included, for a driver instance
+ * @param   uart    Global Atmega328AsynchUart object
+ */
+#define ASYNCH_UART_ISRS(uart)                                              \
+    ASYNCH_USART_ISRS(uart, ASYNCH_UART_RX_VECT, ASYNCH_UART_UDRE_VECT)     \
+    ASYNCH_USART_TXC_ISR(uart, ASYNCH_UART_TX_VECT)
 
 namespace SerialComm
 {
-    class Atmega328AsynchUart : public Atmega328Uart
+    class Atmega328AsynchUart : public Atmega328AsynchUsart<Usart0>
     {
         public:
             /**
              * Constructor
              * @param   txBuffer            Pointer to buffer to store outgoing data in
              * @param   rxBuffer            Pointer to buffer to store incoming data in
-             * @param   txLength            Length of txBuffer
-             * @param   rxLength            Length of rxBuffer
+             * @param   txLength            Length of txBuffer, must be a power of two up to 128
+             * @param   rxLength            Length of rxBuffer, must be a power of two up to 128
              * @param   baudRate            UART transmission rate to use
-             * @param   pInterruptControl   Pointer to global interrupt controller
+             * @param   fCpu                Frequency of the processor's clock
              * @param   enableParity        Enable parity
              * @param   polarity            Set polarity
              */
@@ -27,68 +57,21 @@ namespace SerialComm
                                 uint16_t rxLength, 
                                 BaudRate baudRate,
                                 uint32_t fCpu,
-                                Interrupt::IInterrupt* pInterruptControl,
                                 bool enableParity = false, 
                                 bool polarity = false);
-            ~Atmega328AsynchUart();
-
-            /**
-             * Set up uart, must be done after static initializtion
-             */
-            void initialize() override;
-
-            /**
-             * Returns true if there is incoming data to read
-             */
-            bool isDataAvailable() override;
-
-            /**
-             * Non blocking write, puts data in a buffer to be written out
-             * 
-             * @param   buff        Buffer containing new data to write
-             * @param   numBytes    Number of bytes in buff
-             */
-            virtual void write(const uint8_t* buff, uint16_t numBytes) override;
-
-            /**
-             * Non-blocking read, retrieves any data read and buffered from the uart
-             * 
-             * @param   buff        Buffer to put read bytes in
-             * @param   numBytes    Size of buff, maximum number of bytes to read
-             * @return  Returns the number of bytes read, up to numBytes
-             */
-            virtual uint16_t read(uint8_t* buff, uint16_t numBytes) override;
-
-            /**
-             * Empty all contents of the write buffer to the uart
-             */
-            void flush() override;
-
-            void flushRx() override;
-
-            /**
-             * Callback for the Data Register Empty interrupt
-             */
-            static void HanleDataRegisterEmpty();
 
             /**
-             * Callback for the Data read complete interrupt
+             * Constructor for any baud rate, e.g. UsartBaud<F_CPU, 250000>::settings()
              */
-            static void HanleRxDataAvailable();
-
-        private:
-
-            // Static copies for use in interrupt handling
-            static CircularQueue<uint8_t>* pTxBuffer_;
-            static CircularQueue<uint8_t>* pRxBuffer_;
-            static Interrupt::IInterrupt* pInterruptControl_;
-
-            CircularQueue<uint8_t> txBuffer_;   // Stores outgoing bytes
-            CircularQueue<uint8_t> rxBuffer_;   // Stores incoming bytes
-            uint16_t txLength_; // Length of txBuffer_
-            uint16_t rxLength_; // Length of rxBuffer_
-            bool txBufferFull_; // True when the TX buffer has overfilled and must be emptied
+            Atmega328AsynchUart(uint8_t* txBuffer, 
+                                uint8_t* rxBuffer, 
+                                uint16_t txLength,
+                                uint16_t rxLength, 
+                                BaudSettings baudSettings,
+                                bool enableParity = false, 
+                                bool polarity = false);
+            ~Atmega328AsynchUart();
     };
 }
 
-#endif
\ No newline at end of file
+#endif
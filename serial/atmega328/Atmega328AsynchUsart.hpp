@@ -0,0 +1,1276 @@
+/**
+ * Interrupt driven USART driver, templated over the USART's register set
+ *
+ * Each instance owns its buffers and there are no static pointers, so any number of USARTs can run
+ * at once. The ISRs are tied to an instance with ASYNCH_USART_ISRS, which calls straight into the
+ * instance so the handlers inline with direct register accesses. A second instance on the same
+ * USART fails to link instead of silently taking over its interrupts.
+ *
+ * Example, on an ATmega328PB:
+ *     Atmega328StaticAsynchUsart<Usart1, 64, 32> uart1(BAUD_115200, F_CPU);
+ *     ASYNCH_USART_ISRS(uart1, USART1_RX_vect, USART1_UDRE_vect)
+ */
+#ifndef ATMEGA328_ASYNCH_USART_HPP
+#define ATMEGA328_ASYNCH_USART_HPP
+
+#include "drivers/serial/ISerial.hpp"
+#include "drivers/serial/SpscRing.hpp"
+#include "drivers/serial/SerialProfile.hpp"
+#include "drivers/serial/atmega328/UsartBaud.hpp"
+#include "drivers/serial/atmega328/UsartRegisters.hpp"
+#include "drivers/serial/atmega328/UsartAutobaud.hpp"
+#include "drivers/dio/IDio.hpp"
+#include "drivers/assert/Assert.hpp"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/pgmspace.h>
+
+/**
+ * Define the interrupt handlers for a USART driver instance
+ * @param   uart        Global Atmega328AsynchUsart object
+ * @param   rxVector    RX complete vector of the instance's USART, e.g. USART_RX_vect
+ * @param   udreVector  Data register empty vector of the instance's USART, e.g. USART_UDRE_vect
+ */
+#define ASYNCH_USART_ISRS(uart, rxVector, udreVector)   \
+    ISR(rxVector)                                       \
+    {                                                   \
+        SERIAL_PROFILE_BEGIN(SerialComm::SERIAL_PROFILE_RX_ISR); \
+        uart.handleRxDataAvailable();                   \
+        SERIAL_PROFILE_END(SerialComm::SERIAL_PROFILE_RX_ISR);   \
+    }                                                   \
+    ISR(udreVector)                                     \
+    {                                                   \
+        SERIAL_PROFILE_BEGIN(SerialComm::SERIAL_PROFILE_TX_ISR); \
+        uart.handleDataRegisterEmpty();                 \
+        SERIAL_PROFILE_END(SerialComm::SERIAL_PROFILE_TX_ISR);   \
+    }
+
+/**
+ * Define the TX complete interrupt handler for a USART driver instance, needed for setDriverEnablePin
+ * and setTxCompleteCallback
+ * @param   uart        Global Atmega328AsynchUsart object
+ * @param   txcVector   TX complete vector of the instance's USART, e.g. USART_TX_vect
+ */
+#define ASYNCH_USART_TXC_ISR(uart, txcVector)           \
+    ISR(txcVector)                                      \
+    {                                                   \
+        uart.handleTxComplete();                        \
+    }
+
+namespace SerialComm
+{
+    const static uint8_t MPCM_BROADCAST_ADDRESS = 0xFF; // Default address every node accepts in multi-processor mode
+
+    const static uint8_t FLOW_XON = 0x11;   // Software flow control, resume sending
+    const static uint8_t FLOW_XOFF = 0x13;  // Software flow control, stop sending
+
+    enum FlowControl: uint8_t
+    {
+        FLOW_NONE = 0,
+        FLOW_HARDWARE,      // RTS/CTS pins
+        FLOW_XON_XOFF       // XON/XOFF characters in the data, so only for text
+    };
+
+    /**
+     * A caller owned buffer to transmit without copying it into the TX buffer
+     */
+    struct TxDescriptor
+    {
+        const uint8_t* pData;   // Data to send, must not change until onComplete is called
+        uint16_t length;        // Number of bytes in pData
+        bool inProgmem;         // True if pData is a PROGMEM address
+        // Called once pData can be reused, may be nullptr. Usually from the TX ISR, but from the
+        // caller for an empty buffer or when flushTx() drops the buffer, so it must be safe in both
+        void (*onComplete)(const uint8_t* pData);
+    };
+
+    template <typename Usart>
+    class Atmega328AsynchUsart : public ISerial
+    {
+        public:
+            /**
+             * Constructor
+             * @param   txBuffer            Pointer to buffer to store outgoing data in
+             * @param   rxBuffer            Pointer to buffer to store incoming data in
+             * @param   txLength            Length of txBuffer, must be a power of two up to 128
+             * @param   rxLength            Length of rxBuffer, must be a power of two up to 128
+             * @param   baudRate            UART transmission rate to use
+             * @param   fCpu                Frequency of the processor's clock
+             * @param   enableParity        Enable parity
+             * @param   polarity            Set polarity
+             */
+            Atmega328AsynchUsart(uint8_t* txBuffer,
+                                 uint8_t* rxBuffer,
+                                 uint16_t txLength,
+                                 uint16_t rxLength,
+                                 BaudRate baudRate,
+                                 uint32_t fCpu,
+                                 bool enableParity = false,
+                                 bool polarity = false);
+
+            /**
+             * Constructor for any baud rate, e.g. UsartBaud<F_CPU, 250000>::settings()
+             * @param   txBuffer            Pointer to buffer to store outgoing data in
+             * @param   rxBuffer            Pointer to buffer to store incoming data in
+             * @param   txLength            Length of txBuffer, must be a power of two up to 128
+             * @param   rxLength            Length of rxBuffer, must be a power of two up to 128
+             * @param   baudSettings        Baud rate register settings
+             * @param   enableParity        Enable parity
+             * @param   polarity            Set polarity
+             */
+            Atmega328AsynchUsart(uint8_t* txBuffer,
+                                 uint8_t* rxBuffer,
+                                 uint16_t txLength,
+                                 uint16_t rxLength,
+                                 BaudSettings baudSettings,
+                                 bool enableParity = false,
+                                 bool polarity = false);
+
+            /**
+             * Set up uart, must be done after static initializtion
+             */
+            void initialize() override;
+
+            /**
+             * Change the transmission rate
+             * @param   baudRate    UART transmission rate to use
+             * @param   fCpu        Frequency of the processor's clock
+             */
+            void setBaudRate(BaudRate baudRate, uint32_t fCpu);
+
+            /**
+             * Change the transmission rate
+             * @param   baudSettings    Baud rate register settings
+             */
+            void setBaudRate(BaudSettings baudSettings);
+
+            /**
+             * Detect the baud rate from a sync character sent by the other end, then go back to
+             * interrupt driven receiving at that rate. The other end should repeat the sync
+             * character until it gets an answer, the first frames are used for timing and are not
+             * received. Waits for queued bytes to be sent first. Call after initialize().
+             * See UsartAutobaud for what this borrows while it runs
+             * @param   fCpu        Frequency of the processor's clock
+             * @param   timeoutMs   Give up after this long and keep the current rate, 0 waits
+             *                      forever. Needs a timeout timer whose tic source is not on Timer1
+             * @param   syncChar    Character to time, 'U' has an edge at every bit
+             * @return  True if a standard baud rate was found
+             */
+            bool autobaud(uint32_t fCpu, uint16_t timeoutMs = 0, uint8_t syncChar = AUTOBAUD_SYNC_CHAR);
+
+            /**
+             * Switch to 9-bit frames with multi-processor communication mode, for a node on a shared
+             * bus. The USART drops data frames in hardware until an address frame for this node
+             * arrives, so traffic for other nodes costs no interrupts. Address frames are not put in
+             * the RX buffer. Call after initialize()
+             * @param   address             This node's address
+             * @param   broadcastAddress    Address that every node accepts
+             */
+            void enableMultiProcessor(uint8_t address, uint8_t broadcastAddress = MPCM_BROADCAST_ADDRESS);
+
+            /**
+             * Send an address frame in multi-processor mode, selecting the node the data after it is for.
+             * The 9th bit cannot be queued with the data, so this waits until everything buffered
+             * before it has been sent
+             * @param   address     Node address
+             */
+            void writeAddress(uint8_t address);
+
+            /**
+             * Drive an RS-485 transceiver's driver enable pin. It is raised when data is queued, and
+             * lowered from the TX complete interrupt once the last stop bit is out and nothing else
+             * is queued. The TX complete interrupt must be defined with ASYNCH_USART_TXC_ISR
+             * @param   pDePin      Driver enable pin, already in output mode
+             */
+            void setDriverEnablePin(Dio::IDio* pDePin);
+
+            /**
+             * Use RTS/CTS flow control, both active low. The RX ISR raises RTS once the RX buffer
+             * holds stopThreshold bytes, and reading lowers it again at resumeThreshold. The TX ISR
+             * stops sending while CTS is high, call handleCtsChange from the CTS pin change interrupt
+             * to restart it
+             * @param   pRtsPin             RTS output, already in output mode
+             * @param   pCtsPin             CTS input, may be nullptr to only flow control RX
+             * @param   stopThreshold       RX buffer length to ask the sender to stop at, leave room for
+             *                              the bytes it sends before it reacts
+             * @param   resumeThreshold     RX buffer length to let the sender continue at
+             */
+            void enableHardwareFlowControl(Dio::IDio* pRtsPin,
+                                           Dio::IDio* pCtsPin,
+                                           uint16_t stopThreshold,
+                                           uint16_t resumeThreshold);
+
+            /**
+             * Use XON/XOFF flow control. XOFF is sent ahead of any queued data once the RX buffer
+             * holds stopThreshold bytes, and XON once reading brings it down to resumeThreshold.
+             * Received XON/XOFF pause and resume sending and are not put in the RX buffer
+             * @param   stopThreshold       RX buffer length to send XOFF at
+             * @param   resumeThreshold     RX buffer length to send XON at
+             */
+            void enableSoftwareFlowControl(uint16_t stopThreshold, uint16_t resumeThreshold);
+
+            /**
+             * CTS pin change handler, restarts sending once CTS is low again
+             */
+            void handleCtsChange();
+
+            /**
+             * Wait until everything queued has been sent, including the last stop bit, e.g. before
+             * sleeping or turning a half-duplex line around
+             * @param   timeoutMs   Longest time to wait, 0 waits forever. Needs a timeout timer
+             * @return  True if the line is idle, false if the timeout passed first
+             */
+            bool drain(uint16_t timeoutMs = 0);
+
+            /**
+             * @return  True if nothing is queued or being shifted out
+             */
+            bool isTxIdle();
+
+            /**
+             * Set a function to call from the TX complete interrupt each time the line goes idle,
+             * after the last stop bit of everything queued. The TX complete interrupt must be defined
+             * with ASYNCH_USART_TXC_ISR
+             * @param   onTxComplete    Callback, or nullptr for none
+             */
+            void setTxCompleteCallback(void (*onTxComplete)(void));
+
+            /**
+             * Returns true if there is incoming data to read
+             */
+            bool isDataAvailable() override;
+
+            /**
+             * @return  Free space in the TX buffer
+             */
+            uint16_t getTxSpace() override { return txBuffer_.capacity() - txBuffer_.length(); }
+
+            /**
+             * Non blocking write, puts data in a buffer to be written out
+             * Only as much as fits in the buffer is taken, the rest is counted as dropped
+             *
+             * @param   buff        Buffer containing new data to write
+             * @param   numBytes    Number of bytes in buff
+             * @return  Number of bytes from the start of buff that were buffered
+             */
+            uint16_t write(const uint8_t* buff, uint16_t numBytes) override;
+
+            /**
+             * Blocking write, waits for space in the buffer until all data is buffered or the timeout
+             * timer expires. Interrupts must be enabled for space to free up.
+             *
+             * @param   buff        Buffer containing new data to write
+             * @param   numBytes    Number of bytes in buff
+             * @param   timeoutMs   Give up after this long, 0 or no timeout timer set waits forever
+             * @return  Number of bytes from the start of buff that were buffered
+             */
+            uint16_t writeBlocking(const uint8_t* buff, uint16_t numBytes, uint16_t timeoutMs);
+
+            /**
+             * Non blocking zero-copy write, queues a reference to buff to be written out after
+             * everything written before it. The TX ISR reads straight from buff, so it must stay
+             * valid and unchanged until onComplete is called.
+             *
+             * @param   buff        Buffer containing data to write, RAM or PROGMEM
+             * @param   numBytes    Number of bytes in buff
+             * @param   onComplete  Called when buff can be reused, may be nullptr. Runs in the TX ISR
+             *                      when buff has been sent, or straight away in the caller when
+             *                      numBytes is 0 or flushTx() drops buff before it was sent
+             * @param   inProgmem   True if buff is a PROGMEM address
+             * @return  False if the reference queue is full and nothing was queued
+             */
+            bool writeRef(const uint8_t* buff,
+                          uint16_t numBytes,
+                          void (*onComplete)(const uint8_t* pData) = nullptr,
+                          bool inProgmem = false);
+
+            /**
+             * Non blocking zero-copy write of several buffers, sent in order
+             *
+             * @param   descriptors     Buffers to queue, see writeRef
+             * @param   numDescriptors  Number of entries in descriptors
+             * @return  Number of descriptors queued, stops at the first one that does not fit
+             */
+            uint8_t writev(const TxDescriptor* descriptors, uint8_t numDescriptors);
+
+            /**
+             * Non-blocking read, retrieves any data read and buffered from the uart
+             *
+             * @param   buff        Buffer to put read bytes in
+             * @param   numBytes    Size of buff, maximum number of bytes to read
+             * @return  Returns the number of bytes read, up to numBytes
+             */
+            uint16_t read(uint8_t* buff, uint16_t numBytes) override;
+
+            /**
+             * Non-blocking line read. The RX ISR records where each delimiter lands in the RX buffer,
+             * so a complete line is copied out in one go without searching for it.
+             * If the RX buffer fills up without a delimiter, its contents are returned as a partial line.
+             *
+             * @param   buff        Buffer to put the line in, the delimiter is replaced with '\0'
+             * @param   maxBytes    Size of buff, longer lines are returned over multiple calls
+             * @return  Number of bytes copied to buff, 0 if there is no complete line yet
+             */
+            uint16_t pollLine(uint8_t* buff, uint16_t maxBytes);
+
+            /**
+             * Read data until a newline character is reached, waits on pollLine
+             * @param   buff        Buffer for received data to be copied to
+             * @param   maxBytes    Maximum number of received data to copy to buff
+             * @param   timeoutMs   Give up after this long, 0 or no timeout timer set waits forever
+             * @return  Number of bytes copied to buff
+             */
+            uint16_t readLine(uint8_t* buff, uint16_t maxBytes, uint16_t timeoutMs) override;
+
+            /**
+             * Set the character that ends a line, defaults to '\n'
+             */
+            void setLineDelimiter(uint8_t delimiter) { lineDelimiter_ = delimiter; }
+
+            /**
+             * Set a function to call from the RX ISR each time a line is completed
+             * @param   onLineReceived  Callback, or nullptr for none
+             */
+            void setLineCallback(void (*onLineReceived)(void)) { onLineReceived_ = onLineReceived; }
+
+            /**
+             * Set a function to call from the RX ISR each time a byte is put in the RX buffer, e.g. to
+             * restart an inter-frame gap timer
+             * @param   onByteReceived  Callback, or nullptr for none
+             */
+            void setByteCallback(void (*onByteReceived)(void)) { onByteReceived_ = onByteReceived; }
+
+            /**
+             * Discard all buffered outgoing and incoming data
+             */
+            void flush() override;
+
+            void flushRx() override;
+
+            /**
+             * Discard buffered outgoing data. Queued zero-copy buffers are dropped and their
+             * onComplete callbacks run here, in the caller's context
+             */
+            void flushTx() override;
+
+            /**
+             * @return  Number of bytes given to write() or writeBlocking() that were not buffered
+             */
+            uint16_t getTxDroppedBytes() { return txDroppedBytes_; }
+
+            /**
+             * @return  Most bytes that have been waiting in the TX buffer at once
+             */
+            uint16_t getTxHighWaterMark() { return txHighWaterMark_; }
+
+            /**
+             * Clear the dropped byte count and high water mark
+             */
+            void resetTxStatistics();
+
+            /**
+             * @return  Most bytes that have been waiting in the RX buffer at once
+             */
+            uint16_t getRxHighWaterMark();
+
+            /**
+             * @return  Receive error counts. Bytes with framing or parity errors are dropped, and new
+             *          bytes are dropped while the RX buffer is full, old ones are never overwritten
+             */
+            RxStatistics getRxStatistics() override;
+
+            /**
+             * Clear the receive error counts and the RX high water mark
+             */
+            void resetRxStatistics() override;
+
+            /**
+             * TX complete interrupt handler, releases the RS-485 driver enable pin and calls the TX
+             * complete callback once the line is idle
+             */
+            void handleTxComplete();
+
+            /**
+             * Data register empty interrupt handler, loads the next byte from either the oldest
+             * zero-copy buffer or the TX buffer, whichever comes first
+             */
+            void handleDataRegisterEmpty();
+
+            /**
+             * RX complete interrupt handler, stores a received byte and marks it if it ends a line
+             */
+            void handleRxDataAvailable();
+
+        protected:
+            BaudSettings baudSettings_;
+            bool enableParity_;
+            bool polarity_;
+
+        private:
+            // Queued zero-copy buffer, sent once the TX buffer has been sent up to ringPosition
+            struct TxRef
+            {
+                TxDescriptor descriptor;
+                uint8_t ringPosition;   // txBuffer_ producer index at the time the buffer was queued
+            };
+
+            const static uint8_t TX_REF_QUEUE_LENGTH = 4;   // Must be a power of two
+            const static uint8_t LINE_END_QUEUE_LENGTH = 4; // Must be a power of two
+
+            // Neither ring needs interrupts disabled to access, the main loop is the only producer
+            // of txBuffer_ and the only consumer of rxBuffer_, the ISRs are the other side of each
+            SpscRing<uint8_t> txBuffer_;    // Stores outgoing bytes
+            SpscRing<uint8_t> rxBuffer_;    // Stores incoming bytes
+
+            uint8_t lineEndStorage_[LINE_END_QUEUE_LENGTH];
+            SpscRing<uint8_t> lineEnds_;    // rxBuffer_ producer index just after each received delimiter
+            uint8_t lineDelimiter_;
+            void (*onLineReceived_)(void);
+            void (*onByteReceived_)(void);
+
+            uint16_t txDroppedBytes_;   // Bytes that did not fit in txBuffer_
+            uint16_t txHighWaterMark_;  // Largest length txBuffer_ has reached
+            uint16_t rxHighWaterMark_;      // Largest length rxBuffer_ has reached, updated by the RX ISR
+            RxStatistics rxStatistics_;     // Receive errors, updated by the RX ISR
+
+            TxRef txRefStorage_[TX_REF_QUEUE_LENGTH];
+            SpscRing<TxRef> txRefs_;    // Zero-copy buffers waiting to be sent, popped by the TX ISR
+            uint16_t txRefOffset_;      // Bytes of the oldest TxRef already sent, only used by the TX ISR
+
+            bool multiProcessor_;       // True when using 9-bit frames with address filtering
+            uint8_t address_;           // This node's address in multi-processor mode
+            uint8_t broadcastAddress_;  // Address all nodes accept in multi-processor mode
+            Dio::IDio* pDePin_;         // RS-485 driver enable pin, nullptr if not used
+            void (*onTxComplete_)(void);
+            volatile bool txActive_;    // Set when sending starts, cleared by the TX complete interrupt
+
+            FlowControl flowControl_;
+            Dio::IDio* pRtsPin_;            // Hardware flow control RTS output
+            Dio::IDio* pCtsPin_;            // Hardware flow control CTS input, nullptr if not used
+            uint16_t rxStopThreshold_;      // RX buffer length to stop the sender at
+            uint16_t rxResumeThreshold_;    // RX buffer length to resume the sender at
+            volatile bool rxStopped_;       // True while the sender has been asked to stop
+            volatile bool txPaused_;        // True while XOFF from the other side is in effect
+            volatile uint8_t txControlChar_;    // XON/XOFF to send ahead of the TX buffer, 0 for none
+
+            /**
+             * Copy as much as fits into the TX buffer and start transmitting
+             * @return  Number of bytes buffered
+             */
+            uint16_t queueTxBytes(const uint8_t* buff, uint16_t numBytes);
+
+            /**
+             * Drop all queued zero-copy buffers, the TX interrupt must be disabled
+             */
+            void flushTxRefs();
+
+            /**
+             * Take the bus if using a driver enable pin, then enable the data register empty
+             * interrupt so the ISR starts sending from txBuffer_
+             */
+            void startTransmit();
+
+            /**
+             * Start a burst of sending, take the bus if using a driver enable pin, and clear the
+             * TX complete flag so it marks the end of this burst
+             */
+            void beginTxBurst();
+
+            /**
+             * Clear a stale TX complete flag, then enable its interrupt
+             */
+            void enableTxCompleteInterrupt();
+
+            /**
+             * Set or clear multi-processor mode's address filtering. Leaves the TX complete flag,
+             * which a plain read-modify-write of UCSRnA would clear
+             */
+            static void setAddressFilter(bool enable);
+
+            /**
+             * Set up flow control thresholds
+             */
+            void setFlowThresholds(uint16_t stopThreshold, uint16_t resumeThreshold);
+
+            /**
+             * Ask the sender to stop, from the RX ISR
+             */
+            void stopRx();
+
+            /**
+             * Let the sender continue if enough of the RX buffer has been read
+             */
+            void checkRxResume();
+
+            /**
+             * Keep the RX ISR out, e.g. to read what it writes without tearing
+             * @return  RXCIE0 as it was, for resumeRxInterrupt
+             */
+            uint8_t pauseRxInterrupt();
+
+            /**
+             * Put RXCIE0 back the way pauseRxInterrupt found it, so a receiver that was off stays off
+             * @param   rxInterrupt Return value of pauseRxInterrupt
+             */
+            void resumeRxInterrupt(uint8_t rxInterrupt);
+    };
+
+    /**
+     * Atmega328AsynchUsart with its buffers sized at compile time and stored in the object
+     */
+    template <typename Usart, uint16_t TX_LENGTH, uint16_t RX_LENGTH>
+    class Atmega328StaticAsynchUsart : public Atmega328AsynchUsart<Usart>
+    {
+        static_assert((TX_LENGTH != 0) && ((TX_LENGTH & (TX_LENGTH - 1)) == 0), "TX length must be a power of two");
+        static_assert((RX_LENGTH != 0) && ((RX_LENGTH & (RX_LENGTH - 1)) == 0), "RX length must be a power of two");
+        static_assert((TX_LENGTH <= SpscRing<uint8_t>::MAX_LENGTH) && (RX_LENGTH <= SpscRing<uint8_t>::MAX_LENGTH), "TX and RX lengths must be at most 128");
+
+        public:
+            /**
+             * Constructor
+             * @param   baudRate            UART transmission rate to use
+             * @param   fCpu                Frequency of the processor's clock
+             * @param   enableParity        Enable parity
+             * @param   polarity            Set polarity
+             */
+            Atmega328StaticAsynchUsart(BaudRate baudRate,
+                                       uint32_t fCpu,
+                                       bool enableParity = false,
+                                       bool polarity = false):
+                Atmega328AsynchUsart<Usart>(txStorage_, rxStorage_, TX_LENGTH, RX_LENGTH, baudRate, fCpu, enableParity, polarity)
+            {}
+
+            /**
+             * Constructor for any baud rate, e.g. UsartBaud<F_CPU, 250000>::settings()
+             * @param   baudSettings        Baud rate register settings
+             * @param   enableParity        Enable parity
+             * @param   polarity            Set polarity
+             */
+            Atmega328StaticAsynchUsart(BaudSettings baudSettings,
+                                       bool enableParity = false,
+                                       bool polarity = false):
+                Atmega328AsynchUsart<Usart>(txStorage_, rxStorage_, TX_LENGTH, RX_LENGTH, baudSettings, enableParity, polarity)
+            {}
+
+        private:
+            uint8_t txStorage_[TX_LENGTH];
+            uint8_t rxStorage_[RX_LENGTH];
+    };
+
+    template <typename Usart>
+    Atmega328AsynchUsart<Usart>::Atmega328AsynchUsart(uint8_t* txBuffer,
+                                                      uint8_t* rxBuffer,
+                                                      uint16_t txLength,
+                                                      uint16_t rxLength,
+                                                      BaudRate baudRate,
+                                                      uint32_t fCpu,
+                                                      bool enableParity,
+                                                      bool polarity):
+        Atmega328AsynchUsart(txBuffer, rxBuffer, txLength, rxLength, calculateBaudSettings(baudRate, fCpu), enableParity, polarity)
+    {}
+
+    template <typename Usart>
+    Atmega328AsynchUsart<Usart>::Atmega328AsynchUsart(uint8_t* txBuffer,
+                                                      uint8_t* rxBuffer,
+                                                      uint16_t txLength,
+                                                      uint16_t rxLength,
+                                                      BaudSettings baudSettings,
+                                                      bool enableParity,
+                                                      bool polarity):
+        baudSettings_(baudSettings),
+        enableParity_(enableParity),
+        polarity_(polarity),
+        txBuffer_(txBuffer, txLength),
+        rxBuffer_(rxBuffer, rxLength),
+        lineEnds_(lineEndStorage_, LINE_END_QUEUE_LENGTH),
+        lineDelimiter_('\n'),
+        onLineReceived_(nullptr),
+        onByteReceived_(nullptr),
+        txDroppedBytes_(0),
+        txHighWaterMark_(0),
+        rxHighWaterMark_(0),
+        rxStatistics_(),
+        txRefs_(txRefStorage_, TX_REF_QUEUE_LENGTH),
+        txRefOffset_(0),
+        multiProcessor_(false),
+        address_(0),
+        broadcastAddress_(MPCM_BROADCAST_ADDRESS),
+        pDePin_(nullptr),
+        onTxComplete_(nullptr),
+        txActive_(false),
+        flowControl_(FLOW_NONE),
+        pRtsPin_(nullptr),
+        pCtsPin_(nullptr),
+        rxStopThreshold_(0),
+        rxResumeThreshold_(0),
+        rxStopped_(false),
+        txPaused_(false),
+        txControlChar_(0)
+    {}
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::initialize()
+    {
+        // Ring indices are masked, so the lengths must be powers of two
+        assertCustom(SpscRing<uint8_t>::isValidLength(txBuffer_.capacity()));
+        assertCustom(SpscRing<uint8_t>::isValidLength(rxBuffer_.capacity()));
+
+        setBaudRate(baudSettings_);
+
+        // Control register values
+        uint8_t ucsrb = 0x00;
+        uint8_t ucsrc = 0x00;
+
+        // TX interrupt is only enabled while there is data to send
+        ucsrb |= (1 << RXCIE0) | // Enable RX interrupts
+                 (1 << RXEN0)  | // Enable RX
+                 (1 << TXEN0);   // Enable TX
+
+        if (enableParity_) ucsrc |= (1 << UPM01);   // Enable parity (even)
+        if (polarity_)     ucsrc |= (1 << UCPOL0);  // Polarity
+
+        ucsrc |= (1 << UCSZ01) | (1<< UCSZ00); // Data frame is 8 bits
+
+        Usart::ucsrb() = ucsrb;
+        Usart::ucsrc() = ucsrc;
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::setBaudRate(BaudRate baudRate, uint32_t fCpu)
+    {
+        setBaudRate(calculateBaudSettings(baudRate, fCpu));
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::setBaudRate(BaudSettings baudSettings)
+    {
+        baudSettings_ = baudSettings;
+
+        // Set double speed bit, keeping multi-processor mode
+        Usart::ucsra() = (Usart::ucsra() & (1 << MPCM0)) | (baudSettings.doubleSpeed ? (1 << U2X0) : 0x00);
+
+        Usart::ubrrh() = (uint8_t)(baudSettings.ubrr >> 8);
+        Usart::ubrrl() = (uint8_t)baudSettings.ubrr;
+    }
+
+    template <typename Usart>
+    bool Atmega328AsynchUsart<Usart>::autobaud(uint32_t fCpu, uint16_t timeoutMs, uint8_t syncChar)
+    {
+        // Anything queued goes out whole at the old rate, the last frame included
+        while (!isTxIdle()) {}
+
+        BaudRate baudRate = UsartAutobaud<Usart>::detect(fCpu, pTimeoutTimer_, timeoutMs, syncChar);
+
+        if (baudRate != BaudRate::NUM_BAUD_RATES)
+        {
+            setBaudRate(calculateBaudSettings(baudRate, fCpu));
+        }
+
+        // Receiver and its interrupt back on, at the detected rate if there is one
+        Usart::ucsrb() |= (1 << RXCIE0) | (1 << RXEN0);
+        return (baudRate != BaudRate::NUM_BAUD_RATES);
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::enableMultiProcessor(uint8_t address, uint8_t broadcastAddress)
+    {
+        address_ = address;
+        broadcastAddress_ = broadcastAddress;
+        multiProcessor_ = true;
+
+        // 9-bit frames, the 9th bit marks address frames. Sent data frames keep TXB8 low
+        Usart::ucsrb() = (Usart::ucsrb() & ~(1 << TXB80)) | (1 << UCSZ02);
+        setAddressFilter(true);
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::writeAddress(uint8_t address)
+    {
+        assertCustom(multiProcessor_, "Address frames need multi-processor mode");
+
+        // TX ISR turns itself off once the buffer and zero-copy queue are both empty
+        while (Usart::ucsrb() & (1 << UDRIE0)) {}
+        while (!(Usart::ucsra() & (1 << UDRE0))) {}
+
+        beginTxBurst();
+
+        // TXB8 is latched together with UDR, wait for the address to reach the shift register
+        // before clearing it for the data frames
+        Usart::ucsrb() |= (1 << TXB80);
+        Usart::udr() = address;
+        while (!(Usart::ucsra() & (1 << UDRE0))) {}
+        Usart::ucsrb() &= ~(1 << TXB80);
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::setDriverEnablePin(Dio::IDio* pDePin)
+    {
+        pDePin_ = pDePin;
+        pDePin_->set(Dio::L_LOW);
+        enableTxCompleteInterrupt();
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::setTxCompleteCallback(void (*onTxComplete)(void))
+    {
+        onTxComplete_ = onTxComplete;
+
+        if (onTxComplete_ != nullptr)
+        {
+            enableTxCompleteInterrupt();
+        }
+        else if (pDePin_ == nullptr)
+        {
+            Usart::ucsrb() &= ~(1 << TXCIE0);
+        }
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::enableTxCompleteInterrupt()
+    {
+        // Clear any stale TX complete flag before enabling its interrupt, it is cleared by writing a one.
+        // During a burst the flag belongs to it, and the interrupt handles it as soon as it is enabled
+        if (!txActive_) Usart::ucsra() = (Usart::ucsra() & ((1 << U2X0) | (1 << MPCM0))) | (1 << TXC0);
+        Usart::ucsrb() |= (1 << TXCIE0);
+    }
+
+    template <typename Usart>
+    bool Atmega328AsynchUsart<Usart>::isTxIdle()
+    {
+        if (!txActive_) return true;
+        if (!txBuffer_.isEmpty() || !txRefs_.isEmpty() || (txControlChar_ != 0)) return false;
+
+        // The TX complete interrupt clears the flag itself and reports idle through txActive_
+        if (Usart::ucsrb() & (1 << TXCIE0)) return false;
+
+        // Otherwise the flag stays set until the next burst clears it
+        return (Usart::ucsra() & (1 << TXC0)) != 0;
+    }
+
+    template <typename Usart>
+    bool Atmega328AsynchUsart<Usart>::drain(uint16_t timeoutMs)
+    {
+        bool useTimeout = (pTimeoutTimer_ != nullptr) && (timeoutMs != 0);
+        if (useTimeout)
+        {
+            pTimeoutTimer_->setPeriodMs(timeoutMs);
+            pTimeoutTimer_->enable();
+        }
+
+        SERIAL_PROFILE_BEGIN(SERIAL_PROFILE_TX_STALL);
+        while (!isTxIdle())
+        {
+            if (useTimeout && pTimeoutTimer_->hasOneShotPassed()) break;
+        }
+        SERIAL_PROFILE_END(SERIAL_PROFILE_TX_STALL);
+
+        return isTxIdle();
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::setFlowThresholds(uint16_t stopThreshold, uint16_t resumeThreshold)
+    {
+        assertCustom((resumeThreshold < stopThreshold) && (stopThreshold <= rxBuffer_.capacity()),
+                     "Flow control thresholds must be resume < stop <= RX length");
+        rxStopThreshold_ = stopThreshold;
+        rxResumeThreshold_ = resumeThreshold;
+        rxStopped_ = false;
+        txPaused_ = false;
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::enableHardwareFlowControl(Dio::IDio* pRtsPin,
+                                                                Dio::IDio* pCtsPin,
+                                                                uint16_t stopThreshold,
+                                                                uint16_t resumeThreshold)
+    {
+        setFlowThresholds(stopThreshold, resumeThreshold);
+        pRtsPin_ = pRtsPin;
+        pCtsPin_ = pCtsPin;
+
+        // Ready to receive
+        pRtsPin_->set(Dio::L_LOW);
+        flowControl_ = FLOW_HARDWARE;
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::enableSoftwareFlowControl(uint16_t stopThreshold, uint16_t resumeThreshold)
+    {
+        setFlowThresholds(stopThreshold, resumeThreshold);
+        flowControl_ = FLOW_XON_XOFF;
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::handleCtsChange()
+    {
+        // The TX ISR checks CTS itself. Only restart if something is waiting, a burst with nothing
+        // to send would never see TX complete
+        if ((pCtsPin_ != nullptr) && (pCtsPin_->read() == Dio::L_LOW) &&
+            (!txBuffer_.isEmpty() || !txRefs_.isEmpty()))
+        {
+            startTransmit();
+        }
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::stopRx()
+    {
+        rxStopped_ = true;
+        if (flowControl_ == FLOW_HARDWARE)
+        {
+            pRtsPin_->set(Dio::L_HIGH);
+        }
+        else
+        {
+            txControlChar_ = FLOW_XOFF;
+            startTransmit();
+        }
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::checkRxResume()
+    {
+        if (!rxStopped_ || (rxBuffer_.length() > rxResumeThreshold_)) return;
+
+        // RX ISR is the one that stops the sender, keep it out while resuming
+        uint8_t rxInterrupt = pauseRxInterrupt();
+        rxStopped_ = false;
+        if (flowControl_ == FLOW_HARDWARE)
+        {
+            pRtsPin_->set(Dio::L_LOW);
+        }
+        else
+        {
+            txControlChar_ = FLOW_XON;
+            startTransmit();
+        }
+        resumeRxInterrupt(rxInterrupt);
+    }
+
+    template <typename Usart>
+    uint8_t Atmega328AsynchUsart<Usart>::pauseRxInterrupt()
+    {
+        uint8_t rxInterrupt = Usart::ucsrb() & (1 << RXCIE0);
+        Usart::ucsrb() &= ~(1 << RXCIE0);
+        SPSC_BARRIER();
+        return rxInterrupt;
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::resumeRxInterrupt(uint8_t rxInterrupt)
+    {
+        SPSC_BARRIER();
+        Usart::ucsrb() |= rxInterrupt;
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::setAddressFilter(bool enable)
+    {
+        // Error flags must be written as zero, and TXC as zero to leave it alone
+        uint8_t ucsra = Usart::ucsra() & (1 << U2X0);
+        if (enable) ucsra |= (1 << MPCM0);
+        Usart::ucsra() = ucsra;
+    }
+
+    template <typename Usart>
+    uint16_t Atmega328AsynchUsart<Usart>::write(const uint8_t* buff, uint16_t numBytes)
+    {
+        uint16_t bytesWritten = queueTxBytes(buff, numBytes);
+        txDroppedBytes_ += numBytes - bytesWritten;
+        return bytesWritten;
+    }
+
+    template <typename Usart>
+    uint16_t Atmega328AsynchUsart<Usart>::writeBlocking(const uint8_t* buff, uint16_t numBytes, uint16_t timeoutMs)
+    {
+        bool useTimeout = (pTimeoutTimer_ != nullptr) && (timeoutMs != 0);
+        if (useTimeout)
+        {
+            pTimeoutTimer_->setPeriodMs(timeoutMs);
+            pTimeoutTimer_->enable();
+        }
+
+        uint16_t bytesWritten = queueTxBytes(buff, numBytes);
+        if (bytesWritten < numBytes)
+        {
+            SERIAL_PROFILE_BEGIN(SERIAL_PROFILE_TX_STALL);
+            while (bytesWritten < numBytes)
+            {
+                if (useTimeout && pTimeoutTimer_->hasOneShotPassed()) break;
+
+                bytesWritten += queueTxBytes(&buff[bytesWritten], numBytes - bytesWritten);
+            }
+            SERIAL_PROFILE_END(SERIAL_PROFILE_TX_STALL);
+        }
+
+        txDroppedBytes_ += numBytes - bytesWritten;
+        return bytesWritten;
+    }
+
+    template <typename Usart>
+    uint16_t Atmega328AsynchUsart<Usart>::queueTxBytes(const uint8_t* buff, uint16_t numBytes)
+    {
+        uint16_t bytesWritten = txBuffer_.write(buff, numBytes);
+
+        uint16_t txLength = txBuffer_.length();
+        if (txLength > txHighWaterMark_) txHighWaterMark_ = txLength;
+
+        if (bytesWritten > 0) startTransmit();
+        return bytesWritten;
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::resetTxStatistics()
+    {
+        txDroppedBytes_ = 0;
+        txHighWaterMark_ = 0;
+    }
+
+    template <typename Usart>
+    uint16_t Atmega328AsynchUsart<Usart>::getRxHighWaterMark()
+    {
+        // Written from the RX ISR, read it with the interrupt off so it cannot tear
+        uint8_t rxInterrupt = pauseRxInterrupt();
+        uint16_t result = rxHighWaterMark_;
+        resumeRxInterrupt(rxInterrupt);
+        return result;
+    }
+
+    template <typename Usart>
+    RxStatistics Atmega328AsynchUsart<Usart>::getRxStatistics()
+    {
+        uint8_t rxInterrupt = pauseRxInterrupt();
+        RxStatistics result = rxStatistics_;
+        resumeRxInterrupt(rxInterrupt);
+        return result;
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::resetRxStatistics()
+    {
+        uint8_t rxInterrupt = pauseRxInterrupt();
+        rxHighWaterMark_ = 0;
+        rxStatistics_ = RxStatistics();
+        resumeRxInterrupt(rxInterrupt);
+    }
+
+    template <typename Usart>
+    bool Atmega328AsynchUsart<Usart>::writeRef(const uint8_t* buff,
+                                               uint16_t numBytes,
+                                               void (*onComplete)(const uint8_t* pData),
+                                               bool inProgmem)
+    {
+        if (numBytes == 0)
+        {
+            // Nothing to send, buffer can be reused right away
+            if (onComplete != nullptr) onComplete(buff);
+            return true;
+        }
+
+        TxRef ref;
+        ref.descriptor.pData = buff;
+        ref.descriptor.length = numBytes;
+        ref.descriptor.inProgmem = inProgmem;
+        ref.descriptor.onComplete = onComplete;
+
+        // Send after everything already in the TX buffer, and before anything written after this
+        ref.ringPosition = txBuffer_.producerIndex();
+
+        if (!txRefs_.push(ref)) return false;
+
+        startTransmit();
+        return true;
+    }
+
+    template <typename Usart>
+    uint8_t Atmega328AsynchUsart<Usart>::writev(const TxDescriptor* descriptors, uint8_t numDescriptors)
+    {
+        for (uint8_t i=0; i<numDescriptors; i++)
+        {
+            if (!writeRef(descriptors[i].pData,
+                          descriptors[i].length,
+                          descriptors[i].onComplete,
+                          descriptors[i].inProgmem))
+            {
+                return i;
+            }
+        }
+        return numDescriptors;
+    }
+
+    template <typename Usart>
+    uint16_t Atmega328AsynchUsart<Usart>::read(uint8_t* buff, uint16_t numBytes)
+    {
+        uint16_t bytesRead = rxBuffer_.read(buff, numBytes);
+        if (flowControl_ != FLOW_NONE) checkRxResume();
+        return bytesRead;
+    }
+
+    template <typename Usart>
+    uint16_t Atmega328AsynchUsart<Usart>::pollLine(uint8_t* buff, uint16_t maxBytes)
+    {
+        if (maxBytes == 0) return 0;
+
+        // Find the oldest line end that has not already been consumed by read()
+        uint16_t lineLength = 0;
+        uint8_t* pLineEnd;
+        while ((pLineEnd = lineEnds_.peek()) != nullptr)
+        {
+            // Ring indices wrap at 256, which is more than twice any ring's capacity
+            lineLength = (uint8_t)(*pLineEnd - rxBuffer_.consumerIndex());
+            if ((lineLength != 0) && (lineLength <= rxBuffer_.capacity())) break;
+
+            uint8_t staleLineEnd;
+            lineEnds_.pop(staleLineEnd);
+        }
+
+        if (pLineEnd == nullptr)
+        {
+            // No line is coming if there is no space left to receive its end
+            if (rxBuffer_.isFull()) return read(buff, maxBytes);
+            return 0;
+        }
+
+        if (lineLength > maxBytes)
+        {
+            // Line is too long, return what fits and leave the line end for the rest
+            return read(buff, maxBytes);
+        }
+
+        uint16_t bytesRead = read(buff, lineLength);
+        uint8_t lineEnd;
+        lineEnds_.pop(lineEnd);
+
+        buff[bytesRead-1] = '\0';
+        return bytesRead;
+    }
+
+    template <typename Usart>
+    uint16_t Atmega328AsynchUsart<Usart>::readLine(uint8_t* buff, uint16_t maxBytes, uint16_t timeoutMs)
+    {
+        bool useTimeout = (pTimeoutTimer_ != nullptr) && (timeoutMs != 0);
+        if (useTimeout)
+        {
+            pTimeoutTimer_->setPeriodMs(timeoutMs);
+            pTimeoutTimer_->enable();
+        }
+
+        while (true)
+        {
+            uint16_t bytesRead = pollLine(buff, maxBytes);
+            if (bytesRead > 0) return bytesRead;
+
+            // Line will not fit in buff, return the start of it like ISerial::readLine does
+            if (rxBuffer_.length() >= maxBytes) return read(buff, maxBytes);
+
+            // Out of time, return the partial line
+            if (useTimeout && pTimeoutTimer_->hasOneShotPassed()) return read(buff, maxBytes);
+        }
+    }
+
+    template <typename Usart>
+    bool Atmega328AsynchUsart<Usart>::isDataAvailable()
+    {
+        return !rxBuffer_.isEmpty();
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::flush()
+    {
+        flushRx();
+        flushTx();
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::flushRx()
+    {
+        // Main loop is the RX consumer, so this is safe with the RX interrupt running
+        rxBuffer_.flush();
+        lineEnds_.flush();
+        if (flowControl_ != FLOW_NONE) checkRxResume();
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::flushTx()
+    {
+        // Main loop is not the TX consumer, stop the TX interrupt first so that nothing else
+        // is popping while the buffer is discarded
+        Usart::ucsrb() &= ~(1 << UDRIE0);
+        txBuffer_.flush();
+        flushTxRefs();
+
+        // Nothing may be left to finish the burst, so do not wait for its TX complete. A byte
+        // already in the shift register still goes out
+        txActive_ = false;
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::flushTxRefs()
+    {
+        // Hand every queued buffer back to its owner, none of them will be read again
+        TxRef ref;
+        while (txRefs_.pop(ref))
+        {
+            if (ref.descriptor.onComplete != nullptr) ref.descriptor.onComplete(ref.descriptor.pData);
+        }
+        txRefOffset_ = 0;
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::beginTxBurst()
+    {
+        // Data is already queued, so the TX complete interrupt will not release the bus under us
+        if (pDePin_ != nullptr) pDePin_->set(Dio::L_HIGH);
+
+        // Clear the TX complete flag from the last burst by writing a one, keeping the other
+        // writable bits and writing the error flags as zero
+        Usart::ucsra() = (Usart::ucsra() & ((1 << U2X0) | (1 << MPCM0))) | (1 << TXC0);
+        txActive_ = true;
+    }
+
+    template <typename Usart>
+    void Atmega328AsynchUsart<Usart>::startTransmit()
+    {
+        beginTxBurst();
+
+        // If the TX interrupt clears this bit between our read and write, the worst case is
+        // one extra interrupt that finds the buffer empty and disables itself again
+        Usart::ucsrb() |= (1 << UDRIE0);
+    }
+
+    template <typename Usart>
+    inline void Atmega328AsynchUsart<Usart>::handleTxComplete()
+    {
+        // Line is idle, unless more data was queued in the meantime
+        if (!txBuffer_.isEmpty() || !txRefs_.isEmpty() || (txControlChar_ != 0)) return;
+
+        txActive_ = false;
+        if (pDePin_ != nullptr) pDePin_->set(Dio::L_LOW);
+        if (onTxComplete_ != nullptr) onTxComplete_();
+    }
+
+    template <typename Usart>
+    inline void Atmega328AsynchUsart<Usart>::handleDataRegisterEmpty()
+    {
+        // Flow control characters go ahead of everything, even while paused
+        if (txControlChar_ != 0)
+        {
+            Usart::udr() = txControlChar_;
+            txControlChar_ = 0;
+            return;
+        }
+
+        if ((flowControl_ != FLOW_NONE) &&
+            (txPaused_ || ((pCtsPin_ != nullptr) && (pCtsPin_->read() == Dio::L_HIGH))))
+        {
+            // Other side cannot take more, wait for XON or handleCtsChange to restart
+            Usart::ucsrb() &= ~(1 << UDRIE0);
+            return;
+        }
+
+        // A queued reference is due once every byte written to the TX buffer before it has been sent
+        TxRef* pRef = txRefs_.peek();
+        if ((pRef != nullptr) && (pRef->ringPosition == txBuffer_.consumerIndex()))
+        {
+            const uint8_t* pData = pRef->descriptor.pData + txRefOffset_;
+            Usart::udr() = pRef->descriptor.inProgmem ? pgm_read_byte(pData) : *pData;
+
+            txRefOffset_++;
+            if (txRefOffset_ >= pRef->descriptor.length)
+            {
+                // Last byte is in the data register, the caller's buffer is no longer needed
+                void (*onComplete)(const uint8_t*) = pRef->descriptor.onComplete;
+                const uint8_t* pBuffer = pRef->descriptor.pData;
+
+                txRefOffset_ = 0;
+                TxRef done;
+                txRefs_.pop(done);
+
+                if (onComplete != nullptr) onComplete(pBuffer);
+            }
+            return;
+        }
+
+        uint8_t value;
+        if (txBuffer_.pop(value))
+        {
+            Usart::udr() = value;
+        }
+        else
+        {
+            // Nothing left to send, stop interrupting until the next write
+            Usart::ucsrb() &= ~(1 << UDRIE0);
+        }
+    }
+
+    template <typename Usart>
+    inline void Atmega328AsynchUsart<Usart>::handleRxDataAvailable()
+    {
+        // Error flags describe the byte in UDR, so they must be read before it. UDR must be read
+        // to clear the interrupt even if the byte is then dropped
+        uint8_t status = Usart::ucsra();
+        bool addressFrame = multiProcessor_ && (Usart::ucsrb() & (1 << RXB80));
+        uint8_t value = Usart::udr();
+
+        if (status & ((1 << DOR0) | (1 << FE0) | (1 << UPE0)))
+        {
+            // An overrun means bytes before this one were lost, this one is still good
+            if (status & (1 << DOR0)) rxStatistics_.overruns++;
+
+            if (status & (1 << FE0))
+            {
+                rxStatistics_.framingErrors++;
+                return;
+            }
+
+            if (status & (1 << UPE0))
+            {
+                rxStatistics_.parityErrors++;
+                return;
+            }
+        }
+
+        // Before flow control, an address equal to XON or XOFF is still an address
+        if (addressFrame)
+        {
+            // Let data through only while the bus is talking to this node
+            setAddressFilter((value != address_) && (value != broadcastAddress_));
+            return;
+        }
+
+        if ((flowControl_ == FLOW_XON_XOFF) && ((value == FLOW_XON) || (value == FLOW_XOFF)))
+        {
+            txPaused_ = (value == FLOW_XOFF);
+
+            // Resume as a new burst, like handleCtsChange, so the bus is taken again and TX
+            // complete marks the end of the resumed data. A burst with nothing to send would
+            // never see TX complete
+            if (!txPaused_ && (!txBuffer_.isEmpty() || !txRefs_.isEmpty())) startTransmit();
+            return;
+        }
+
+        // New bytes are dropped rather than overwriting old ones, the ISR never moves the consumer index
+        if (!rxBuffer_.push(value))
+        {
+            rxStatistics_.droppedBytes++;
+            return;
+        }
+
+        if (onByteReceived_ != nullptr) onByteReceived_();
+
+        uint16_t rxLength = rxBuffer_.length();
+        if (rxLength > rxHighWaterMark_) rxHighWaterMark_ = rxLength;
+
+        if ((flowControl_ != FLOW_NONE) && !rxStopped_ && (rxLength >= rxStopThreshold_)) stopRx();
+
+        if (value == lineDelimiter_)
+        {
+            // If the line end queue is full the line is merged with the next one
+            lineEnds_.push(rxBuffer_.producerIndex());
+            if (onLineReceived_ != nullptr) onLineReceived_();
+        }
+    }
+}
+
+#endif
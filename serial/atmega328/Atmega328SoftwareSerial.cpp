@@ -1,8 +1,10 @@
 #include "Atmega328SoftwareSerial.hpp"
 #include "util/delay_basic.h"
+#include <avr/io.h>
 
 #include "utilities/print/Print.hpp"
 #include "drivers/assert/Assert.hpp"
+#include "drivers/serial/SerialProfile.hpp"
 
 using namespace Dio;
 using namespace Interrupt;
@@ -12,9 +14,21 @@ namespace SerialComm
 {
     const static uint8_t WRITE_BIT_CPU_CYCLES = 86; // CPU cycles taken to write a bit value to a pin
 
-    const static uint8_t RX_INT_OPEN_CPU_CYCLES = 240;  // Number of CPU cycles between the RX pin going low, and the first bit is read on the rx pin
     const static uint8_t READ_BIT_CPU_CYCLES = 106;     // Number of CPU cycles taken to perform a pin read
 
+    // CPU cycles between the RX pin going low and the first data bit being read, for an RX pin at
+    // bit 0 of its port, counted from the disassembly of each step of the path:
+    //      10  pin change synchronizer, interrupt response and the vector's jmp
+    //      42  PCINT ISR prologue, loading the port's handler and the icall
+    //      40  handleRxInterrupt reading PINx, finding the pin and calling receiveByte
+    //      46  receiveByte up to calling pauseInterrupts through the vtable
+    //      64  pauseInterrupts with its two virtual calls, and the cli
+    //       4  loading the delay count, less the delay loop's shorter last pass
+    //      39  virtual call of the first read(), up to its load of PINx
+    // An instruction still running when the pin changes can add up to 4 more, which is not counted
+    const static uint8_t RX_ENTRY_CPU_CYCLES = 245;
+    const static uint8_t RX_SCAN_CPU_CYCLES_PER_PIN = 10;   // Each lower pin of the port handleRxInterrupt steps past first
+
     /**
      * Delays for units of 4 cpu cycles
      * @param   quadCpuCycles   Number of cpu cycles to delay, divided by 4
@@ -28,6 +42,29 @@ namespace SerialComm
     static uint8_t numActiveSerialConns = 0;        // Number of running software serials
     static Atmega328SoftwareSerial* activeSerialConns[MAX_NUM_SOFT_SERIAL] = { nullptr }; // List of active software serial objects
 
+    // RX pin change dispatch, keyed by PCINT port and bit so the interrupt does not search every
+    // software serial. RX pins are read straight from the PIN register, so they must not be inverted
+    const static uint8_t NUM_PCINT_PORTS = 3;
+    const static uint8_t PCINT_PINS_PER_PORT = 8;
+    static volatile uint8_t* const PCINT_PIN_REGS[NUM_PCINT_PORTS] = { &PINB, &PINC, &PIND };
+    static uint8_t rxPinMasks[NUM_PCINT_PORTS] = { 0 };  // RX pins in use on each port
+    static Atmega328SoftwareSerial* rxPinConns[NUM_PCINT_PORTS][PCINT_PINS_PER_PORT] = { { nullptr } };
+
+    const static uint8_t TX_FRAME_BITS = 10;    // Start bit, 8 data bits, stop bit
+
+    const static uint8_t RX_IDLE = 0xFF;                // Timed RX is waiting for a start bit
+    const static uint8_t RX_STOP_BIT = 9;               // Index of the stop bit in a frame
+    const static uint8_t RX_START_LATENCY_CPU_CYCLES = 80;  // CPU cycles between the RX pin going low, and the RX timer being restarted
+    const static uint8_t RX_SAMPLE_LATENCY_CPU_CYCLES = 40; // CPU cycles between the RX timer compare match, and the RX pin being read
+    const static uint8_t RX_SAMPLE_PERIOD_CPU_CYCLES = 60;  // CPU cycles between the RX timer compare match, and the start bit sample setting the bit period
+
+    // Timed RX interrupts carry no context, so each timer gets a handler bound to a slot
+    const static uint8_t MAX_NUM_TIMED_RX = 3;
+    static uint8_t numTimedRxConns = 0;
+    static Atmega328SoftwareSerial* timedRxConns[MAX_NUM_TIMED_RX] = { nullptr };
+
+    ITimer* Atmega328SoftwareSerial::pTxTimer_ = nullptr;
+
     Atmega328SoftwareSerial::Atmega328SoftwareSerial(Dio::IDio* pRxPin,
                                                      Dio::IDio* pTxPin,
                                                      Interrupt::IInterrupt* pIntControl,
@@ -41,7 +78,21 @@ namespace SerialComm
         pTxPin_(pTxPin),
         pIntControl_(pIntControl),
         dataAvailable_(false),
-        rxOverflow_(false)
+        rxOverflow_(false),
+        baudRate_(baudRate),
+        fCpu_(fCpu),
+        framingErrors_(0),
+        overflowErrors_(0),
+        pRxTimer_(nullptr),
+        rxFirstSampleTics_(0),
+        rxBitTics_(0),
+        rxBitIndex_(RX_IDLE),
+        rxByte_(0),
+        txBuffer_(nullptr, 0),
+        txTicksPerBit_(0),
+        txTicksUntilBit_(1),
+        txBitsLeft_(0),
+        txFrame_(0)
     {
         // Desired amount of time for each bit value to be held on each pin
         uint32_t cpuCyclesPerBit = (fCpu / baudRate);
@@ -54,12 +105,10 @@ namespace SerialComm
         // Time to wait between each bit for reading, calculated as the baud rate minues the overhead to perform the pin read
         rxInterBitQuadCycles_ = (cpuCyclesPerBit - READ_BIT_CPU_CYCLES) / 4;
 
-        // Time to wait before the first read, in order to read as close to the center of the pulse as possible
-        // calculated as half of the baud rate minus the overhead for all logic for entering the RX interrupt
-        rxCenteringQuadCycles_ = ((3 * cpuCyclesPerBit / 2) - RX_INT_OPEN_CPU_CYCLES) / 4;
+        // Time to wait before the first read depends on where the RX pin is, set by initialize()
+        rxCenteringQuadCycles_ = 0;
 
         // Don't go below 0, if we hit 0 its likely it will not work
-        if (rxCenteringQuadCycles_ < 0) rxCenteringQuadCycles_ = 0;
         if (rxInterBitQuadCycles_ < 0) rxInterBitQuadCycles_ = 0;
         if (txDelayQuadCycles_ < 0) txDelayQuadCycles_ = 0;
 
@@ -70,13 +119,38 @@ namespace SerialComm
     {
         // Set up interrupt for receiving
 
-        // Add this object to the static array for handling RX interrupts
+        static void (* const RX_PORT_HANDLERS[NUM_PCINT_PORTS])(void) =
+        {
+            handleRxInterrupt<0>,
+            handleRxInterrupt<1>,
+            handleRxInterrupt<2>
+        };
+
+        // Add this object to the static array for timed TX
         assertCustom(numActiveSerialConns < MAX_NUM_SOFT_SERIAL);
         activeSerialConns[numActiveSerialConns] = this;
         numActiveSerialConns++;
 
-        // Enable pin change interrupt on RX
-        pRxPin_->enableInterrupt(handleRxInterrupt);
+        // Add this object to the RX dispatch table under its pin
+        uint8_t pcint = pRxPin_->getPinChangeNumber();
+        assertCustom(pcint != Dio::NO_PIN_CHANGE, "Soft serial RX pin has no pin change interrupt");
+
+        uint8_t port = pcint / PCINT_PINS_PER_PORT;
+        uint8_t bit = pcint % PCINT_PINS_PER_PORT;
+        assertCustom((port < NUM_PCINT_PORTS) && (rxPinConns[port][bit] == nullptr));
+        rxPinConns[port][bit] = this;
+        rxPinMasks[port] |= (1 << bit);
+
+        // Time to wait before the first read, so it lands on the center of the first data bit, one and
+        // a half bits after the start bit's edge less the time the RX interrupt takes to get there
+        int32_t entryCycles = RX_ENTRY_CPU_CYCLES + (bit * RX_SCAN_CPU_CYCLES_PER_PIN);
+        int32_t centeringCycles = (3 * (int32_t)(fCpu_ / baudRate_) / 2) - entryCycles;
+
+        // A count of 0 would delay for 65536 passes, this is as early as it gets
+        rxCenteringQuadCycles_ = (centeringCycles >= 4) ? (centeringCycles / 4) : 1;
+
+        // Enable pin change interrupt on RX, every software serial on a port shares its handler
+        pRxPin_->enableInterrupt(RX_PORT_HANDLERS[port]);
 
         // Make sure we are in tx standby by pullng high
         if (pTxPin_->read() == L_LOW)
@@ -87,18 +161,103 @@ namespace SerialComm
         }
     }
 
+    void Atmega328SoftwareSerial::enableTimedTx(ITimer* pTimer,
+                                                uint32_t tickRateHz,
+                                                uint8_t* txBuffer,
+                                                uint16_t txBufferLen)
+    {
+        // All software serials share one bit clock
+        assertCustom((pTxTimer_ == nullptr) || (pTxTimer_ == pTimer));
+        assertCustom(SpscRing<uint8_t>::isValidLength(txBufferLen));
+
+        // Round to the nearest whole number of ticks per bit
+        uint32_t ticksPerBit = (tickRateHz + (baudRate_ / 2)) / baudRate_;
+        assertCustom((ticksPerBit > 0) && (ticksPerBit <= 0xFF), "Soft serial tick rate does not fit baud rate");
+
+        txBuffer_ = SpscRing<uint8_t>(txBuffer, txBufferLen);
+        txTicksPerBit_ = ticksPerBit;
+
+        pTxTimer_ = pTimer;
+        pTxTimer_->setInterrupt(handleTxTick);
+    }
+
+    template <uint8_t SLOT>
+    void Atmega328SoftwareSerial::handleRxSample()
+    {
+        SERIAL_PROFILE_BEGIN(SERIAL_PROFILE_SOFT_RX_SAMPLE);
+        timedRxConns[SLOT]->rxSample();
+        SERIAL_PROFILE_END(SERIAL_PROFILE_SOFT_RX_SAMPLE);
+    }
+
+    void Atmega328SoftwareSerial::enableTimedRx(ITimer* pTimer, uint32_t timerTicksPerSecond)
+    {
+        static void (* const RX_SAMPLE_HANDLERS[MAX_NUM_TIMED_RX])(void) =
+        {
+            handleRxSample<0>,
+            handleRxSample<1>,
+            handleRxSample<2>
+        };
+
+        assertCustom(numTimedRxConns < MAX_NUM_TIMED_RX);
+
+        // Timer periods are top values, one less than the number of ticks
+        uint32_t bitTics = (timerTicksPerSecond + (baudRate_ / 2)) / baudRate_;
+        assertCustom((bitTics > 1) && (bitTics - 1 <= pTimer->getMaxPeriodTics()), "Soft serial RX timer cannot fit baud rate");
+
+        // Sample the start bit at its center, taking out the time spent reaching the timer restart
+        // and, since every sample is late by the same amount, the time from a match to the pin read
+        uint32_t sampleLatencyTics = ((uint32_t)RX_SAMPLE_LATENCY_CPU_CYCLES * timerTicksPerSecond) / fCpu_;
+        uint32_t latencyTics = ((uint32_t)RX_START_LATENCY_CPU_CYCLES * timerTicksPerSecond) / fCpu_ + sampleLatencyTics;
+        uint32_t firstSampleTics = bitTics / 2;
+        firstSampleTics = (firstSampleTics > latencyTics) ? (firstSampleTics - latencyTics) : 0;
+
+        // The first period must outlast the start bit sample getting to set the bit period, or the
+        // short period matches again first. At high baud rates this samples past the center
+        uint32_t minFirstSampleTics = ((uint32_t)RX_SAMPLE_PERIOD_CPU_CYCLES * timerTicksPerSecond) / fCpu_ + 1;
+        if (firstSampleTics < minFirstSampleTics) firstSampleTics = minFirstSampleTics;
+
+        rxBitTics_ = bitTics - 1;
+        rxFirstSampleTics_ = firstSampleTics - 1;
+
+        pRxTimer_ = pTimer;
+        pRxTimer_->disable();
+        pRxTimer_->setInterrupt(RX_SAMPLE_HANDLERS[numTimedRxConns]);
+
+        timedRxConns[numTimedRxConns] = this;
+        numTimedRxConns++;
+    }
+
     bool Atmega328SoftwareSerial::isDataAvailable()
     {
         return dataAvailable_;
     }
 
-    void Atmega328SoftwareSerial::write(const uint8_t* buff, uint16_t numBytes)
+    uint16_t Atmega328SoftwareSerial::getTxSpace()
+    {
+        if (txTicksPerBit_ == 0) return TX_SPACE_UNLIMITED;
+        return txBuffer_.capacity() - txBuffer_.length();
+    }
+
+    uint16_t Atmega328SoftwareSerial::write(const uint8_t* buff, uint16_t numBytes)
     {
+        if (txTicksPerBit_ != 0)
+        {
+            // Timed TX, the timer interrupt sends whatever fits in the buffer
+            uint16_t bytesWritten = txBuffer_.write(buff, numBytes);
+
+            // The tick handler disables the timer only when it finds nothing left to send, so
+            // enabling after the data is buffered cannot leave it stopped with data waiting
+            if (bytesWritten > 0) pTxTimer_->enable();
+            return bytesWritten;
+        }
+
         // Write each byte out, this is a blocking write
         for (uint16_t i=0; i<numBytes; i++)
         {
             writeByte(buff[i]);
         }
+
+        return numBytes;
     }
 
     uint16_t Atmega328SoftwareSerial::read(uint8_t* buff, uint16_t numBytes)
@@ -138,6 +297,26 @@ namespace SerialComm
         return result;
     }
 
+    RxStatistics Atmega328SoftwareSerial::getRxStatistics()
+    {
+        RxStatistics result = RxStatistics();
+
+        // Counts are updated from interrupts, do not let them change mid-read
+        pIntControl_->pauseInterrupts();
+        result.framingErrors = framingErrors_;
+        result.droppedBytes = overflowErrors_;
+        pIntControl_->resumeInterrupts();
+        return result;
+    }
+
+    void Atmega328SoftwareSerial::resetRxStatistics()
+    {
+        pIntControl_->pauseInterrupts();
+        framingErrors_ = 0;
+        overflowErrors_ = 0;
+        pIntControl_->resumeInterrupts();
+    }
+
     void Atmega328SoftwareSerial::flush()
     {
         rxBuffer_.flush();
@@ -196,10 +375,68 @@ namespace SerialComm
             accurateDelay(rxInterBitQuadCycles_);
         }
 
-        // // Do not save byte if our buffer is full, but instead set overflow flag
+        storeRxByte(data);
+        
+        // Ensure we have stopped
+        // while (pRxPin_->read() == L_LOW)
+        // {}
+
+        // Re-enable interrupts, timing critical region has ended
+        pIntControl_->resumeInterrupts();
+    }
+
+    bool Atmega328SoftwareSerial::txTick()
+    {
+        if (--txTicksUntilBit_ != 0) return true;
+        txTicksUntilBit_ = txTicksPerBit_;
+
+        if (txBitsLeft_ == 0)
+        {
+            // Previous stop bit is done, start the next byte if there is one
+            uint8_t byte;
+            if (!txBuffer_.pop(byte))
+            {
+                // Idle, check again on the next tick
+                txTicksUntilBit_ = 1;
+                return false;
+            }
+
+            // Start bit (low) first, then LSB to MSB, then stop bit (high)
+            txFrame_ = ((uint16_t)byte << 1) | (1 << (TX_FRAME_BITS - 1));
+            txBitsLeft_ = TX_FRAME_BITS;
+        }
+
+        pTxPin_->set((uint8_t)(txFrame_ & 0x01));
+        txFrame_ >>= 1;
+        txBitsLeft_--;
+
+        return true;
+    }
+
+    void Atmega328SoftwareSerial::handleTxTick()
+    {
+        SERIAL_PROFILE_BEGIN(SERIAL_PROFILE_SOFT_TX_TICK);
+        bool txBusy = false;
+        for (uint8_t i=0; i<numActiveSerialConns; i++)
+        {
+            Atmega328SoftwareSerial* pSerial = activeSerialConns[i];
+            if ((pSerial == nullptr) || (pSerial->txTicksPerBit_ == 0)) continue;
+
+            if (pSerial->txTick()) txBusy = true;
+        }
+
+        // Stop ticking until the next write
+        if (!txBusy) pTxTimer_->disable();
+        SERIAL_PROFILE_END(SERIAL_PROFILE_SOFT_TX_TICK);
+    }
+
+    void Atmega328SoftwareSerial::storeRxByte(uint8_t data)
+    {
+        // Do not save byte if our buffer is full, but instead set overflow flag
         if (rxBuffer_.isFull())
         {
             rxOverflow_ = true;
+            overflowErrors_++;
         }
         else
         {
@@ -207,29 +444,88 @@ namespace SerialComm
             rxBuffer_.push(data);
             dataAvailable_ = true;
         }
-        
-        // Ensure we have stopped
-        // while (pRxPin_->read() == L_LOW)
-        // {}
+    }
 
-        // Re-enable interrupts, timing critical region has ended
-        pIntControl_->resumeInterrupts();
+    void Atmega328SoftwareSerial::startRxSampling()
+    {
+        rxBitIndex_ = 0;
+        rxByte_ = 0;
+
+        pRxTimer_->reset();
+        pRxTimer_->setPeriodTics(rxFirstSampleTics_);
+        pRxTimer_->enable();
     }
 
-    void Atmega328SoftwareSerial::handleRxInterrupt()
+    void Atmega328SoftwareSerial::rxSample()
     {
-        for (uint8_t i=0; i<numActiveSerialConns; i++)
-        {
-            // Find the serial whose RX pin is low, indicating a start bit
-            Atmega328SoftwareSerial* pSerial = activeSerialConns[i];
-            if (pSerial == nullptr) continue;
+        Level level = pRxPin_->read();
 
-            if (pSerial->pRxPin_->read() == L_LOW)
+        if (rxBitIndex_ == 0)
+        {
+            // Center of the start bit, if the line is high again the edge was a glitch
+            if (level == L_HIGH)
             {
-                pSerial->receiveByte();
+                pRxTimer_->disable();
+                rxBitIndex_ = RX_IDLE;
                 return;
             }
+
+            // Every sample after this is one bit later
+            pRxTimer_->setPeriodTics(rxBitTics_);
+        }
+        else if (rxBitIndex_ < RX_STOP_BIT)
+        {
+            // Data bits are LSB to MSB
+            rxByte_ >>= 1;
+            if (level == L_HIGH) rxByte_ |= 0x80;
+        }
+        else
+        {
+            // Stop bit, frame is done either way
+            pRxTimer_->disable();
+            rxBitIndex_ = RX_IDLE;
+
+            if (level == L_LOW)
+            {
+                framingErrors_++;
+            }
+            else
+            {
+                storeRxByte(rxByte_);
+            }
+            return;
         }
 
+        rxBitIndex_++;
+    }
+
+    template <uint8_t PORT>
+    void Atmega328SoftwareSerial::handleRxInterrupt()
+    {
+        SERIAL_PROFILE_BEGIN(SERIAL_PROFILE_SOFT_RX_ISR);
+
+        // RX pins on this port that are low, each is a start bit or a bit of a frame being sampled
+        uint8_t lowPins = (uint8_t)~(*PCINT_PIN_REGS[PORT]) & rxPinMasks[PORT];
+
+        Atmega328SoftwareSerial* const* ppSerial = rxPinConns[PORT];
+        for (; lowPins != 0; lowPins >>= 1, ppSerial++)
+        {
+            if ((lowPins & 0x01) == 0) continue;
+            Atmega328SoftwareSerial* pSerial = *ppSerial;
+
+            if (pSerial->pRxTimer_ != nullptr)
+            {
+                // Timed RX only needs the first falling edge of each frame, the timer does the rest
+                if (pSerial->rxBitIndex_ == RX_IDLE)
+                {
+                    pSerial->startRxSampling();
+                }
+                continue;
+            }
+
+            pSerial->receiveByte();
+            break;
+        }
+        SERIAL_PROFILE_END(SERIAL_PROFILE_SOFT_RX_ISR);
     }
 }
\ No newline at end of file
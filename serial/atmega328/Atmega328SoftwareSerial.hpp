@@ -9,6 +9,8 @@
 #include "drivers/dio/IDio.hpp"
 #include "drivers/interrupt/IInterrupt.hpp"
 #include "drivers/timer/SoftwareTimer.hpp"
+#include "drivers/timer/ITimer.hpp"
+#include "drivers/serial/SpscRing.hpp"
 
 #include "utilities/circular_queue/CircularQueue.hpp"
 
@@ -49,12 +51,45 @@ namespace SerialComm
              */
             bool isDataAvailable() override;
 
+            /**
+             * Switch TX from busy waiting to being clocked out by a timer compare interrupt, so that
+             * write() only buffers data and returns immediately.
+             * Every software serial using timed TX shares the same timer, so the tick rate must be a
+             * multiple of each of their baud rates.
+             * 
+             * @param   pTimer      Timer whose compare interrupt fires at tickRateHz, its interrupt is taken over
+             * @param   tickRateHz  Frequency of the timer interrupt
+             * @param   txBuffer    Buffer where outgoing data will be stored
+             * @param   txBufferLen Size of the txBuffer, must be a power of two up to 128
+             */
+            void enableTimedTx(Timer::ITimer* pTimer,
+                               uint32_t tickRateHz,
+                               uint8_t* txBuffer,
+                               uint16_t txBufferLen);
+
+            /**
+             * Switch RX from reading the whole byte inside the pin change interrupt to sampling each
+             * bit from a timer compare interrupt. The start bit edge starts the timer, then each bit is
+             * sampled at its center in a short interrupt, so other interrupts are only held off briefly.
+             * 
+             * @param   pTimer              Timer to use for this software serial only, its interrupt is taken over
+             * @param   timerTicksPerSecond Frequency the timer counts at
+             */
+            void enableTimedRx(Timer::ITimer* pTimer, uint32_t timerTicksPerSecond);
+
             /**
              * Write out data
+             * Blocks until sent, unless timed TX is enabled, in which case it only buffers the data
              * @param   buff        Buffer of data to transmit
              * @param   numBytes    Number of bytes to transmit
+             * @return  Number of bytes transmitted or buffered
+             */
+            uint16_t write(const uint8_t* buff, uint16_t numBytes) override;
+
+            /**
+             * @return  Free space in the TX buffer with timed TX, otherwise writes block and there is no limit
              */
-            void write(const uint8_t* buff, uint16_t numBytes) override;
+            uint16_t getTxSpace() override;
 
             /**
              * Read data that has been received
@@ -75,6 +110,17 @@ namespace SerialComm
             */
             bool checkRxOverflow();
 
+            /**
+             * @return  Receive error counts. Framing errors are only detected by timed RX, there is no
+             *          parity or overrun detection
+             */
+            RxStatistics getRxStatistics() override;
+
+            /**
+             * Clear the RX error counts
+             */
+            void resetRxStatistics() override;
+
         private:
             CircularQueue<uint8_t> rxBuffer_;   // Circular queue for receiving data
 
@@ -89,6 +135,28 @@ namespace SerialComm
             bool dataAvailable_;    // When true, there is data that has been received but not claimed by read()
             bool rxOverflow_;       // When true, data was received when the RX queue was already full
 
+            uint32_t baudRate_;     // Bits transfered per second
+            uint32_t fCpu_;         // Frequency of the processor's clock
+
+            uint16_t framingErrors_;    // Bytes whose stop bit was low
+            uint16_t overflowErrors_;   // Bytes received while the RX queue was full
+
+            // Timed RX, only used when enableTimedRx has been called
+            Timer::ITimer* pRxTimer_;           // Timer dedicated to sampling RX bits, nullptr when timed RX is off
+            uint16_t rxFirstSampleTics_;        // Timer period from the start bit edge to the center of the start bit
+            uint16_t rxBitTics_;                // Timer period between samples
+            volatile uint8_t rxBitIndex_;       // Bit of the frame sampled next, RX_IDLE when waiting for a start bit
+            uint8_t rxByte_;                    // Data bits received so far
+
+            // Timed TX, only used when enableTimedTx has been called
+            SpscRing<uint8_t> txBuffer_;        // Outgoing bytes, popped by the timer interrupt
+            uint8_t txTicksPerBit_;             // Timer ticks to hold each bit for, 0 when timed TX is off
+            volatile uint8_t txTicksUntilBit_;  // Timer ticks left until the next bit is output
+            volatile uint8_t txBitsLeft_;       // Bits of txFrame_ left to output, 0 when idle
+            uint16_t txFrame_;                  // Start, data and stop bits of the byte being sent, LSB first
+
+            static Timer::ITimer* pTxTimer_;    // Timer shared by every software serial using timed TX
+
             /**
              * Writes out a single byte on the TX pin
              * @param   byte    Byte to transmit
@@ -100,8 +168,37 @@ namespace SerialComm
              */
             void receiveByte();
 
-            // Interrupt handler for data change events on the RX pin
+            /**
+             * Store a received byte, or count an overflow if there is no room
+             */
+            void storeRxByte(uint8_t data);
+
+            /**
+             * Start bit edge seen on the RX pin, start the timer to sample the frame
+             */
+            void startRxSampling();
+
+            /**
+             * Timer interrupt for timed RX, sample the RX pin for the next bit of the frame
+             */
+            void rxSample();
+
+            // Timed RX timer interrupt handler for the software serial in timedRxConns[SLOT]
+            template <uint8_t SLOT>
+            static void handleRxSample();
+
+            /**
+             * Output the next TX bit if it is due
+             * @return  True if there is still data to send
+             */
+            bool txTick();
+
+            // Interrupt handler for data change events on the RX pins of PCINT port PORT
+            template <uint8_t PORT>
             static void handleRxInterrupt();
+
+            // Interrupt handler for the timed TX timer, clocks out bits for every software serial
+            static void handleTxTick();
     };
 }
 
@@ -1,29 +1,30 @@
 #include "Atmega328Uart.hpp"
 #include "drivers/assert/Assert.hpp"
+#include "drivers/serial/SerialProfile.hpp"
+#include "drivers/serial/atmega328/UsartRegisters.hpp"
 #include <avr/io.h>
+#include <avr/interrupt.h>
 
 #include "utilities/print/Print.hpp"
 
 namespace SerialComm
 {
-    const static uint32_t baudRates[] =
-    {
-        [BaudRate::BAUD_9600] = 9600,
-        [BaudRate::BAUD_115200] = 115200
-    };
-
-    const uint32_t BAUD_DIVISOR = 16;
-    const uint32_t DOUBLE_BAUD_DIVISOR = 8;
-
     Atmega328Uart::Atmega328Uart(BaudRate baudRate,
                                  uint32_t fCpu,
                                  bool enableParity,
                                  bool polarity,
                                  Timer::SoftwareTimer* pTimeoutTimer):
-        baudRate_(baudRate),
-        fCpu_(fCpu),
+        Atmega328Uart(calculateBaudSettings(baudRate, fCpu), enableParity, polarity, pTimeoutTimer)
+    {}
+
+    Atmega328Uart::Atmega328Uart(BaudSettings baudSettings,
+                                 bool enableParity,
+                                 bool polarity,
+                                 Timer::SoftwareTimer* pTimeoutTimer):
+        baudSettings_(baudSettings),
         enableParity_(enableParity),
-        polarity_(polarity)
+        polarity_(polarity),
+        rxStatistics_()
     {
         setTimeoutTimer(pTimeoutTimer);
     }
@@ -33,7 +34,7 @@ namespace SerialComm
 
     void Atmega328Uart::initialize()
     {
-        setBaudRate(baudRate_, fCpu_);
+        setBaudRate(baudSettings_);
 
         // Control register values
         uint8_t ucsrb = 0x00;
@@ -51,25 +52,56 @@ namespace SerialComm
         UCSR0C = ucsrc;
     }
 
-    void Atmega328Uart::write(const uint8_t* buff, uint16_t numBytes)
+    bool Atmega328Uart::isDataAvailable()
+    {
+        return (UCSR0A & (1 << RXC0)) != 0;
+    }
+
+    uint16_t Atmega328Uart::write(const uint8_t* buff, uint16_t numBytes)
     {
         for (uint16_t i=0; i<numBytes; i++)
         {
             // Wait until data register is empty (no reading or writing in progress)
+            SERIAL_PROFILE_BEGIN(SERIAL_PROFILE_TX_STALL);
             while(!(UCSR0A & (1 << UDRE0))){}
+            SERIAL_PROFILE_END(SERIAL_PROFILE_TX_STALL);
 
             UDR0 = buff[i];
         }
+
+        return numBytes;
     }
 
     uint16_t Atmega328Uart::read(uint8_t* buff, uint16_t numBytes)
     {
-        for (uint16_t i=0; i<numBytes; i++)
+        uint16_t i = 0;
+        while (i < numBytes)
         {
             // Wait until the Read Complete flag is set
+            SERIAL_PROFILE_BEGIN(SERIAL_PROFILE_RX_STALL);
             while(!(UCSR0A & (1 << RXC0))){}
+            SERIAL_PROFILE_END(SERIAL_PROFILE_RX_STALL);
+
+            // Error flags describe the byte in UDR0, so they must be read before it
+            uint8_t status = UCSR0A;
+            uint8_t value = UDR0;
+
+            if (status & (1 << DOR0)) rxStatistics_.overruns++;
+
+            // Drop corrupted bytes and wait for the next one
+            if (status & (1 << FE0))
+            {
+                rxStatistics_.framingErrors++;
+                continue;
+            }
 
-            buff[i] = UDR0;
+            if (status & (1 << UPE0))
+            {
+                rxStatistics_.parityErrors++;
+                continue;
+            }
+
+            buff[i++] = value;
         }
 
         return numBytes;
@@ -77,32 +109,31 @@ namespace SerialComm
 
     void Atmega328Uart::setBaudRate(BaudRate baudRate, uint32_t fCpu)
     {
-        assertCustom(baudRate < BaudRate::NUM_BAUD_RATES);
+        setBaudRate(calculateBaudSettings(baudRate, fCpu));
+    }
+
+    void Atmega328Uart::setBaudRate(BaudSettings baudSettings)
+    {
+        baudSettings_ = baudSettings;
+
+        // Set double speed bit
+        UCSR0A = baudSettings.doubleSpeed ? (1 << U2X0) : 0x00;
 
-        uint32_t baud = baudRates[static_cast<uint8_t>(baudRate)];
-        uint32_t ubrr = 0;
-        uint8_t ucsra = 0x00;
+        UBRR0H = (uint8_t)(baudSettings.ubrr >> 8);
+        UBRR0L = (uint8_t)baudSettings.ubrr;
+    }
+
+    bool Atmega328Uart::autobaud(uint32_t fCpu, uint16_t timeoutMs, uint8_t syncChar)
+    {
+        BaudRate baudRate = UsartAutobaud<Usart0>::detect(fCpu, pTimeoutTimer_, timeoutMs, syncChar);
 
-        switch (baudRate)
+        if (baudRate != BaudRate::NUM_BAUD_RATES)
         {
-            case BAUD_115200:
-            {
-                // Use double speed (divisor of 8)
-                ucsra |= (1 << U2X0); // Double speed bit
-                ubrr = (fCpu / (DOUBLE_BAUD_DIVISOR * baud)) - 1;
-                break;
-            }
-            default:
-            {
-                ubrr = (fCpu / (BAUD_DIVISOR * baud)) - 1;
-                break;
-            }
+            baudSettings_ = calculateBaudSettings(baudRate, fCpu);
         }
 
-        // Set double speed bit
-        UCSR0A = ucsra;
-
-        UBRR0H = (uint8_t)(ubrr >> 8);
-        UBRR0L = (uint8_t)ubrr;
+        // Back to normal receiving, at the detected rate if there is one
+        initialize();
+        return (baudRate != BaudRate::NUM_BAUD_RATES);
     }
-}
\ No newline at end of file
+}
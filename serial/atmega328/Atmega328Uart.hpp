@@ -2,6 +2,8 @@
 #define ATMEGA328_UART_HPP
 
 #include "drivers/serial/ISerial.hpp"
+#include "drivers/serial/atmega328/UsartBaud.hpp"
+#include "drivers/serial/atmega328/UsartAutobaud.hpp"
 
 namespace SerialComm
 {
@@ -13,23 +15,53 @@ namespace SerialComm
                           bool enableParity = false,
                           bool polarity = false,
                           Timer::SoftwareTimer* pTimeoutTimer = nullptr);
+
+            /**
+             * Constructor for any baud rate, e.g. UsartBaud<F_CPU, 250000>::settings()
+             */
+            Atmega328Uart(BaudSettings baudSettings,
+                          bool enableParity = false,
+                          bool polarity = false,
+                          Timer::SoftwareTimer* pTimeoutTimer = nullptr);
             ~Atmega328Uart();
 
             virtual void initialize() override;
 
+            /**
+             * @return  True if a received byte is waiting, so read() of one byte does not block
+             */
+            virtual bool isDataAvailable() override;
+
             // Blocking write
-            virtual void write(const uint8_t* buff, uint16_t numBytes) override;
+            virtual uint16_t write(const uint8_t* buff, uint16_t numBytes) override;
 
-            // Blocking read
+            // Blocking read, bytes with framing or parity errors are dropped
             virtual uint16_t read(uint8_t* buff, uint16_t numBytes) override;
 
+            virtual RxStatistics getRxStatistics() override { return rxStatistics_; }
+            virtual void resetRxStatistics() override { rxStatistics_ = RxStatistics(); }
+
             void setBaudRate(BaudRate baudRate, uint32_t fCpu);
+            void setBaudRate(BaudSettings baudSettings);
+
+            /**
+             * Detect the baud rate from a sync character sent by the other end, then initialize
+             * the UART at that rate. The other end should repeat the sync character until it gets
+             * an answer, the first frames are used for timing and are not received.
+             * See UsartAutobaud for what this borrows while it runs
+             * @param   fCpu        Frequency of the processor's clock
+             * @param   timeoutMs   Give up after this long and keep the current rate, 0 waits
+             *                      forever. Needs a timeout timer whose tic source is not on Timer1
+             * @param   syncChar    Character to time, 'U' has an edge at every bit
+             * @return  True if a standard baud rate was found
+             */
+            bool autobaud(uint32_t fCpu, uint16_t timeoutMs = 0, uint8_t syncChar = AUTOBAUD_SYNC_CHAR);
 
         protected:
-            BaudRate baudRate_;
-            uint32_t fCpu_;
+            BaudSettings baudSettings_;
             bool enableParity_;
             bool polarity_;
+            RxStatistics rxStatistics_;
 
     };
 }
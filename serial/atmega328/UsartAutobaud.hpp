@@ -0,0 +1,181 @@
+/**
+ * Baud rate detection for any USART, templated over the USART's register set
+ *
+ * The other end repeats a sync character, and the time from its start bit to its last edge is
+ * measured on the RXD pin with the receiver off. The USART drivers call it, then set the rate it
+ * found and turn their receiver back on.
+ *
+ * Interrupts are held off while a frame is timed, and Timer1 is borrowed as a cycle counter. Its
+ * interrupts are masked and its settings and count put back afterwards, so a tic source on Timer1
+ * loses the time this takes, and cannot clock the timeout. Edges are found by polling, which is
+ * accurate to about a dozen cycles, so rates above 115200 baud may not lock when the clocks are
+ * also off by a few percent.
+ */
+#ifndef USART_AUTOBAUD_HPP
+#define USART_AUTOBAUD_HPP
+
+#include "drivers/serial/atmega328/UsartBaud.hpp"
+#include "drivers/timer/SoftwareTimer.hpp"
+#include "drivers/assert/Assert.hpp"
+
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+namespace SerialComm
+{
+    // 'U', which has an edge at every bit
+    const static uint8_t AUTOBAUD_SYNC_CHAR = 0x55;
+
+    template <typename Usart>
+    class UsartAutobaud
+    {
+        public:
+            /**
+             * Time sync characters until one matches a standard baud rate. The receiver is turned
+             * off, and left off for the caller to set the rate and turn it back on
+             * @param   fCpu            Frequency of the processor's clock
+             * @param   pTimeoutTimer   Timer for the timeout, its tic source must not be on Timer1
+             * @param   timeoutMs       Give up after this long, 0 or no timer waits forever
+             * @param   syncChar        Character the other end repeats
+             * @return  The rate found, or NUM_BAUD_RATES if the timeout passed first
+             */
+            static BaudRate detect(uint32_t fCpu,
+                                   Timer::SoftwareTimer* pTimeoutTimer,
+                                   uint16_t timeoutMs,
+                                   uint8_t syncChar);
+
+        private:
+            const static uint8_t FRAME_BITS = 10;   // Start bit, 8 data bits, stop bit
+
+            // Limits in Timer1 counts (clock cycles). Nine bits at 9600 baud and 20MHz fit in the edge timeout
+            const static uint16_t START_WINDOW_CYCLES = 0x1000;    // Longest time interrupts are held off looking for a start bit
+            const static uint16_t EDGE_TIMEOUT_CYCLES = 0x8000;    // Longest time between edges of the sync character
+
+            /**
+             * Time one sync character on RXD, with interrupts off and Timer1 counting clock cycles
+             * @param   numEdges    Number of edges in the sync frame, including the start bit
+             * @return  Clock cycles from the start bit to the last edge, or 0 if no start bit came
+             *          within the window or an edge did not come in time
+             */
+            static uint16_t timeSyncFrame(uint8_t numEdges);
+    };
+
+    template <typename Usart>
+    BaudRate UsartAutobaud<Usart>::detect(uint32_t fCpu,
+                                          Timer::SoftwareTimer* pTimeoutTimer,
+                                          uint16_t timeoutMs,
+                                          uint8_t syncChar)
+    {
+        // Find the edges in the sync frame, and how many bits the last one is after the start bit
+        uint16_t frame = ((uint16_t)syncChar << 1) | (1 << (FRAME_BITS - 1));
+        uint8_t numEdges = 1;
+        uint8_t lastEdgeBit = 0;
+        for (uint8_t i=1; i<FRAME_BITS; i++)
+        {
+            if (((frame >> i) ^ (frame >> (i - 1))) & 0x01)
+            {
+                numEdges++;
+                lastEdgeBit = i;
+            }
+        }
+
+        bool useTimeout = (pTimeoutTimer != nullptr) && (timeoutMs != 0);
+
+        // Timer1's interrupts are masked while it is borrowed, a tic source on it would stop and
+        // the timeout would never pass
+        if (useTimeout && (TIMSK1 != 0))
+        {
+            assertCustom(false, "Autobaud timeout needs a tic source not on Timer1");
+            return BaudRate::NUM_BAUD_RATES;
+        }
+
+        if (useTimeout)
+        {
+            pTimeoutTimer->setPeriodMs(timeoutMs);
+            pTimeoutTimer->enable();
+        }
+
+        // Receiver off while timing, RXD is read as a plain input
+        Usart::ucsrb() &= ~((1 << RXCIE0) | (1 << RXEN0));
+
+        // Borrow Timer1, free running at the CPU clock. Its interrupts are masked so whatever
+        // owns it does not run at the wrong rate, and its count is put back afterwards
+        uint8_t sreg = SREG;
+        cli();
+        uint8_t timsk1 = TIMSK1;
+        uint8_t tccr1a = TCCR1A;
+        uint8_t tccr1b = TCCR1B;
+        uint16_t tcnt1 = TCNT1;
+        TIMSK1 = 0;
+        TCCR1A = 0;
+        TCCR1B = (1 << CS10);
+        SREG = sreg;
+
+        BaudRate baudRate = BaudRate::NUM_BAUD_RATES;
+        while (baudRate == BaudRate::NUM_BAUD_RATES)
+        {
+            if (useTimeout && pTimeoutTimer->hasOneShotPassed()) break;
+
+            // Polling with interrupts off keeps the edge timestamps within a few cycles
+            sreg = SREG;
+            cli();
+            uint16_t frameCycles = timeSyncFrame(numEdges);
+            SREG = sreg;
+
+            if (frameCycles == 0) continue;
+
+            uint32_t measuredBaud = ((fCpu * lastEdgeBit) + (frameCycles / 2)) / frameCycles;
+            baudRate = matchBaudRate(measuredBaud, fCpu);
+        }
+
+        // Stopped while it is put back, and flags raised at the borrowed rate are cleared by
+        // writing ones so they do not interrupt once unmasked
+        sreg = SREG;
+        cli();
+        TCCR1B = 0;
+        TCCR1A = tccr1a;
+        TCNT1 = tcnt1;
+        TIFR1 = (1 << ICF1) | (1 << OCF1B) | (1 << OCF1A) | (1 << TOV1);
+        TIMSK1 = timsk1;
+        TCCR1B = tccr1b;
+        SREG = sreg;
+
+        return baudRate;
+    }
+
+    template <typename Usart>
+    uint16_t UsartAutobaud<Usart>::timeSyncFrame(uint8_t numEdges)
+    {
+        uint16_t windowStart = TCNT1;
+
+        // Wait for the line to be high, so the falling edge found next starts a frame
+        while (!Usart::rxd())
+        {
+            if ((uint16_t)(TCNT1 - windowStart) > START_WINDOW_CYCLES) return 0;
+        }
+
+        while (Usart::rxd())
+        {
+            if ((uint16_t)(TCNT1 - windowStart) > START_WINDOW_CYCLES) return 0;
+        }
+
+        uint16_t frameStart = TCNT1;
+        uint16_t lastEdge = frameStart;
+        bool high = false;
+
+        for (uint8_t i=1; i<numEdges; i++)
+        {
+            while ((Usart::rxd() != 0) == high)
+            {
+                if ((uint16_t)(TCNT1 - lastEdge) > EDGE_TIMEOUT_CYCLES) return 0;
+            }
+
+            lastEdge = TCNT1;
+            high = !high;
+        }
+
+        return lastEdge - frameStart;
+    }
+}
+
+#endif
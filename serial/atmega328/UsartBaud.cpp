@@ -0,0 +1,53 @@
+#include "UsartBaud.hpp"
+#include "drivers/assert/Assert.hpp"
+
+namespace SerialComm
+{
+    const static uint32_t baudRates[] =
+    {
+        [BaudRate::BAUD_9600] = 9600,
+        [BaudRate::BAUD_115200] = 115200,
+        [BaudRate::BAUD_19200] = 19200,
+        [BaudRate::BAUD_38400] = 38400,
+        [BaudRate::BAUD_57600] = 57600,
+        [BaudRate::BAUD_250000] = 250000,
+        [BaudRate::BAUD_500000] = 500000,
+        [BaudRate::BAUD_1000000] = 1000000
+    };
+
+    BaudSettings calculateBaudSettings(BaudRate baudRate, uint32_t fCpu)
+    {
+        assertCustom(baudRate < BaudRate::NUM_BAUD_RATES);
+
+        uint32_t baud = baudRates[static_cast<uint8_t>(baudRate)];
+        assertCustom(baudError(fCpu, baud) <= DEFAULT_MAX_BAUD_ERROR, "Baud rate error too high");
+
+        return solveBaud(fCpu, baud);
+    }
+
+    BaudRate matchBaudRate(uint32_t measuredBaud, uint32_t fCpu)
+    {
+        BaudRate bestRate = BaudRate::NUM_BAUD_RATES;
+        uint32_t bestDiff = 0;
+
+        for (uint8_t i=0; i<BaudRate::NUM_BAUD_RATES; i++)
+        {
+            uint32_t baud = baudRates[i];
+            uint32_t diff = BaudSolver::absDiff(measuredBaud, baud);
+
+            if ((diff > ((baud / 100) * AUTOBAUD_MAX_ERROR) / 100) ||
+                (baudError(fCpu, baud) > DEFAULT_MAX_BAUD_ERROR))
+            {
+                continue;
+            }
+
+            if ((bestRate == BaudRate::NUM_BAUD_RATES) || (diff < bestDiff))
+            {
+                bestRate = static_cast<BaudRate>(i);
+                bestDiff = diff;
+            }
+        }
+
+        return bestRate;
+    }
+}
@@ -0,0 +1,148 @@
+/**
+ * Baud rate register selection for the Atmega USARTs
+ *
+ * Picks whichever of normal (16 clocks per bit) and double speed (8 clocks per bit) mode has the
+ * lowest error for a target baud rate, with UBRR rounded to the closest value rather than truncated.
+ * Everything is constexpr, so with UsartBaud the settings fold to constants and a baud rate that the
+ * clock cannot generate accurately enough fails to compile.
+ *
+ * Example:
+ *     uart.setBaudRate(UsartBaud<F_CPU, 1000000>::settings());
+ */
+#ifndef USART_BAUD_HPP
+#define USART_BAUD_HPP
+
+#include <stdint.h>
+#include "drivers/serial/ISerial.hpp"
+
+namespace SerialComm
+{
+    struct BaudSettings
+    {
+        uint16_t ubrr;      // Baud rate register value
+        bool doubleSpeed;   // True if the U2X bit must be set
+    };
+
+    const static uint32_t BAUD_DIVISOR = 16;        // Clock cycles per bit in normal mode
+    const static uint32_t DOUBLE_BAUD_DIVISOR = 8;  // Clock cycles per bit in double speed mode
+    const static uint16_t MAX_UBRR = 0x0FFF;        // Baud rate register is 12 bits
+
+    // Errors are in hundredths of a percent
+    const static uint16_t BAUD_ERROR_INVALID = 0xFFFF;  // Baud rate is out of range for the clock
+    // 115200 baud from a 16MHz clock is off by 2.12%, which works in practice
+    const static uint16_t DEFAULT_MAX_BAUD_ERROR = 250;
+
+    namespace BaudSolver
+    {
+        /**
+         * @return  Clock cycles per bit divided by divisor, rounded to the closest integer (UBRR + 1)
+         */
+        constexpr uint32_t clockDivider(uint32_t fCpu, uint32_t baud, uint32_t divisor)
+        {
+            return (fCpu + ((divisor * baud) / 2)) / (divisor * baud);
+        }
+
+        constexpr uint32_t absDiff(uint32_t a, uint32_t b)
+        {
+            return (a > b) ? (a - b) : (b - a);
+        }
+
+        /**
+         * @return  Error of the baud rate generated with divider, compared to the target
+         */
+        constexpr uint16_t error(uint32_t fCpu, uint32_t baud, uint32_t divisor, uint32_t divider)
+        {
+            return ((divider == 0) || (divider > (uint32_t)MAX_UBRR + 1)) ?
+                BAUD_ERROR_INVALID :
+                (uint16_t)(absDiff(fCpu, divisor * divider * baud) / ((divisor * divider * baud) / 10000));
+        }
+
+        constexpr uint16_t normalError(uint32_t fCpu, uint32_t baud)
+        {
+            return error(fCpu, baud, BAUD_DIVISOR, clockDivider(fCpu, baud, BAUD_DIVISOR));
+        }
+
+        constexpr uint16_t doubleSpeedError(uint32_t fCpu, uint32_t baud)
+        {
+            return error(fCpu, baud, DOUBLE_BAUD_DIVISOR, clockDivider(fCpu, baud, DOUBLE_BAUD_DIVISOR));
+        }
+
+        /**
+         * Normal mode samples each bit more times, so it wins ties
+         */
+        constexpr bool useDoubleSpeed(uint32_t fCpu, uint32_t baud)
+        {
+            return doubleSpeedError(fCpu, baud) < normalError(fCpu, baud);
+        }
+    }
+
+    /**
+     * Find the baud rate register settings with the lowest error
+     * @param   fCpu    Frequency of the processor's clock
+     * @param   baud    Target baud rate
+     * @return  Register settings, only meaningful if baudError is not BAUD_ERROR_INVALID
+     */
+    constexpr BaudSettings solveBaud(uint32_t fCpu, uint32_t baud)
+    {
+        return BaudSolver::useDoubleSpeed(fCpu, baud) ?
+            BaudSettings{(uint16_t)(BaudSolver::clockDivider(fCpu, baud, DOUBLE_BAUD_DIVISOR) - 1), true} :
+            BaudSettings{(uint16_t)(BaudSolver::clockDivider(fCpu, baud, BAUD_DIVISOR) - 1), false};
+    }
+
+    /**
+     * @param   fCpu    Frequency of the processor's clock
+     * @param   baud    Target baud rate
+     * @return  Error of the settings chosen by solveBaud, in hundredths of a percent
+     */
+    constexpr uint16_t baudError(uint32_t fCpu, uint32_t baud)
+    {
+        return BaudSolver::useDoubleSpeed(fCpu, baud) ?
+            BaudSolver::doubleSpeedError(fCpu, baud) :
+            BaudSolver::normalError(fCpu, baud);
+    }
+
+    /**
+     * Baud rate settings solved at compile time
+     * @param   F_CPU_HZ    Frequency of the processor's clock
+     * @param   BAUD        Target baud rate
+     * @param   MAX_ERROR   Largest error allowed, in hundredths of a percent
+     */
+    template <uint32_t F_CPU_HZ, uint32_t BAUD, uint16_t MAX_ERROR = DEFAULT_MAX_BAUD_ERROR>
+    struct UsartBaud
+    {
+        static_assert(baudError(F_CPU_HZ, BAUD) <= MAX_ERROR, "Baud rate cannot be generated accurately enough from this clock");
+
+        static constexpr uint16_t ubrr = solveBaud(F_CPU_HZ, BAUD).ubrr;
+        static constexpr bool doubleSpeed = solveBaud(F_CPU_HZ, BAUD).doubleSpeed;
+        static constexpr uint16_t error = baudError(F_CPU_HZ, BAUD);
+
+        static constexpr BaudSettings settings()
+        {
+            return BaudSettings{ubrr, doubleSpeed};
+        }
+    };
+
+    /**
+     * Find the baud rate register settings for one of the standard baud rates at run time
+     * Asserts if the error is above DEFAULT_MAX_BAUD_ERROR
+     * @param   baudRate    UART transmission rate
+     * @param   fCpu        Frequency of the processor's clock
+     * @return  Register settings
+     */
+    BaudSettings calculateBaudSettings(BaudRate baudRate, uint32_t fCpu);
+
+    // Largest difference between a measured rate and the standard rate it is matched to,
+    // in hundredths of a percent. The standard rates are at least 1.5 times apart
+    const static uint16_t AUTOBAUD_MAX_ERROR = 500;
+
+    /**
+     * Find the standard baud rate closest to a measured one, for autobaud
+     * @param   measuredBaud    Baud rate timed on the line
+     * @param   fCpu            Frequency of the processor's clock
+     * @return  The closest rate within AUTOBAUD_MAX_ERROR that the clock can generate, or
+     *          NUM_BAUD_RATES if there is none
+     */
+    BaudRate matchBaudRate(uint32_t measuredBaud, uint32_t fCpu);
+}
+
+#endif
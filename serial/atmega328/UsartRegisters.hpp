@@ -0,0 +1,50 @@
+/**
+ * Register sets for each USART on the part being compiled for
+ *
+ * Used as template parameters by the USART drivers, so that each register access compiles to a
+ * direct load or store instead of going through a pointer. Only the USARTs that exist on the
+ * target are defined, e.g. Usart0 on the ATmega328P, Usart0-1 on the ATmega328PB and Usart0-3 on
+ * the ATmega2560. Bit positions are the same for every USART, so drivers use the USART0 names.
+ */
+#ifndef USART_REGISTERS_HPP
+#define USART_REGISTERS_HPP
+
+#include <avr/io.h>
+
+// Register is volatile uint8_t& on the part, and the register object in the host simulation
+#define DEFINE_USART_REGISTERS(n, rxdPin, rxdBit)                   \
+    struct Usart##n                                                 \
+    {                                                               \
+        typedef decltype((UDR##n)) Register;                        \
+        static Register udr()   { return UDR##n; }                  \
+        static Register ucsra() { return UCSR##n##A; }              \
+        static Register ucsrb() { return UCSR##n##B; }              \
+        static Register ucsrc() { return UCSR##n##C; }              \
+        static Register ubrrh() { return UBRR##n##H; }              \
+        static Register ubrrl() { return UBRR##n##L; }              \
+        static uint8_t rxd()    { return rxdPin & (1 << rxdBit); }  \
+    };
+
+namespace SerialComm
+{
+#if defined(PINJ)
+    // ATmega640/1280/2560, RXD0-3 are PE0, PD2, PH0 and PJ0
+    DEFINE_USART_REGISTERS(0, PINE, PINE0)
+    DEFINE_USART_REGISTERS(1, PIND, PIND2)
+    DEFINE_USART_REGISTERS(2, PINH, PINH0)
+    DEFINE_USART_REGISTERS(3, PINJ, PINJ0)
+#else
+    // ATmega328P and ATmega328PB, RXD0 is PD0 and RXD1 is PB4
+#ifdef UDR0
+    DEFINE_USART_REGISTERS(0, PIND, PIND0)
+#endif
+
+#ifdef UDR1
+    DEFINE_USART_REGISTERS(1, PINB, PINB4)
+#endif
+#endif
+}
+
+#undef DEFINE_USART_REGISTERS
+
+#endif
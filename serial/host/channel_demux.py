@@ -0,0 +1,65 @@
+#!/usr/bin/env python3
+"""
+Host side of SerialComm::ChannelMux.
+
+Each frame is a PacketSerial packet whose first byte is the channel ID, followed by the channel's
+data. Running the script splits a capture or a live port into its channels and prints each
+channel's data prefixed by its ID:
+    channel_demux.py < capture.bin
+    channel_demux.py --port /dev/ttyUSB0 --baud 115200     (needs pyserial)
+"""
+
+import argparse
+import os
+import sys
+
+sys.path.insert(0, os.path.dirname(os.path.abspath(__file__)))
+import packet_serial  # noqa: E402
+
+MAX_FRAME_DATA = 32     # MUX_MAX_FRAME_DATA, the device does not need it but keeps frames short
+
+
+def encode_frame(channel, data):
+    """Encode data for a channel on the device, splitting it into frames"""
+    out = bytearray()
+    for start in range(0, len(data), MAX_FRAME_DATA):
+        out += packet_serial.encode_packet(bytes((channel,)) + bytes(data[start:start + MAX_FRAME_DATA]))
+    return bytes(out)
+
+
+class ChannelDemux:
+    """Collects a byte stream and yields (channel, data) for each frame in it"""
+
+    def __init__(self):
+        self.decoder = packet_serial.PacketDecoder()
+
+    def feed(self, data):
+        for frame in self.decoder.feed(data):
+            if frame:
+                yield frame[0], frame[1:]
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", help="serial port to read, stdin if not given")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+        read = lambda: stream.read(stream.in_waiting or 1)
+    else:
+        read = lambda: sys.stdin.buffer.read1(4096)
+
+    demux = ChannelDemux()
+    while True:
+        data = read()
+        if not data:
+            break
+        for channel, payload in demux.feed(data):
+            print("[%d] %s" % (channel, payload.decode("ascii", "backslashreplace")), flush=True)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,125 @@
+#!/usr/bin/env python3
+"""
+Host side of SerialComm::PacketSerial.
+
+Packets are the payload followed by its CRC-16 (reflected 0xA001, initial 0xFFFF, low byte
+first), COBS encoded and ended with a zero byte.
+
+Usage as a script decodes packets from a byte stream and prints them as hex:
+    packet_serial.py < capture.bin
+    packet_serial.py --port /dev/ttyUSB0 --baud 115200     (needs pyserial)
+"""
+
+import argparse
+import sys
+
+DELIMITER = 0x00
+COBS_MAX_CODE = 0xFF
+
+
+def crc16(data, crc=0xFFFF):
+    for byte in data:
+        crc ^= byte
+        for _ in range(8):
+            crc = (crc >> 1) ^ 0xA001 if crc & 1 else crc >> 1
+    return crc
+
+
+def cobs_encode(data):
+    out = bytearray()
+    index = 0
+    while True:
+        run = 0
+        while index + run < len(data) and run < COBS_MAX_CODE - 1 and data[index + run] != 0:
+            run += 1
+        out.append(run + 1)
+        out += data[index:index + run]
+        index += run
+        if index >= len(data):
+            break
+        if run < COBS_MAX_CODE - 1:
+            index += 1
+    return bytes(out)
+
+
+def cobs_decode(data):
+    out = bytearray()
+    index = 0
+    while index < len(data):
+        code = data[index]
+        if code == 0 or index + code > len(data):
+            raise ValueError("invalid COBS encoding")
+        out += data[index + 1:index + code]
+        index += code
+        if code != COBS_MAX_CODE and index < len(data):
+            out.append(0)
+    return bytes(out)
+
+
+def encode_packet(payload):
+    crc = crc16(payload)
+    return cobs_encode(bytes(payload) + bytes((crc & 0xFF, crc >> 8))) + bytes((DELIMITER,))
+
+
+def decode_packet(encoded):
+    """Decode one packet, without its delimiter. Raises ValueError if it is invalid"""
+    data = cobs_decode(encoded)
+    if len(data) < 2:
+        raise ValueError("packet too short")
+    payload, received = data[:-2], data[-2] | (data[-1] << 8)
+    if crc16(payload) != received:
+        raise ValueError("CRC mismatch")
+    return payload
+
+
+class PacketDecoder:
+    """Collects a byte stream and yields each valid payload in it"""
+
+    def __init__(self):
+        self.pending = bytearray()
+        self.crc_errors = 0
+        self.framing_errors = 0
+
+    def feed(self, data):
+        for byte in data:
+            if byte != DELIMITER:
+                self.pending.append(byte)
+                continue
+            encoded, self.pending = bytes(self.pending), bytearray()
+            if not encoded:
+                continue
+            try:
+                yield decode_packet(encoded)
+            except ValueError as error:
+                if "CRC" in str(error):
+                    self.crc_errors += 1
+                else:
+                    self.framing_errors += 1
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", help="serial port to read, stdin if not given")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    if args.port:
+        import serial
+        stream = serial.Serial(args.port, args.baud)
+        read = lambda: stream.read(stream.in_waiting or 1)
+    else:
+        read = lambda: sys.stdin.buffer.read1(4096)
+
+    decoder = PacketDecoder()
+    while True:
+        data = read()
+        if not data:
+            break
+        for payload in decoder.feed(data):
+            print(payload.hex(" "))
+
+    print("CRC errors: %d, framing errors: %d" % (decoder.crc_errors, decoder.framing_errors), file=sys.stderr)
+
+
+if __name__ == "__main__":
+    main()
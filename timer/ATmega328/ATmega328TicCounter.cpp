@@ -0,0 +1,33 @@
+#include "ATmega328TicCounter.hpp"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+using namespace Timer;
+
+namespace Tic
+{
+    Atmega328TicCounter::Atmega328TicCounter(Atmega328Timer* pTicTimer):
+        TicCounter(pTicTimer->getCountRate() / ((uint32_t)pTicTimer->getTop() + 1)),
+        pTicTimer_(pTicTimer),
+        halfTicCounts_(((uint32_t)pTicTimer->getTop() + 1) / 2),
+        ticMicrosQ8_(((256ul * 1000000ul) / pTicTimer->getCountRate()) * ((uint32_t)pTicTimer->getTop() + 1)),
+        microsPerCountQ8_((256ul * 1000000ul) / pTicTimer->getCountRate())
+    {}
+
+    uint32_t Atmega328TicCounter::nowMicros()
+    {
+        uint8_t sreg = SREG;
+        cli();
+
+        uint32_t tics = ticCount_;
+        uint16_t count = pTicTimer_->getCount();
+
+        // A match since interrupts went off has not been counted yet. If the count was read after
+        // it, the count has restarted from 0 and the tic is missing
+        if (pTicTimer_->isCompareAPending() && (count < halfTicCounts_)) tics++;
+
+        SREG = sreg;
+
+        return scaleQ8(tics, ticMicrosQ8_) + (((uint32_t)count * microsPerCountQ8_) >> 8);
+    }
+}
@@ -0,0 +1,40 @@
+/**
+ * Tic counter driven by an Atmega328Timer's compare A interrupt, that can also time within a tic
+ *
+ * The timer interrupt must call incrementTicCount(). nowMicros() adds the timer's live count to
+ * the tic count, so its resolution is one timer count rather than one tic.
+ */
+#ifndef ATMEGA328_TIC_COUNTER_HPP
+#define ATMEGA328_TIC_COUNTER_HPP
+
+#include "drivers/timer/TicCounter.hpp"
+#include "drivers/timer/ATmega328/ATmega328Timer.hpp"
+
+namespace Tic
+{
+    class Atmega328TicCounter : public TicCounter
+    {
+        public:
+            /**
+             * Constructor
+             * @param   pTicTimer   Timer in CTC mode whose compare A interrupt increments the tic count,
+             *                      one tic every top + 1 counts
+             */
+            Atmega328TicCounter(Timer::Atmega328Timer* pTicTimer);
+            ~Atmega328TicCounter(){}
+
+            /**
+             * @return  Microseconds since the tic count started, to within one timer count. The
+             *          tic count and timer count are read together with interrupts off
+             */
+            uint32_t nowMicros() override;
+
+        private:
+            Timer::Atmega328Timer* pTicTimer_;
+            uint16_t halfTicCounts_;        // Counts in half a tic, to tell which side of a wrap TCNT was read on
+            uint32_t ticMicrosQ8_;          // Microseconds per tic, times 256, from the count rate so tics and counts line up
+            uint32_t microsPerCountQ8_;     // Microseconds per timer count, times 256
+    };
+}
+
+#endif
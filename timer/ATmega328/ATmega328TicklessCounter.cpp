@@ -0,0 +1,200 @@
+#include "ATmega328TicklessCounter.hpp"
+#include "drivers/assert/Assert.hpp"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+
+using namespace Timer;
+
+namespace Tic
+{
+    // Timer1 clock select bits for each prescaler, 0 if Timer1 does not support it
+    const static uint8_t CLOCK_SELECT[] =
+    {
+        [PRESCALE_OFF] = 0,
+        [PRESCALE_1] = 1,
+        [PRESCALE_8] = 2,
+        [PRESCALE_32] = 0,
+        [PRESCALE_64] = 3,
+        [PRESCALE_128] = 0,
+        [PRESCALE_256] = 4,
+        [PRESCALE_1024] = 5,
+        [EXTERNAL_FALLING] = 0,
+        [EXTERNAL_RISING] = 0,
+    };
+
+    const static uint16_t PRESCALE_DIVISOR[] =
+    {
+        [PRESCALE_OFF] = 0,
+        [PRESCALE_1] = 1,
+        [PRESCALE_8] = 8,
+        [PRESCALE_32] = 32,
+        [PRESCALE_64] = 64,
+        [PRESCALE_128] = 128,
+        [PRESCALE_256] = 256,
+        [PRESCALE_1024] = 1024,
+        [EXTERNAL_FALLING] = 0,
+        [EXTERNAL_RISING] = 0,
+    };
+
+    Atmega328TicklessCounter* Atmega328TicklessCounter::pInstance_ = nullptr;
+
+    Atmega328TicklessCounter::Atmega328TicklessCounter(uint32_t fCpu, TimerPrescaler prescaler):
+        TicCounter(fCpu / PRESCALE_DIVISOR[prescaler]),
+        clockSelect_(CLOCK_SELECT[prescaler]),
+        overflows_(0),
+        deadlineTic_(0),
+        deadlineArmed_(false),
+        deadlinePassed_(false),
+        wakeTic_(0),
+        wakeArmed_(false),
+        compareOverflows_(0)
+    {
+        assertCustom(clockSelect_ != 0, "Prescaler not supported by Timer1");
+
+        // Only one instance can own the Timer1 interrupts
+        assertCustom(Atmega328TicklessCounter::pInstance_ == nullptr);
+        Atmega328TicklessCounter::pInstance_ = this;
+    }
+
+    void Atmega328TicklessCounter::initialize()
+    {
+        // Normal mode, counting up through 0xFFFF and overflowing to 0
+        TCCR1A = 0;
+        TCCR1B = 0;
+        TCNT1 = 0;
+
+        // Clear stale flags by writing ones, then interrupt on each overflow
+        TIFR1 = (1 << TOV1) | (1 << OCF1B);
+        TIMSK1 = (1 << TOIE1);
+
+        TCCR1B = clockSelect_;
+    }
+
+    volatile uint32_t Atmega328TicklessCounter::getTicCount()
+    {
+        uint8_t sreg = SREG;
+        cli();
+
+        uint16_t overflows = overflows_;
+        uint16_t count = TCNT1;
+
+        // Timer may have overflowed since interrupts went off, if so the count has wrapped but
+        // overflows_ has not been incremented yet
+        if ((TIFR1 & (1 << TOV1)) && (count < 0x8000)) overflows++;
+
+        SREG = sreg;
+        return ((uint32_t)overflows << 16) | count;
+    }
+
+    void Atmega328TicklessCounter::setDeadline(uint32_t tic)
+    {
+        uint8_t sreg = SREG;
+        cli();
+
+        deadlineTic_ = tic;
+        deadlineArmed_ = true;
+        deadlinePassed_ = false;
+        rearm();
+
+        SREG = sreg;
+    }
+
+    void Atmega328TicklessCounter::clearDeadline()
+    {
+        uint8_t sreg = SREG;
+        cli();
+
+        deadlineArmed_ = false;
+        deadlinePassed_ = false;
+        rearm();
+
+        SREG = sreg;
+    }
+
+    void Atmega328TicklessCounter::wakeAtTic(uint32_t tic)
+    {
+        uint8_t sreg = SREG;
+        cli();
+
+        wakeTic_ = tic;
+        wakeArmed_ = true;
+        rearm();
+
+        SREG = sreg;
+    }
+
+    void Atmega328TicklessCounter::rearm()
+    {
+        TIMSK1 &= ~(1 << OCIE1B);
+
+        // Each pass retires at least one tic, when the compare was set too late to match
+        while (true)
+        {
+            uint32_t now = getTicCount();
+            if (deadlineArmed_ && ((int32_t)(deadlineTic_ - now) <= 0))
+            {
+                deadlineArmed_ = false;
+                deadlinePassed_ = true;
+            }
+            if (wakeArmed_ && ((int32_t)(wakeTic_ - now) <= 0)) wakeArmed_ = false;
+
+            if (!deadlineArmed_ && !wakeArmed_) return;
+
+            uint32_t tic = deadlineTic_;
+            if (!deadlineArmed_ || (wakeArmed_ && ((int32_t)(wakeTic_ - deadlineTic_) < 0))) tic = wakeTic_;
+
+            compareOverflows_ = (uint16_t)(tic >> 16);
+            OCR1B = (uint16_t)tic;
+
+            // In a later overflow period, the overflow interrupt arms it once that period starts
+            if (compareOverflows_ != (uint16_t)(now >> 16)) return;
+            if (armCompare()) return;
+        }
+    }
+
+    bool Atmega328TicklessCounter::armCompare()
+    {
+        // Clear a stale match by writing a one, then wait for the next one
+        TIFR1 = (1 << OCF1B);
+        TIMSK1 |= (1 << OCIE1B);
+
+        // Compare only matches on the exact count, if it went past while arming, it will not match
+        if (TCNT1 >= OCR1B)
+        {
+            TIMSK1 &= ~(1 << OCIE1B);
+            return false;
+        }
+
+        return true;
+    }
+
+    void Atmega328TicklessCounter::HandleOverflow()
+    {
+        Atmega328TicklessCounter* pCounter = Atmega328TicklessCounter::pInstance_;
+        pCounter->overflows_++;
+
+        // Already armed if it was set in this period just before the overflow was counted
+        if ((pCounter->deadlineArmed_ || pCounter->wakeArmed_) &&
+            !(TIMSK1 & (1 << OCIE1B)) &&
+            (pCounter->overflows_ == pCounter->compareOverflows_))
+        {
+            if (!pCounter->armCompare()) pCounter->rearm();
+        }
+    }
+
+    void Atmega328TicklessCounter::HandleDeadline()
+    {
+        // Retires whichever tic was reached, and sets compare B for the other if it is still to come
+        Atmega328TicklessCounter::pInstance_->rearm();
+    }
+
+    ISR(TIMER1_OVF_vect)
+    {
+        Atmega328TicklessCounter::HandleOverflow();
+    }
+
+    ISR(TIMER1_COMPB_vect)
+    {
+        Atmega328TicklessCounter::HandleDeadline();
+    }
+}
@@ -0,0 +1,115 @@
+/**
+ * Tic counter kept by Timer1 instead of a periodic interrupt
+ *
+ * Timer1 counts freely, and the tic count is its overflow count in the high 16 bits and TCNT1 in
+ * the low 16 bits, so there is one interrupt per 65536 tics rather than one per tic. To wake up for
+ * the next piece of work, program its tic as a deadline, compare B interrupts when it is reached:
+ *
+ *     uint32_t nextTic;
+ *     if (wheel.getNextEventTic(&nextTic)) ticCounter.setDeadline(nextTic);
+ *
+ *     cli();
+ *     if (!ticCounter.hasDeadlinePassed())
+ *     {
+ *         set_sleep_mode(SLEEP_MODE_IDLE);
+ *         sleep_enable();
+ *         sei();
+ *         sleep_cpu();
+ *         sleep_disable();
+ *     }
+ *     sei();
+ *     wheel.dispatch();
+ *
+ * Timer1 keeps running in idle sleep only. This takes over Timer1 and its overflow and compare B
+ * interrupts, so it cannot be combined with an Atmega328Timer on Timer1.
+ */
+#ifndef ATMEGA328_TICKLESS_COUNTER_HPP
+#define ATMEGA328_TICKLESS_COUNTER_HPP
+
+#include "drivers/timer/TicCounter.hpp"
+#include "drivers/timer/ITimer.hpp"
+
+namespace Tic
+{
+    class Atmega328TicklessCounter : public TicCounter
+    {
+        public:
+            /**
+             * Constructor, only one may exist
+             * @param   fCpu        Frequency of the processor's clock
+             * @param   prescaler   Timer1 prescaler, 1, 8, 64, 256 or 1024. The tic rate is fCpu
+             *                      divided by it
+             */
+            Atmega328TicklessCounter(uint32_t fCpu, Timer::TimerPrescaler prescaler);
+            ~Atmega328TicklessCounter(){}
+
+            /**
+             * Start Timer1 counting, must be done after static initialization
+             */
+            void initialize();
+
+            /**
+             * @return  Tics since initialize(), read with interrupts off so it cannot tear
+             */
+            volatile uint32_t getTicCount() override;
+
+            /**
+             * Interrupt at a tic, replacing any earlier deadline
+             * @param   tic     Tic to interrupt at, if it has already passed hasDeadlinePassed is set now
+             */
+            void setDeadline(uint32_t tic);
+
+            /**
+             * Stop waiting for the deadline
+             */
+            void clearDeadline();
+
+            /**
+             * @return  True once the deadline's tic has been reached
+             */
+            bool hasDeadlinePassed() { return deadlinePassed_; }
+
+            /**
+             * Interrupt at a tic as well as at the deadline, replacing any earlier wake tic. The
+             * deadline is kept, compare B is set for whichever of the two comes first
+             */
+            void wakeAtTic(uint32_t tic) override;
+
+            /**
+             * Timer1 overflow interrupt handler
+             */
+            static void HandleOverflow();
+
+            /**
+             * Timer1 compare B interrupt handler
+             */
+            static void HandleDeadline();
+
+        private:
+            uint8_t clockSelect_;               // Timer1 clock select bits for the prescaler
+            volatile uint16_t overflows_;       // High 16 bits of the tic count
+            volatile uint32_t deadlineTic_;
+            volatile bool deadlineArmed_;       // True while waiting for the deadline
+            volatile bool deadlinePassed_;      // True once the deadline has been reached
+            volatile uint32_t wakeTic_;
+            volatile bool wakeArmed_;           // True while waiting for the wake tic
+            volatile uint16_t compareOverflows_;    // High 16 bits of the tic compare B is for, it matches the low bits
+
+            /**
+             * Retire the deadline and wake tic if they have passed, then set compare B for the
+             * earlier of those left. Interrupts must be off
+             */
+            void rearm();
+
+            /**
+             * Enable the compare B interrupt in this overflow period. Interrupts must be off
+             * @return  False if the count is already beyond OCR1B, so it will not match
+             */
+            bool armCompare();
+
+            // Static copy for use in interrupt handling
+            static Atmega328TicklessCounter* pInstance_;
+    };
+}
+
+#endif
@@ -26,9 +26,17 @@ namespace Timer{
         [TIMER_2] = &TIMSK2
     };
 
+    static volatile uint8_t* TIM_FLAG_REG[] =
+    {
+        [TIMER_0] = &TIFR0,
+        [TIMER_1] = &TIFR1,
+        [TIMER_2] = &TIFR2
+    };
+
     const static uint8_t CTC_VALUE = (0x01 << 1);
     const static uint8_t CTC_VALUE_TIM1 = (0x01 << 3);
     const static uint8_t COMP_A_INTERRUPT_VAL = (0x01 << 1);
+    const static uint8_t COMP_A_FLAG_VAL = (0x01 << 1);
 
     const static uint8_t PRESCALE_VALUE[] = 
     {
@@ -182,6 +190,7 @@ namespace Timer{
 
                 // Set the compare A top value (16 bit)
                 OCR1A = top_;
+                break;
             }
 
             default:
@@ -232,6 +241,9 @@ namespace Timer{
 
     void Atmega328Timer::enableCompAInterrupt(Timer timer)
     {
+        // The counter keeps matching while the interrupt is off, clear a stale match (by writing
+        // a one) so it does not fire as soon as it is enabled
+        *TIM_FLAG_REG[timer] = COMP_A_FLAG_VAL;
         *TIM_INTERRUPT_REG[timer] |= COMP_A_INTERRUPT_VAL;
     }
 
@@ -262,6 +274,12 @@ namespace Timer{
         setTop(tics);
     }
 
+    uint16_t Atmega328Timer::getMaxPeriodTics()
+    {
+        // Timer1 is 16 bit, Timers 0 and 2 are 8 bit
+        return (timer_ == TIMER_1) ? 0xFFFF : 0xFF;
+    }
+
     uint16_t Atmega328Timer::microSecondsToTics(uint32_t microseconds)
     {
         uint32_t divisor = (uint32_t)PRESCALE_INT[prescaler_] * (uint32_t)(1000000 / microseconds);
@@ -289,6 +307,32 @@ namespace Timer{
         }
     }
 
+    uint16_t Atmega328Timer::getCount()
+    {
+        switch (timer_)
+        {
+            case TIMER_0:
+                return TCNT0;
+
+            case TIMER_1:
+                return TCNT1;
+
+            default:
+            case TIMER_2:
+                return TCNT2;
+        }
+    }
+
+    bool Atmega328Timer::isCompareAPending()
+    {
+        return (*TIM_FLAG_REG[timer_] & COMP_A_FLAG_VAL) != 0;
+    }
+
+    uint32_t Atmega328Timer::getCountRate()
+    {
+        return F_CPU / PRESCALE_INT[prescaler_];
+    }
+
     ISR(TIMER0_COMPA_vect){
         if (Timer0CompareAInterrupt != nullptr)
         {
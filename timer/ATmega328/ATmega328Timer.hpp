@@ -40,6 +40,7 @@ namespace Timer
             void initialize();
 
             void setPeriodTics(uint16_t tics) override;
+            uint16_t getMaxPeriodTics() override;
             uint16_t microSecondsToTics(uint32_t microseconds) override;
             void reset() override;
 
@@ -47,6 +48,23 @@ namespace Timer
             void disable() override;
             void setInterrupt(void (*interrupt)(void)) override;
 
+            /**
+             * @return  Current count of the timer, TCNTn
+             */
+            uint16_t getCount();
+
+            /**
+             * @return  True if a compare A match is waiting for its interrupt
+             */
+            bool isCompareAPending();
+
+            /**
+             * @return  Counts per second, the CPU clock divided by the prescaler
+             */
+            uint32_t getCountRate();
+
+            uint16_t getTop() { return top_; }
+
         private:
             Timer timer_;
             TimerMode mode_;
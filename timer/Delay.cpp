@@ -1,9 +1,15 @@
 #include "Delay.hpp"
 #include "drivers/assert/Assert.hpp"
 #include "utilities/print/Print.hpp"
+#include <avr/io.h>
+#include <avr/interrupt.h>
+#include <avr/sleep.h>
 
 Tic::TicCounter* Delay::pTicCounter_ = nullptr;
 Watchdog::IWatchdog* Delay::pWdt_ = nullptr;
+uint8_t Delay::sleepMode_ = Delay::SLEEP_OFF;
+void (*Delay::yield_)(void) = nullptr;
+bool Delay::isYielding_ = false;
 
 void Delay::Initialize(Tic::TicCounter* pTicCounter, Watchdog::IWatchdog* pWdt)
 {
@@ -19,32 +25,71 @@ void Delay::delay(uint32_t milliseconds)
         return;
     }
 
-	uint32_t ticsTimesMilliseconds = milliseconds * Delay::pTicCounter_->getTicsPerSecond();
-    float ticsToDelay = ticsTimesMilliseconds / 1000;
+    // Round up, so the delay is never short
+    uint32_t ticsToDelay = Delay::pTicCounter_->toTicsRoundUp(Tic::Milliseconds(milliseconds)).count;
 
-	// Round up 
-	if (ticsTimesMilliseconds % 1000) ticsToDelay += 1;
+    // Sleeps are cut short to pet the watchdog, with half its timeout as margin for its clock
+    uint32_t wdtTics = ticsToDelay;
+    if (Delay::pWdt_ != nullptr)
+    {
+        wdtTics = Delay::pTicCounter_->toTics(Tic::Milliseconds(Delay::pWdt_->getTimeoutMs() / 2)).count;
+        if (wdtTics == 0) wdtTics = 1;
+    }
 
     uint32_t startTic = Delay::pTicCounter_->getTicCount();
-
-    volatile uint32_t currentTic = startTic;
-    while (true)
+    uint32_t elapsedTics;
+    while ((elapsedTics = Delay::pTicCounter_->getTicCount() - startTic) < ticsToDelay)
     {
-        currentTic = Delay::pTicCounter_->getTicCount();
-        if (currentTic - startTic >= ticsToDelay)
+        if (pWdt_ != nullptr)
         {
-            break;
+            Delay::pWdt_->reset();
         }
 
-        if (pWdt_ != nullptr)
+        if ((Delay::yield_ != nullptr) && !Delay::isYielding_)
         {
-            Delay::pWdt_->reset();
+            Delay::isYielding_ = true;
+            Delay::yield_();
+            Delay::isYielding_ = false;
         }
+
+        uint32_t wakeTics = ticsToDelay;
+        if (ticsToDelay - elapsedTics > wdtTics) wakeTics = elapsedTics + wdtTics;
+
+        if (Delay::sleepMode_ != SLEEP_OFF)
+        {
+            // A tickless counter has to be told when to interrupt, its own deadline is kept
+            Delay::pTicCounter_->wakeAtTic(startTic + wakeTics);
+        }
+
+        Delay::sleep(startTic, wakeTics);
     }
 
     return;
 }
 
+void Delay::sleep(uint32_t startTic, uint32_t wakeTics)
+{
+    // Nothing can wake the CPU with interrupts off, spin instead
+    uint8_t sreg = SREG;
+    if ((Delay::sleepMode_ == SLEEP_OFF) || !(sreg & (1 << SREG_I))) return;
+
+    // Check with interrupts off, so the wake up cannot come between the check and sleeping
+    cli();
+    if ((Delay::pTicCounter_->getTicCount() - startTic) < wakeTics)
+    {
+        set_sleep_mode(Delay::sleepMode_);
+        sleep_enable();
+
+        // Interrupts are not taken until after the instruction following sei, so the CPU is
+        // asleep before the tic interrupt can run
+        sei();
+        sleep_cpu();
+        sleep_disable();
+    }
+
+    SREG = sreg;
+}
+
 
 // Taken from the arduino library
 void Delay::delayMicroseconds(uint32_t us)
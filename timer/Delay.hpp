@@ -7,9 +7,23 @@
 #define DELAY(x) Delay::delay(x)
 #define DELAY_MICROSECONDS(x) Delay::delayMicroseconds(x)
 
+/**
+ * Blocking delays off a tic counter
+ *
+ * delay() spins on the tic count by default. With a sleep mode set by setSleepMode() it sleeps
+ * between interrupts instead, waking on each tic to check the time. The tic counter's interrupt
+ * must then be able to wake the CPU from the sleep mode: idle works with any timer, power-save only
+ * with Timer2 clocked asynchronously from a watch crystal. A tickless tic counter is told to wake
+ * at the end of the delay, which keeps any deadline already set. With a watchdog, the CPU also
+ * wakes every half watchdog timeout to pet it.
+ *
+ * A yield function set with setYield() runs each time the CPU wakes, so other work can go on
+ * during long delays. The delay ends late if it runs past the end, and delays it calls do not yield.
+ */
 class Delay
 {
     public:
+        const static uint8_t SLEEP_OFF = 0xFF;  // Spin instead of sleeping
 
         /**
          * Initialize the delay function with a pointer to a tic counter
@@ -24,11 +38,38 @@ class Delay
          * @param   milliseconds    Delay duration in milliseconds
          */
         static void delay(uint32_t milliseconds);
+        static void delay(Tic::Milliseconds duration) { delay(duration.count); }
         static void delayMicroseconds(uint32_t microseconds);
 
+        /**
+         * Set how delay() waits between tics, SLEEP_OFF by default. Sleeping saves power, but
+         * only if the tic counter's interrupt can wake the CPU from the mode
+         *
+         * @param   sleepMode   An avr/sleep.h SLEEP_MODE_, or SLEEP_OFF to spin
+         */
+        static void setSleepMode(uint8_t sleepMode) { Delay::sleepMode_ = sleepMode; }
+
+        /**
+         * Set a function to run each time delay() wakes
+         *
+         * @param   yield   Function to run, nullptr for none
+         */
+        static void setYield(void (*yield)(void)) { Delay::yield_ = yield; }
+
     private:
         static Tic::TicCounter* pTicCounter_;
         static Watchdog::IWatchdog* pWdt_;
+        static uint8_t sleepMode_;
+        static void (*yield_)(void);
+        static bool isYielding_;        // True while the yield function runs, so a delay in it does not yield again
+
+        /**
+         * Sleep until the next interrupt, unless the tic to wake at has already been reached
+         *
+         * @param   startTic    Tic the delay started on
+         * @param   wakeTics    Tics after startTic to wake at
+         */
+        static void sleep(uint32_t startTic, uint32_t wakeTics);
 };
 
 #endif
\ No newline at end of file
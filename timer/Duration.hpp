@@ -0,0 +1,125 @@
+/**
+ * Typed durations, and conversions between them and tics
+ *
+ * Conversions scale by a reduced fraction (e.g. 250000 tics per second is 250 tics per
+ * millisecond, so no division at all), split so the intermediate product cannot overflow. With the
+ * tic rate known at compile time they fold to constants:
+ *
+ *     typedef Tic::TicRate<1000> AppTicRate;
+ *     timer.setPeriod(AppTicRate::toTics(Tic::Milliseconds(500)));
+ *
+ * A TicCounter does the same conversions at run time, with the fractions worked out once.
+ */
+#ifndef DURATION_HPP
+#define DURATION_HPP
+
+#include <stdint.h>
+
+namespace Tic
+{
+    struct Tics
+    {
+        uint32_t count;
+        constexpr explicit Tics(uint32_t c): count(c) {}
+    };
+
+    struct Microseconds
+    {
+        uint32_t count;
+        constexpr explicit Microseconds(uint32_t c): count(c) {}
+    };
+
+    struct Milliseconds
+    {
+        uint32_t count;
+        constexpr explicit Milliseconds(uint32_t c): count(c) {}
+    };
+
+    struct Seconds
+    {
+        uint32_t count;
+        constexpr explicit Seconds(uint32_t c): count(c) {}
+    };
+
+    namespace DurationMath
+    {
+        constexpr uint32_t gcd(uint32_t a, uint32_t b)
+        {
+            return (b == 0) ? a : gcd(b, a % b);
+        }
+
+        /**
+         * @return  True if (value % den) * num fits in 32 bits for any value
+         */
+        constexpr bool splitFits(uint32_t num, uint32_t den)
+        {
+            return ((uint64_t)(den - 1) * num) <= 0xFFFFFFFFull;
+        }
+
+        /**
+         * @return  value * num / den rounded down, wrapping like the full product would. Only
+         *          falls back to a 64-bit product for fractions that do not reduce well
+         */
+        constexpr uint32_t scale(uint32_t value, uint32_t num, uint32_t den)
+        {
+            return (den == 1) ? (value * num) :
+                   splitFits(num, den) ? (((value / den) * num) + (((value % den) * num) / den)) :
+                   (uint32_t)(((uint64_t)value * num) / den);
+        }
+
+        /**
+         * @return  value * num / den rounded up
+         */
+        constexpr uint32_t scaleUp(uint32_t value, uint32_t num, uint32_t den)
+        {
+            return scale(value, num, den) +
+                   ((den == 1) ? 0 :
+                    splitFits(num, den) ? ((((value % den) * num) % den) != 0) :
+                    ((((uint64_t)value * num) % den) != 0));
+        }
+    }
+
+    /**
+     * Multiply by num / den, kept reduced
+     */
+    struct Ratio
+    {
+        uint32_t num;
+        uint32_t den;
+
+        constexpr uint32_t apply(uint32_t value) const { return DurationMath::scale(value, num, den); }
+        constexpr uint32_t applyUp(uint32_t value) const { return DurationMath::scaleUp(value, num, den); }
+    };
+
+    constexpr Ratio makeRatio(uint32_t num, uint32_t den)
+    {
+        return Ratio{ num / DurationMath::gcd(num, den), den / DurationMath::gcd(num, den) };
+    }
+
+    /**
+     * Conversions for a tic rate known at compile time
+     * @param   TICS_PER_SECOND     Tic rate
+     */
+    template <uint32_t TICS_PER_SECOND>
+    struct TicRate
+    {
+        static_assert(TICS_PER_SECOND > 0, "Tic rate must not be 0");
+
+        static constexpr uint32_t ticsPerSecond() { return TICS_PER_SECOND; }
+
+        // Durations to tics, rounded down
+        static constexpr Tics toTics(Seconds s) { return Tics(s.count * TICS_PER_SECOND); }
+        static constexpr Tics toTics(Milliseconds ms) { return Tics(makeRatio(TICS_PER_SECOND, 1000).apply(ms.count)); }
+        static constexpr Tics toTics(Microseconds us) { return Tics(makeRatio(TICS_PER_SECOND, 1000000).apply(us.count)); }
+
+        // Durations to tics, rounded up so a wait is never short
+        static constexpr Tics toTicsRoundUp(Milliseconds ms) { return Tics(makeRatio(TICS_PER_SECOND, 1000).applyUp(ms.count)); }
+        static constexpr Tics toTicsRoundUp(Microseconds us) { return Tics(makeRatio(TICS_PER_SECOND, 1000000).applyUp(us.count)); }
+
+        // Tics to durations, rounded down
+        static constexpr Milliseconds toMilliseconds(Tics t) { return Milliseconds(makeRatio(1000, TICS_PER_SECOND).apply(t.count)); }
+        static constexpr Microseconds toMicroseconds(Tics t) { return Microseconds(makeRatio(1000000, TICS_PER_SECOND).apply(t.count)); }
+    };
+}
+
+#endif
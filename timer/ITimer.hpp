@@ -25,10 +25,17 @@ namespace Timer
             virtual void enable() = 0;
             virtual void disable() = 0;
 
-            virtual void setInterrupt(void (*interrupt)(void));
-            virtual void setPeriodTics(uint16_t tics);
-            virtual uint16_t microSecondsToTics(uint32_t microseconds);
-            virtual void reset();
+            virtual void setInterrupt(void (*interrupt)(void)) = 0;
+            virtual void setPeriodTics(uint16_t tics) = 0;
+
+            /**
+             * @return  Largest value setPeriodTics takes. Defaults to a full 16 bit counter, timers
+             *          with a narrower counter (e.g. 8 bit) must override it
+             */
+            virtual uint16_t getMaxPeriodTics() { return 0xFFFF; }
+
+            virtual uint16_t microSecondsToTics(uint32_t microseconds) = 0;
+            virtual void reset() = 0;
     };
 }
 
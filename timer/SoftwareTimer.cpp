@@ -51,6 +51,16 @@ namespace Timer{
         }
     }
 
+    void SoftwareTimer::setPeriod(Tic::Tics period)
+    {
+        setPeriod(period.count);
+    }
+
+    void SoftwareTimer::setPeriod(Tic::Milliseconds period)
+    {
+        setPeriod(pTicCounter_->toTics(period));
+    }
+
     void SoftwareTimer::setPeriodMs(uint32_t periodInMs)
     {
         setPeriod(pTicCounter_->msecondsToTics(periodInMs));
@@ -4,13 +4,29 @@ namespace Tic{
 
     TicCounter::TicCounter(uint32_t ticsPerSecond):
         ticCount_(0),
-        ticsPerSecond_(ticsPerSecond)
+        ticsPerSecond_(ticsPerSecond),
+        microsPerTicQ8_((256ul * 1000000ul) / ticsPerSecond),
+        msToTics_(makeRatio(ticsPerSecond, 1000)),
+        usToTics_(makeRatio(ticsPerSecond, 1000000)),
+        ticsToMs_(makeRatio(1000, ticsPerSecond))
     {}
      
     TicCounter::~TicCounter(){}
 
     volatile uint32_t TicCounter::getTicCount(){
-        return ticCount_;
+        // Reading 4 bytes is not atomic on an 8-bit core, read until the tic interrupt has not
+        // changed the count part way through
+        uint32_t ticCount;
+        do
+        {
+            ticCount = ticCount_;
+        } while (ticCount != ticCount_);
+
+        return ticCount;
+    }
+
+    uint32_t TicCounter::nowMicros(){
+        return scaleQ8(getTicCount(), microsPerTicQ8_);
     }
 
     void TicCounter::incrementTicCount(){
@@ -23,6 +39,6 @@ namespace Tic{
     }
     uint32_t TicCounter::msecondsToTics(uint32_t mseconds)
     {
-        return ticsPerSecond_ * mseconds / 1000;
+        return msToTics_.apply(mseconds);
     }
 }
\ No newline at end of file
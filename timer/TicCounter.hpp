@@ -3,23 +3,72 @@
 
 #include <stdint.h>
 
+#include "Duration.hpp"
+
 namespace Tic{
 
     class TicCounter{
 
         public:
             TicCounter(uint32_t ticsPerSecond);
-            ~TicCounter();
+            virtual ~TicCounter();
+
+            // Overridden by tic counters that keep time in hardware rather than counting interrupts
+            virtual volatile uint32_t getTicCount();
+
+            /**
+             * @return  Microseconds since the tic count started, wrapping every 2^32. Only as fine as
+             *          the tic period unless a subclass can read the time within a tic
+             */
+            virtual uint32_t nowMicros();
+
+            /**
+             * Make sure an interrupt wakes the CPU by a tic, so it can sleep while waiting for it.
+             * Counters that interrupt every tic have nothing to do
+             * @param   tic     Tic to wake by
+             */
+            virtual void wakeAtTic(uint32_t /* tic */) {}
 
-            volatile uint32_t getTicCount();
             void incrementTicCount();
             uint32_t getTicsPerSecond() { return ticsPerSecond_; }
             uint32_t secondsToTics(uint32_t seconds);
             uint32_t msecondsToTics(uint32_t mseconds);
 
-        private:
+            /**
+             * Convert a duration at this counter's tic rate, rounded down. If the rate is known at
+             * compile time, TicRate does the same and folds to a constant
+             */
+            Tics toTics(Seconds s) { return Tics(secondsToTics(s.count)); }
+            Tics toTics(Milliseconds ms) { return Tics(msToTics_.apply(ms.count)); }
+            Tics toTics(Microseconds us) { return Tics(usToTics_.apply(us.count)); }
+
+            /**
+             * Convert a duration at this counter's tic rate, rounded up so a wait is never short
+             */
+            Tics toTicsRoundUp(Milliseconds ms) { return Tics(msToTics_.applyUp(ms.count)); }
+            Tics toTicsRoundUp(Microseconds us) { return Tics(usToTics_.applyUp(us.count)); }
+
+            Milliseconds toMilliseconds(Tics t) { return Milliseconds(ticsToMs_.apply(t.count)); }
+
+        protected:
             volatile uint32_t ticCount_;
+
+            /**
+             * Multiply by a factor with 8 fractional bits, without the 40 bit intermediate
+             * @param   value       Value to scale, the result wraps like value * factor / 256 would
+             * @param   factorQ8    Factor times 256
+             */
+            static uint32_t scaleQ8(uint32_t value, uint32_t factorQ8)
+            {
+                return ((value >> 8) * factorQ8) + (((value & 0xFF) * factorQ8) >> 8);
+            }
+
+        private:
             uint32_t ticsPerSecond_;
+            uint32_t microsPerTicQ8_;   // Microseconds per tic, times 256
+            Ratio msToTics_;            // Tics per millisecond, reduced
+            Ratio usToTics_;            // Tics per microsecond, reduced
+            Ratio ticsToMs_;            // Milliseconds per tic, reduced
     };
 }
 
@@ -0,0 +1,214 @@
+#include "TimerWheel.hpp"
+#include "drivers/assert/Assert.hpp"
+
+using namespace Tic;
+using namespace Watchdog;
+
+namespace Timer{
+
+    const static uint32_t WHEEL_RANGE_TICS = ((uint32_t)1 << (TimerWheel::LEVEL_BITS * TimerWheel::NUM_LEVELS));
+
+    WheelTimer::WheelTimer(void (*callback)(void)):
+        callback_(callback),
+        pNext_(nullptr),
+        ppPrev_(nullptr),
+        expiryTic_(0),
+        periodTics_(0)
+    {}
+
+    TimerWheel::TimerWheel(TicCounter* pTicCounter, IWatchdog* pWdt):
+        pTicCounter_(pTicCounter),
+        pWdt_(pWdt),
+        currentTic_(pTicCounter->getTicCount()),
+        slots_()
+    {}
+
+    void TimerWheel::startOneShot(WheelTimer* pTimer, uint32_t delayTics)
+    {
+        cancel(pTimer);
+        pTimer->expiryTic_ = pTicCounter_->getTicCount() + delayTics;
+        add(pTimer, currentTic_ + 1);
+    }
+
+    void TimerWheel::startPeriodic(WheelTimer* pTimer, uint32_t periodTics)
+    {
+        assertCustom(periodTics != 0);
+
+        cancel(pTimer);
+        pTimer->periodTics_ = periodTics;
+        pTimer->expiryTic_ = pTicCounter_->getTicCount() + periodTics;
+        add(pTimer, currentTic_ + 1);
+    }
+
+    void TimerWheel::cancel(WheelTimer* pTimer)
+    {
+        if (pTimer->isPending()) unlink(pTimer);
+        pTimer->periodTics_ = 0;
+    }
+
+    void TimerWheel::dispatch()
+    {
+        uint32_t currentTic = pTicCounter_->getTicCount();
+        while (currentTic_ != currentTic)
+        {
+            // Finding the next event costs a scan of every slot, only worth it for a long gap
+            uint32_t ticsBehind = currentTic - currentTic_;
+            if (ticsBehind > LEVEL_SLOTS)
+            {
+                uint32_t ticsUntilEvent = ticsUntilNextEvent();
+                if ((ticsUntilEvent == 0) || (ticsUntilEvent > ticsBehind))
+                {
+                    // Nothing to do up to now
+                    currentTic_ = currentTic;
+                    break;
+                }
+
+                // Slots in between are empty, so no timers need to move down on the way
+                currentTic_ += ticsUntilEvent - 1;
+            }
+
+            advance();
+        }
+
+        // Nourish watchdog if one was given
+        if (pWdt_ != nullptr) pWdt_->reset();
+    }
+
+    bool TimerWheel::getNextEventTic(uint32_t* pTic)
+    {
+        uint32_t ticsUntilEvent = ticsUntilNextEvent();
+        if (ticsUntilEvent == 0) return false;
+
+        *pTic = currentTic_ + ticsUntilEvent;
+        return true;
+    }
+
+    uint32_t TimerWheel::ticsUntilNextEvent()
+    {
+        uint32_t result = 0;
+
+        for (uint8_t level = 0; level < NUM_LEVELS; level++)
+        {
+            uint8_t shift = LEVEL_BITS * level;
+            uint32_t span = currentTic_ >> shift;
+
+            // Slots are used in order after the current one, up to a full turn of the level
+            for (uint8_t i = 1; i <= LEVEL_SLOTS; i++)
+            {
+                if (slots_[level][(span + i) & (LEVEL_SLOTS - 1)] == nullptr) continue;
+
+                // Level 0 slots run on their tic, higher ones move down at the start of their span
+                uint32_t ticsUntilSlot = ((span + i) << shift) - currentTic_;
+                if ((result == 0) || (ticsUntilSlot < result)) result = ticsUntilSlot;
+                break;
+            }
+        }
+
+        return result;
+    }
+
+    void TimerWheel::add(WheelTimer* pTimer, uint32_t baseTic)
+    {
+        // baseTic is the first tic that has not been run, anything due before it runs then
+        uint32_t slotTic = pTimer->expiryTic_;
+        uint32_t delta = slotTic - baseTic;
+        if (delta & 0x80000000)
+        {
+            slotTic = baseTic;
+            delta = 0;
+        }
+
+        // Timers beyond the top level wait in it, and are placed again each time they cascade
+        if (delta >= WHEEL_RANGE_TICS)
+        {
+            slotTic = baseTic + WHEEL_RANGE_TICS - 1;
+            delta = WHEEL_RANGE_TICS - 1;
+        }
+
+        // Lowest level whose slots cover the delay
+        uint8_t level = 0;
+        uint8_t shift = 0;
+        while ((delta >> LEVEL_BITS) != 0)
+        {
+            delta >>= LEVEL_BITS;
+            shift += LEVEL_BITS;
+            level++;
+        }
+
+        push(&slots_[level][(slotTic >> shift) & (LEVEL_SLOTS - 1)], pTimer);
+    }
+
+    void TimerWheel::cascade(uint8_t level, uint8_t slot)
+    {
+        // Take the whole list, so timers placed again cannot land back in it
+        WheelTimer* pList = slots_[level][slot];
+        slots_[level][slot] = nullptr;
+        if (pList != nullptr) pList->ppPrev_ = &pList;
+
+        while (pList != nullptr)
+        {
+            WheelTimer* pTimer = pList;
+            unlink(pTimer);
+            add(pTimer, currentTic_);
+        }
+    }
+
+    void TimerWheel::advance()
+    {
+        currentTic_++;
+
+        // Each level's slot moves down at the start of its span, highest first since its timers
+        // may land in the lower slots about to move
+        uint8_t topLevel = 0;
+        uint32_t tic = currentTic_;
+        while ((topLevel < NUM_LEVELS - 1) && ((tic & (LEVEL_SLOTS - 1)) == 0))
+        {
+            tic >>= LEVEL_BITS;
+            topLevel++;
+        }
+
+        for (uint8_t level = topLevel; level > 0; level--)
+        {
+            cascade(level, (currentTic_ >> (LEVEL_BITS * level)) & (LEVEL_SLOTS - 1));
+        }
+
+        // Run everything due on this tic. The list is taken first, callbacks can then start and
+        // cancel any timer, including ones still in the list
+        WheelTimer* pList = slots_[0][currentTic_ & (LEVEL_SLOTS - 1)];
+        slots_[0][currentTic_ & (LEVEL_SLOTS - 1)] = nullptr;
+        if (pList != nullptr) pList->ppPrev_ = &pList;
+
+        while (pList != nullptr)
+        {
+            WheelTimer* pTimer = pList;
+            unlink(pTimer);
+
+            // Periodic timers go back in before their callback runs, so it can cancel them
+            if (pTimer->periodTics_ != 0)
+            {
+                pTimer->expiryTic_ += pTimer->periodTics_;
+                add(pTimer, currentTic_ + 1);
+            }
+
+            if (pTimer->callback_ != nullptr) pTimer->callback_();
+        }
+    }
+
+    void TimerWheel::unlink(WheelTimer* pTimer)
+    {
+        *pTimer->ppPrev_ = pTimer->pNext_;
+        if (pTimer->pNext_ != nullptr) pTimer->pNext_->ppPrev_ = pTimer->ppPrev_;
+
+        pTimer->pNext_ = nullptr;
+        pTimer->ppPrev_ = nullptr;
+    }
+
+    void TimerWheel::push(WheelTimer** ppHead, WheelTimer* pTimer)
+    {
+        pTimer->pNext_ = *ppHead;
+        if (pTimer->pNext_ != nullptr) pTimer->pNext_->ppPrev_ = &pTimer->pNext_;
+
+        *ppHead = pTimer;
+        pTimer->ppPrev_ = ppHead;
+    }
+}
@@ -0,0 +1,133 @@
+/**
+ * Hierarchical timer wheel, runs one-shot and periodic callbacks off a TicCounter
+ *
+ * Timers are kept in slots by the tic they expire on, so starting, cancelling and expiring a timer
+ * take the same time however many there are, and dispatch() only looks at the slots for tics that
+ * have passed. Level 0 has a slot per tic, each level above covers LEVEL_SLOTS times as many tics
+ * per slot, and its timers move down a level as their time gets close.
+ *
+ * Everything, including the callbacks, runs from the main loop:
+ *     static Timer::WheelTimer ledTimer(toggleLed);
+ *     wheel.startPeriodic(&ledTimer, ticCounter.msecondsToTics(500));
+ *     while (true) { wheel.dispatch(); ... }
+ */
+#ifndef TIMER_WHEEL_HPP
+#define TIMER_WHEEL_HPP
+
+#include <stdint.h>
+
+#include "TicCounter.hpp"
+#include "drivers/watchdog/Watchdog.hpp"
+
+namespace Timer{
+
+    /**
+     * A timer run by a TimerWheel, owned by the caller and linked into the wheel while pending
+     */
+    class WheelTimer{
+        friend class TimerWheel;
+
+        public:
+            /**
+             * Constructor
+             * @param   callback    Function to run each time the timer expires
+             */
+            WheelTimer(void (*callback)(void));
+
+            /**
+             * @return  True if the timer is waiting to expire
+             */
+            bool isPending() { return ppPrev_ != nullptr; }
+
+        private:
+            void (*callback_)(void);
+            WheelTimer* pNext_;     // Next timer in the same slot
+            WheelTimer** ppPrev_;   // Link pointing at this timer, nullptr when not pending
+            uint32_t expiryTic_;    // Tic the timer expires on
+            uint32_t periodTics_;   // Tics between expiries, 0 for a one-shot
+    };
+
+    class TimerWheel{
+        public:
+            const static uint8_t LEVEL_BITS = 4;
+            const static uint8_t LEVEL_SLOTS = (1 << LEVEL_BITS);
+            const static uint8_t NUM_LEVELS = 4;    // Timers further out than 2^16 tics wait in the top level
+
+            /**
+             * Constructor
+             * @param   pTicCounter     Tic source, timer periods are in its tics
+             * @param   pWdt            Watchdog to nourish on each dispatch, if one is given
+             */
+            TimerWheel(Tic::TicCounter* pTicCounter, Watchdog::IWatchdog* pWdt = nullptr);
+            ~TimerWheel(){}
+
+            /**
+             * Run a timer's callback once after a delay, restarting it if it was already pending
+             * @param   pTimer      Timer to start
+             * @param   delayTics   Tics from now, a delay of 0 runs on the next tic
+             */
+            void startOneShot(WheelTimer* pTimer, uint32_t delayTics);
+
+            /**
+             * Run a timer's callback every period, restarting it if it was already pending.
+             * Expiries are a fixed number of tics apart, late dispatches do not add drift
+             * @param   pTimer      Timer to start
+             * @param   periodTics  Tics between runs, must not be 0
+             */
+            void startPeriodic(WheelTimer* pTimer, uint32_t periodTics);
+
+            /**
+             * Stop a timer, it is safe to cancel one that is not pending
+             */
+            void cancel(WheelTimer* pTimer);
+
+            /**
+             * Run the callbacks of every timer that has expired since the last call. Callbacks may
+             * start and cancel any timer, including their own. Tics with nothing to do are skipped
+             * over, so a tickless tic counter can move on many tics between calls
+             */
+            void dispatch();
+
+            /**
+             * Find the next tic dispatch() has work on, e.g. to set a tickless counter's deadline
+             * before sleeping. It may be a tic where timers only move down a level, and not expire
+             * @param   pTic    Set to the tic
+             * @return  False if no timers are pending
+             */
+            bool getNextEventTic(uint32_t* pTic);
+
+        private:
+            Tic::TicCounter* pTicCounter_;
+            Watchdog::IWatchdog* pWdt_;
+            uint32_t currentTic_;   // Last tic whose timers have been run
+            WheelTimer* slots_[NUM_LEVELS][LEVEL_SLOTS];
+
+            /**
+             * Link a timer into the slot for its expiry tic
+             * @param   pTimer      Timer to add
+             * @param   baseTic     First tic whose timers have not been run
+             */
+            void add(WheelTimer* pTimer, uint32_t baseTic);
+
+            /**
+             * Move the timers in a slot down to the levels they now belong in
+             */
+            void cascade(uint8_t level, uint8_t slot);
+
+            /**
+             * Find how far ahead the next tic with work is
+             * @return  Tics after currentTic_, 0 if no timers are pending
+             */
+            uint32_t ticsUntilNextEvent();
+
+            /**
+             * Move the current tic on by one, and run the timers that expire on it
+             */
+            void advance();
+
+            static void unlink(WheelTimer* pTimer);
+            static void push(WheelTimer** ppHead, WheelTimer* pTimer);
+    };
+}
+
+#endif
@@ -19,6 +19,7 @@ namespace Watchdog
             virtual void enable() = 0;
             virtual void disable() = 0;
             virtual void setTimeout(uint32_t timeoutMs) = 0;
+            virtual uint32_t getTimeoutMs() = 0;
             virtual void reset() = 0;
 
             virtual ResetCause getResetCause()
@@ -88,6 +88,11 @@ namespace Watchdog
         assertCustom(false, "Cannot set watchdog timeout this high.");
     }
 
+    uint32_t Atmega328Watchdog::getTimeoutMs()
+    {
+        return TIMEOUTS_MS[prescaler_];
+    }
+
     void Atmega328Watchdog::reset()
     {
         wdt_reset();
@@ -19,6 +19,7 @@ namespace Watchdog
             void enable() override;
             void disable() override;
             void setTimeout(uint32_t timeoutMs) override;
+            uint32_t getTimeoutMs() override;
             void reset() override;
 
             ResetCause getResetCause();